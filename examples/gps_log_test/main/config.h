@@ -9,6 +9,7 @@
 #define GPS_RATE_NORMAL 10         // 10Hz - normal operation
 #define GPS_RATE_EDGE 20           // 20Hz - edge case
 #define GPS_RATE_STRESS 30         // 30Hz - stress test (can push to 40Hz)
+#define GPS_RATE_MAX 50            // 50Hz - highest rate, needs CONFIG_GPS_LOG_MAX_RATE=50
 
 #define TEST_GPS_RATE GPS_RATE_NORMAL  // Change this to test different rates
 #define MOCK_DATA_INTERVAL_MS (1000 / TEST_GPS_RATE)  // Auto-calculate interval
@@ -20,6 +21,8 @@
     #define TEST_UBX_OUTPUT_RATE UBX_OUTPUT_20HZ
 #elif TEST_GPS_RATE == 30
     #define TEST_UBX_OUTPUT_RATE 0x1E  // 30Hz (not in standard enum)
+#elif TEST_GPS_RATE == 50
+    #define TEST_UBX_OUTPUT_RATE 0x32  // 50Hz (not in standard enum)
 #else
     #define TEST_UBX_OUTPUT_RATE UBX_OUTPUT_10HZ  // Default
 #endif
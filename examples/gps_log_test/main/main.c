@@ -333,6 +333,8 @@ static void mock_uart_task(void *arg) {
         }
         printf("Message success rate: %.1f%%\n", msg_success_rate);
         printf("Parse errors: %lu\n", gps->ubx_device->ubx_msg.count_err);
+        printf("Lost frames: %u (timeouts: %u)\n", gps->lost_frames + gps->frame_lost_flag,
+               gps->gps_timeout_flag);
     }
     printf("==================================\n");
 
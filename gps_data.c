@@ -198,6 +198,78 @@ void gps_check_sec_buf(size_t new_size) {
 }
 #endif
 
+/// samples needed to hold the longest configured distance window at the given rate
+size_t gps_speed_buffer_required(uint8_t sample_rate) {
+	float longest = ALFA_DISTANCE_MAX;
+	for (uint16_t i = 0; gps && i < gps->num_speed_metrics; i++) {
+		if ((gps->speed_metrics[i].type & GPS_SPEED_TYPE_DIST) &&
+			gps->speed_metrics[i].window > longest)
+			longest = gps->speed_metrics[i].window;
+	}
+	if (!sample_rate)
+		sample_rate = 1;
+	uint32_t required = GPS_SPEED_BUFFER_SIZE(sample_rate, longest);
+	return required > UINT16_MAX ? UINT16_MAX : required;
+}
+
+#if !defined(CONFIG_GPS_LOG_STATIC_G_BUFFER)
+void gps_free_gspeed_buf() {
+	FUNC_ENTRY(TAG);
+	if (log_p_lctx.buf_gspeed_size) {
+		unalloc_buffer((void **)&log_p_lctx.buf_gspeed);
+		log_p_lctx.buf_gspeed_size = 0;
+	}
+}
+
+/// a fresh speed buffer holds zeros, restart the windows summed over its samples
+static void gps_speed_windows_reset(void) {
+	const uint32_t rate = ubx_get_effective_output_rate();
+	for (uint16_t i = 0; gps && i < gps->num_speed_metrics; i++) {
+		gps_speed_metrics_desc_t *desc = &gps->speed_metrics[i];
+		if (desc->type == GPS_SPEED_TYPE_TIME) {
+			gps_speed_by_time_t *t = desc->handle.time;
+			// windows summed over the seconds buffer keep their sum
+			if (t && (uint32_t)t->time_window * rate < log_p_lctx.buf_gspeed_size)
+				t->avg_s_sum = 0;
+		} else if (desc->type & (GPS_SPEED_TYPE_DIST | GPS_SPEED_TYPE_ALFA)) {
+			gps_speed_by_dist_t *d = desc->handle.dist;
+			if (d) {
+				d->distance = 0;
+				d->m_index = log_p_lctx.index_gspeed;
+			}
+		}
+	}
+}
+
+void gps_check_gspeed_buf(size_t new_size) {
+	FUNC_ENTRY_ARGS(TAG, "Checking speed buffer for new size: %zu", new_size);
+	// check_and_alloc_buffer keeps a large enough buffer, only a fresh one needs clearing
+	const bool reused = log_p_lctx.buf_gspeed && log_p_lctx.buf_gspeed_size >= new_size;
+	check_and_alloc_buffer((void **)&log_p_lctx.buf_gspeed, new_size,
+						   sizeof(int32_t), &log_p_lctx.buf_gspeed_size,
+						   buffer_caps
+						   );
+	if (log_p_lctx.buf_gspeed) {
+		if (!reused) {
+			memset(log_p_lctx.buf_gspeed, 0, log_p_lctx.buf_gspeed_size * sizeof(int32_t));
+			gps_speed_windows_reset();
+		}
+		ILOG(TAG,
+			 "[%s] speed buffer: requested=%zu elems, allocated=%" PRIu16
+			 " elems (%zu bytes), rate=%d Hz",
+			 __func__, new_size, log_p_lctx.buf_gspeed_size,
+			 (size_t)log_p_lctx.buf_gspeed_size * sizeof(int32_t),
+			 ubx_get_effective_output_rate());
+	}
+#if (C_LOG_LEVEL <= LOG_INFO_NUM)
+	else {
+		WLOG(TAG, "[%s] Failed to allocate speed buffer of size %zu",
+			 __func__, new_size);
+	}
+#endif
+}
+#endif
+
 // #define GPS_TRACE_MSG_SPEED_BY_DIST 1
 // #define GPS_TRACE_MSG_SPEED_BY_TIME 1
 // #define GPS_TRACE_MSG_SPEED_ALPHA 1
@@ -263,7 +335,7 @@ static esp_err_t gps_p_context_printf(const gps_p_context_t *me) {
 	uint8_t i, j = buf_index(me->index_gspeed);
 	if (j < 10)
 		j = 10;
-	for (i = j - 10; i < j; i++)
+	for (i = j - 10; me->buf_gspeed_size && i < j; i++)
 		printf(" %" PRId32 "", me->buf_gspeed[i]);
 	printf("\n");
 	j = me->sec_buf_index(index_sec);
@@ -291,6 +363,8 @@ static esp_err_t gps_p_context_printf(const gps_p_context_t *me) {
 #endif
 
 int32_t gps_last_speed_smoothed(uint8_t window_size) {
+	if (!log_p_lctx.buf_gspeed_size)
+		return 0;
 	return smooth(log_p_lctx.buf_gspeed, log_p_lctx.index_gspeed,
 				  log_p_lctx.buf_gspeed_size, window_size);
 }
@@ -360,6 +434,9 @@ void deinit_gps_context_fields(gps_context_t *ctx) {
 #endif
 #if !defined(CONFIG_GPS_LOG_STATIC_S_BUFFER)
 	gps_free_sec_buf();
+#endif
+#if !defined(CONFIG_GPS_LOG_STATIC_G_BUFFER)
+	gps_free_gspeed_buf();
 #endif
 	gps_speed_metrics_free();
 	ubx_nav_mode_on_session_end();
@@ -404,7 +481,7 @@ inline void gps_log_nav_mode_change(gps_context_t *context, uint8_t old_mode) {}
 #endif
 
 const float speed_thresholds_for_alfa[] = ALFA_THRESHOLDS_MS;
-const uint8_t speed_threshold_index[17] = ALFA_THRESHOLD_IDX_TABLE;
+const uint8_t speed_threshold_rate_limits[5] = ALFA_THRESHOLD_RATE_LIMITS;
 
 // rate counted speed buffer
 static inline void update_speed_buffer(gps_point_t *p, int32_t gSpeed) {
@@ -412,9 +489,18 @@ static inline void update_speed_buffer(gps_point_t *p, int32_t gSpeed) {
 		log_p_lctx.index_gspeed = 0;
 	else
 		log_p_lctx.index_gspeed++;
-	log_p_lctx.buf_gspeed[buf_index(log_p_lctx.index_gspeed)] = gSpeed;
+#if !defined(CONFIG_GPS_LOG_STATIC_G_BUFFER) || !defined(CONFIG_GPS_LOG_STATIC_A_BUFFER)
+	// Rate counted buffers are only (re)allocated here on the GPS task, the
+	// speed metrics of the same epoch read them after push_gps_data()
+	const uint8_t resize_rate = log_p_lctx.resize_rate;
+	log_p_lctx.resize_rate = 0;
+#endif
+#if !defined(CONFIG_GPS_LOG_STATIC_G_BUFFER)
+	if (!log_p_lctx.buf_gspeed || resize_rate)
+		gps_check_gspeed_buf(gps_speed_buffer_required(ubx_get_effective_output_rate()));
+#endif
 #if !defined(CONFIG_GPS_LOG_STATIC_A_BUFFER)
-	if (!log_p_lctx.alfa_buf) {
+	if (!log_p_lctx.alfa_buf || resize_rate) {
 		const uint8_t rate = ubx_get_effective_output_rate();
 		gps_check_alfa_buf(ALPHA_BUFFER_SIZE(rate, spd_threshold_for_alfa(rate)));
 	}
@@ -423,6 +509,10 @@ static inline void update_speed_buffer(gps_point_t *p, int32_t gSpeed) {
 	if (!log_p_lctx.buf_sec_speed)
 		gps_check_sec_buf(BUFFER_SEC_SIZE);
 #endif
+	if (log_p_lctx.buf_gspeed_size)
+		log_p_lctx.buf_gspeed[buf_index(log_p_lctx.index_gspeed)] = gSpeed;
+	if (!log_p_lctx.alfa_buf_size)
+		return;
 	log_p_lctx.alfa_buf[al_buf_index(log_p_lctx.index_gspeed)].latitude =
 		p->latitude;
 	log_p_lctx.alfa_buf[al_buf_index(log_p_lctx.index_gspeed)].longitude =
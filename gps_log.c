@@ -18,6 +18,27 @@ static ubx_msg_stats_t period_msg_stats = {0};
 static uint32_t prev_millis = 0;
 static esp_timer_handle_t gps_periodic_timer = 0;
 
+// NAV-PVT epoch path timing (metrics + file logging), budget is one frame
+// period at the effective rate, so 20ms at 50Hz
+typedef struct {
+	uint32_t count;
+	uint32_t over_budget;
+	uint32_t max_us;
+	uint64_t sum_us;
+} gps_epoch_stats_t;
+static gps_epoch_stats_t epoch_stats = {0};
+
+static inline void gps_epoch_stats_add(int64_t start_us) {
+	uint32_t took = (uint32_t)(esp_timer_get_time() - start_us);
+	uint8_t rate = ubx_get_effective_output_rate();
+	epoch_stats.count++;
+	epoch_stats.sum_us += took;
+	if (took > epoch_stats.max_us)
+		epoch_stats.max_us = took;
+	if (rate && took > 1000000U / rate)
+		epoch_stats.over_budget++;
+}
+
 void gps_log_print_stats(uint32_t period_ms, uint8_t expected_hz) {
 
 	// Calculate period statistics and store in period_msg_stats
@@ -66,6 +87,14 @@ void gps_log_print_stats(uint32_t period_ms, uint8_t expected_hz) {
 		   " | File ok=%" PRIu32 " err=%" PRIu32 "\n",
 		   cur_msg_stats.count_nav_pvt, cur_msg_stats.count_nav_dop,
 		   cur_msg_stats.count_ok, cur_msg_stats.count_err);
+	printf("[GPS] Epoch path (period): avg=%" PRIu32 "us max=%" PRIu32
+		   "us over budget=%" PRIu32 " of %" PRIu32 " (budget %" PRIu32
+		   "us)\n",
+		   epoch_stats.count ? (uint32_t)(epoch_stats.sum_us / epoch_stats.count)
+							 : 0,
+		   epoch_stats.max_us, epoch_stats.over_budget, epoch_stats.count,
+		   expected_hz ? 1000000U / expected_hz : 0);
+	memset(&epoch_stats, 0, sizeof(epoch_stats));
 	printf("[GPS] ========================================\n");
 }
 
@@ -86,6 +115,7 @@ void gps_log_print_all_stats(void *arg) {
 	ubx_uart_print_stats(period, expected_hz); // Layer 1: UART message stats
 	ubx_print_stats(period, expected_hz);
 	gps_log_print_stats(period, expected_hz); // Layer 2: UBX decoded messages
+	gps_log_file_print_stats(period);		  // Layer 3: async file writer
 	printf("\n");
 }
 
@@ -361,17 +391,15 @@ static void gps_buffers_init(void) {
 }
 
 #if !defined(CONFIG_GPS_LOG_STATIC_A_BUFFER) ||                                \
-	!defined(CONFIG_GPS_LOG_STATIC_S_BUFFER)
+	!defined(CONFIG_GPS_LOG_STATIC_S_BUFFER) ||                                \
+	!defined(CONFIG_GPS_LOG_STATIC_G_BUFFER)
 static void gps_on_sample_rate_change(void *handler_arg, esp_event_base_t base,
 									  int32_t id, void *event_data) {
 	uint8_t new_rate = ubx_get_effective_output_rate();
 	FUNC_ENTRY_ARGS(TAG, "new rate:%d", new_rate);
-	// Resize alfa buffer if needed - check_and_alloc_buffer will reuse existing
-	// buffer if it's already large enough (e.g., 20Hz->5Hz keeps 20Hz buffer)
-	if (xSemaphoreTake(log_p_lctx.xMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-		gps_check_alfa_buf(ALPHA_BUFFER_SIZE(new_rate, spd_threshold_for_alfa(new_rate)));
-		xSemaphoreGive(log_p_lctx.xMutex);
-	}
+	// The GPS task reads the alfa and speed buffers in the speed metrics
+	// without the mutex, so it resizes them itself at its next epoch
+	log_p_lctx.resize_rate = new_rate;
 }
 
 static void gps_on_ubx_config_changed(void *handler_arg, esp_event_base_t base,
@@ -431,6 +459,9 @@ static void gps_free_sec_buffers(void) {
 #if !defined(CONFIG_GPS_LOG_STATIC_S_BUFFER)
 	gps_free_sec_buf();
 #endif
+#if !defined(CONFIG_GPS_LOG_STATIC_G_BUFFER)
+	gps_free_gspeed_buf();
+#endif
 }
 
 static void gps_buffers_free(void) {
@@ -445,7 +476,7 @@ static void gps_on_ubx_deinit(void *handler_arg, esp_event_base_t base,
 	gps_free_sec_buffers();
 }
 
-#endif // CONFIG_GPS_LOG_STATIC_A_BUFFER || CONFIG_GPS_LOG_STATIC_S_BUFFER
+#endif // CONFIG_GPS_LOG_STATIC_A_BUFFER || CONFIG_GPS_LOG_STATIC_S_BUFFER || CONFIG_GPS_LOG_STATIC_G_BUFFER
 
 static bool ubx_init_rate_adjusted = false;
 
@@ -534,15 +565,15 @@ static void gpsTask(void *parameter) {
 		// (file I/O) Phase 1: Drain buffer by decoding ALL available messages
 		// (no heavy processing) Timeout scales with GPS rate to minimize CPU
 		// waste while staying responsive: 1-2Hz=100ms, 3-5Hz=50ms, 6-10Hz=20ms,
-		// 11-20Hz=10ms, 21-30Hz=5ms At low rates (2Hz=500ms period), 100ms
-		// timeout = 5 wakeups/msg (vs 100 with 5ms) At high rates (30Hz=33ms
+		// 11-20Hz=10ms, 21-50Hz=5ms At low rates (2Hz=500ms period), 100ms
+		// timeout = 5 wakeups/msg (vs 100 with 5ms) At high rates (50Hz=20ms
 		// period), 5ms timeout = responsive without missing data Recalculated
 		// each iteration to adapt to runtime rate changes
 		uint32_t timeout_ms;
 		if (!ubx_ctx->ready) {
 			timeout_ms = 50; // During init, use moderate timeout
 		} else if (ubx_get_effective_output_rate() >= 21) {
-			timeout_ms = 5; // 21-30Hz: very responsive
+			timeout_ms = 5; // 21-50Hz: very responsive
 		} else if (ubx_get_effective_output_rate() >= 11) {
 			timeout_ms = 10; // 11-20Hz: responsive
 		} else if (ubx_get_effective_output_rate() >= 6) {
@@ -663,6 +694,9 @@ static void gpsTask(void *parameter) {
 					// Process speed/movement immediately using LOCAL snapshot
 					// (safe from overwrites)
 					if (gps->time_set && log_p_lctx.count_nav_pvt > 10) {
+#if defined(CONFIG_GPS_TIMER_STATS_ENABLED)
+						const int64_t epoch_start_us = esp_timer_get_time();
+#endif
 						gps->gps_speed = pvt_snapshot.gSpeed;
 
 						// Process satellite data if available
@@ -832,6 +866,7 @@ static void gpsTask(void *parameter) {
 #if defined(CONFIG_GPS_TIMER_STATS_ENABLED)
 						else
 							++cur_msg_stats.count_err;
+						gps_epoch_stats_add(epoch_start_us);
 #endif
 					}
 					lctx.old_nav_pvt_itow = pvt_snapshot.iTOW;
@@ -1024,7 +1059,9 @@ int gps_start() {
 	if (lctx.gps_started)
 		return 0;
 	int ret = 0;
-#if !defined(CONFIG_GPS_LOG_STATIC_A_BUFFER)
+#if !defined(CONFIG_GPS_LOG_STATIC_A_BUFFER) ||                                \
+	!defined(CONFIG_GPS_LOG_STATIC_S_BUFFER) ||                                \
+	!defined(CONFIG_GPS_LOG_STATIC_G_BUFFER)
 	if (!lctx.gps_events_registered) {
 		esp_event_handler_register(UBX_EVENT, UBX_EVENT_SAMPLE_RATE_CHANGED,
 								   &gps_on_sample_rate_change, gps->ubx_device);
@@ -1071,11 +1108,11 @@ int gps_shut_down() {
 		lctx.gps_log_delay = 0;
 	}
 	// Stop GPS task FIRST before any async writer teardown.
-	// The GPS task writes to async_writer_queue and async_pool at up to 20Hz.
-	// close_files() deletes both those queues inside async_writer_stop(), so if
-	// the GPS task is mid-xQueueSend or mid-logger_fixed_pool_alloc when those
-	// handles are freed, FreeRTOS state is corrupted and the device hangs
-	// forever (no logs, no sleep reached, reproducible on both cores / rates).
+	// The GPS task encodes frames in place into the write rings at up to 50Hz.
+	// close_files() frees those rings inside async_writer_stop(), so if the
+	// GPS task is mid-frame when they are freed, it writes into released heap
+	// and the device hangs forever (no logs, no sleep reached, reproducible on
+	// both cores / rates).
 	gps_task_stop();
 	if (gps->time_set) { // Only safe to RTC memory if new GPS data is available
 						 // !!
@@ -1092,7 +1129,8 @@ int gps_shut_down() {
 		}
 	}
 #if !defined(CONFIG_GPS_LOG_STATIC_A_BUFFER) ||                                \
-	!defined(CONFIG_GPS_LOG_STATIC_S_BUFFER)
+	!defined(CONFIG_GPS_LOG_STATIC_S_BUFFER) ||                                \
+	!defined(CONFIG_GPS_LOG_STATIC_G_BUFFER)
 	if (lctx.gps_events_registered) {
 		esp_event_handler_unregister(UBX_EVENT, UBX_EVENT_SAMPLE_RATE_CHANGED,
 									 &gps_on_sample_rate_change);
@@ -0,0 +1,406 @@
+// Context free frame encoders, shared by the device writers and the host
+// transcoder (scripts/gps_log_transcode.c): no IDF or logger dependencies.
+#include <string.h>
+
+#include "gps_log_checksum.h"
+#include "gps_log_encode.h"
+
+// ============================================================================
+// SBP
+// ============================================================================
+
+void gps_log_enc_sbp(struct SBP_frame *frame, const gps_log_epoch_t *e) {
+    uint32_t numSV = 0xFFFFFFFF;
+    uint32_t HDOP = (e->hdop + 1U) / 20U;  // from 0.01 resolution to 0.2 ,reformat pDOP to HDOP 8-bit !!
+    if (HDOP > 255)
+        HDOP = 255;                       // has to fit in 8 bit
+    uint32_t sdop = e->sacc / 10;         // was sAcc
+    if (sdop > 255)
+        sdop = 255;
+    uint32_t vsdop = e->vacc / 10;        // was headingAcc ???
+    if (vsdop > 255)
+        vsdop = 255;
+    frame->UtcSec = (uint16_t)((e->second * 1000U) + e->millis);
+    frame->date_time_UTC_packed = (((uint32_t)(e->year - 2000) * 12 + e->month) << 22) +
+                                  ((uint32_t)e->day << 17) + ((uint32_t)e->hour << 12) +
+                                  ((uint32_t)e->minute << 6) + e->second;
+    frame->Lat = e->lat;
+    frame->Lon = e->lon;
+    frame->AltCM = e->hmsl / 10;          // omrekenen naar cm/s
+    frame->Sog = e->gspeed / 10;          // omrekenen naar cm/s
+    frame->Cog = e->heading / 1000;       // omrekenen naar 0.01 degrees
+    frame->SVIDCnt = e->num_sv;
+    frame->SVIDList = e->num_sv ? numSV >> (32 - e->num_sv) : 0;
+    frame->HDOP = HDOP;
+    frame->ClmbRte = -e->vel_d / 10;      // omrekenen naar cm/s
+    frame->sdop = sdop;
+    frame->vsdop = vsdop;
+}
+
+// ============================================================================
+// GPY
+// ============================================================================
+
+uint16_t Fletcher16(uint8_t *data, int count) {
+    /* Sum all the bytes, but not the last 2, modulo 256 in stead of 255 !! */
+    uint16_t sum = gps_log_fletcher16(data, count - 2);
+    data[count - 2] = sum & 0xFF;
+    data[count - 1] = sum >> 8;
+    return sum;
+}
+
+void gps_log_gpy_enc_init(gps_log_gpy_enc_t *enc, uint8_t block_frames) {
+    memset(enc, 0, offsetof(gps_log_gpy_enc_t, buf));
+    enc->ref.Type_identifier = 0xE0;  // Frame identifier for full frame = 0xE0
+    enc->block_frames = block_frames ? block_frames : 1;
+}
+
+size_t gps_log_enc_gpy(gps_log_gpy_enc_t *enc, const gps_log_epoch_t *e, bool full, uint8_t *out) {
+    struct GPY_Frame *ref = &enc->ref;
+    // calcultation of delta values
+    int delta_time = e->utc_ms - ref->Unix_time;              // ms
+    int delta_Speed = e->gspeed - ref->Speed;                  // mm/
+    int delta_Speed_error = e->sacc - ref->Speed_error;        // sAccCourse_Over_Ground;
+    int delta_Latitude = e->lat - ref->Latitude;
+    int delta_Longitude = e->lon - ref->Longitude;
+    int delta_COG = e->heading / 1000 - ref->COG / 1000;       // delta (course / 1000) !
+#define SIGNED_INT 30000  // if delta is more, a full frame is written
+    if ((delta_time > SIGNED_INT) | (delta_time < -SIGNED_INT))
+        full = true;
+    if ((delta_Speed > SIGNED_INT) | (delta_Speed < -SIGNED_INT))
+        full = true;
+    if ((delta_Speed_error > SIGNED_INT) | (delta_Speed_error < -SIGNED_INT))
+        full = true;
+    if ((delta_Latitude > SIGNED_INT) | (delta_Latitude < -SIGNED_INT))
+        full = true;
+    if ((delta_Longitude > SIGNED_INT) | (delta_Longitude < -SIGNED_INT))
+        full = true;
+    if ((delta_COG > SIGNED_INT) | (delta_COG < -SIGNED_INT))
+        full = true;
+    if (!enc->started)
+        full = true;  // first frame is always a full frame
+    if (full) {
+        ref->HDOP = e->hdop;
+        ref->Unix_time = e->utc_ms;
+        ref->Speed = e->gspeed;
+        ref->Speed_error = e->sacc;
+        ref->Latitude = e->lat;
+        ref->Longitude = e->lon;
+        ref->COG = e->heading;
+        ref->Sat = e->num_sv;
+        ref->fix = e->fix_type;
+        Fletcher16((uint8_t *)ref, sizeof(*ref));
+        memcpy(out, ref, sizeof(*ref));  // ref keeps the delta reference
+        enc->started = true;
+        return sizeof(*ref);
+    }
+    struct GPY_Frame_compressed *c = (struct GPY_Frame_compressed *)out;
+    c->Type_identifier = 0xD0;  // Frame identifier for compressed frame = 0xD0
+    c->Flags = 0x0;
+    c->HDOP = e->hdop;
+    c->delta_time = delta_time;
+    c->delta_Speed = delta_Speed;
+    c->delta_Speed_error = delta_Speed_error;
+    c->delta_Latitude = delta_Latitude;
+    c->delta_Longitude = delta_Longitude;
+    c->delta_COG = delta_COG;
+    c->Sat = e->num_sv;
+    c->fix = e->fix_type;
+    Fletcher16(out, sizeof(*c));
+    return sizeof(*c);
+}
+
+static inline uint8_t *gpy_put_varint(uint8_t *p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static inline uint8_t *gpy_put_svarint(uint8_t *p, int64_t v) {
+    return gpy_put_varint(p, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));  // zigzag
+}
+
+/**
+ * @brief Residual against the linear prediction, advances the prediction state
+ */
+static inline int64_t gpy_predict(int64_t *prev, int64_t *step, int64_t v) {
+    int64_t residual = v - (*prev + *step);
+    *step = v - *prev;
+    *prev = v;
+    return residual;
+}
+
+bool gps_log_gpy_block_full(const gps_log_gpy_enc_t *enc) {
+    return enc->frames >= enc->block_frames || enc->len + GPY_FRAME_V2_MAX > GPY_BLOCK_PAYLOAD_MAX;
+}
+
+size_t gps_log_gpy_block_flush(gps_log_gpy_enc_t *enc, const uint8_t **block) {
+    if (!enc->frames) {
+        return 0;
+    }
+    struct GPY_Block_Header *header = (struct GPY_Block_Header *)enc->buf;
+    header->Type_identifier = GPY_BLOCK_ID;
+    header->Frames = enc->frames;
+    header->Length = enc->len;
+    int count = sizeof(*header) + enc->len + 2;
+    Fletcher16(enc->buf, count);
+    enc->frames = 0;
+    enc->len = 0;
+    *block = enc->buf;
+    return (size_t)count;
+}
+
+void gps_log_enc_gpy_v2(gps_log_gpy_enc_t *enc, const gps_log_epoch_t *e) {
+    uint8_t *start = enc->buf + sizeof(struct GPY_Block_Header) + enc->len;
+    uint8_t *p = start + 1;
+    int32_t cog = e->heading / 1000;  // delta (course / 1000) as the compressed v1 frame
+    uint8_t mask;
+    if (enc->frames == 0) {
+        // Key frame, absolute values
+        mask = GPY_MASK_HDOP | GPY_MASK_SAT | GPY_MASK_FIX;
+        enc->time = e->utc_ms;
+        enc->lat = e->lat;
+        enc->lon = e->lon;
+        enc->dtime = enc->dlat = enc->dlon = 0;
+        p = gpy_put_svarint(p, e->utc_ms);
+        p = gpy_put_varint(p, (uint32_t)e->gspeed);
+        p = gpy_put_varint(p, e->sacc);
+        p = gpy_put_svarint(p, e->lat);
+        p = gpy_put_svarint(p, e->lon);
+        p = gpy_put_svarint(p, cog);
+    } else {
+        mask = (e->hdop != enc->hdop ? GPY_MASK_HDOP : 0) | (e->num_sv != enc->sat ? GPY_MASK_SAT : 0)
+             | (e->fix_type != enc->fix ? GPY_MASK_FIX : 0);
+        p = gpy_put_svarint(p, gpy_predict(&enc->time, &enc->dtime, e->utc_ms));
+        p = gpy_put_svarint(p, (int64_t)e->gspeed - enc->speed);
+        p = gpy_put_svarint(p, (int64_t)e->sacc - enc->speed_error);
+        p = gpy_put_svarint(p, gpy_predict(&enc->lat, &enc->dlat, e->lat));
+        p = gpy_put_svarint(p, gpy_predict(&enc->lon, &enc->dlon, e->lon));
+        p = gpy_put_svarint(p, (int64_t)cog - enc->cog);
+    }
+    if (mask & GPY_MASK_HDOP)
+        p = gpy_put_varint(p, e->hdop);
+    if (mask & GPY_MASK_SAT)
+        p = gpy_put_varint(p, e->num_sv);
+    if (mask & GPY_MASK_FIX)
+        p = gpy_put_varint(p, e->fix_type);
+    *start = mask;
+    enc->speed = e->gspeed;
+    enc->speed_error = e->sacc;
+    enc->cog = cog;
+    enc->hdop = e->hdop;
+    enc->sat = e->num_sv;
+    enc->fix = e->fix_type;
+    enc->len += p - start;
+    enc->frames++;
+}
+
+// ============================================================================
+// OAO
+// ============================================================================
+
+#define OAO_SPEED_12KN     6173  // mm/s
+#define OAO_ELEVATION_STEP 1000  // mm, climbs below are GNSS noise
+
+void gps_log_oao_checksum(uint16_t length, uint8_t *buffer) {
+    uint16_t sum = gps_log_oao_sum(buffer, length);
+    buffer[2] = sum & 0xFF;
+    buffer[3] = sum >> 8;
+}
+
+static void oao_session_update(gps_log_oao_enc_t *s, const gps_log_epoch_t *e, uint32_t speed) {
+    uint64_t utc_gnss = (uint64_t)e->utc_ms;
+    if (!utc_gnss || e->fix_type < 2) {
+        return;
+    }
+    if (s->frames++ == 0) {
+        s->start_date = utc_gnss;
+        s->start_latitude = s->minimum_latitude = s->maximum_latitude = e->lat;
+        s->start_longitude = s->minimum_longitude = s->maximum_longitude = e->lon;
+        s->start_altitude = s->minimum_altitude = s->maximum_altitude = e->hmsl;
+        s->minimum_speed = s->maximum_speed = speed;
+        s->elevation_ref = e->hmsl;
+    } else if (speed > OAO_SPEED_12KN && utc_gnss > s->end_date) {
+        uint64_t dt = utc_gnss - s->end_date;
+        s->above_12kn_ms += dt;
+        s->above_12kn_mm += (uint64_t)speed * dt / 1000U;
+    }
+    s->end_date = utc_gnss;
+    s->end_latitude = e->lat;
+    s->end_longitude = e->lon;
+    s->end_altitude = e->hmsl;
+    if (e->lat < s->minimum_latitude) s->minimum_latitude = e->lat;
+    if (e->lat > s->maximum_latitude) s->maximum_latitude = e->lat;
+    if (e->lon < s->minimum_longitude) s->minimum_longitude = e->lon;
+    if (e->lon > s->maximum_longitude) s->maximum_longitude = e->lon;
+    if (e->hmsl < s->minimum_altitude) s->minimum_altitude = e->hmsl;
+    if (e->hmsl > s->maximum_altitude) s->maximum_altitude = e->hmsl;
+    if (speed < s->minimum_speed) s->minimum_speed = speed;
+    if (speed > s->maximum_speed) s->maximum_speed = speed;
+    if (e->hmsl >= s->elevation_ref + OAO_ELEVATION_STEP) {
+        s->elevation_gain += e->hmsl - s->elevation_ref;
+        s->elevation_ref = e->hmsl;
+    } else if (e->hmsl < s->elevation_ref) {
+        s->elevation_ref = e->hmsl;
+    }
+}
+
+void gps_log_enc_oao(gps_log_oao_enc_t *enc, const gps_log_epoch_t *e, union OAO_Frame *frame) {
+    memset(frame, 0, OAO_GNSS_FRAME_LENGTH);
+    frame->mode = (uint16_t)(e->utc_ms && e->millis == 0 ? OAO_MODE_GNSS_ALIGNED : OAO_MODE_GNSS_UNALIGNED);
+    frame->latitude = e->lat;
+    frame->longitude = e->lon;
+    frame->altitude = e->hmsl;
+    frame->speed = (uint32_t)(e->gspeed < 0 ? -e->gspeed : e->gspeed);
+    oao_session_update(enc, e, frame->speed);
+    frame->heading = (uint32_t)(e->heading < 0 ? 0 : e->heading);
+    frame->utc_gnss = (uint64_t)e->utc_ms;
+    frame->fix = e->fix_type;
+    frame->satellites = e->num_sv;
+    frame->accuracy_speed = e->sacc;
+    frame->accuracy_horizontal = e->hacc;
+    frame->accuracy_vertical = e->vacc;
+    frame->accuracy_heading = e->heading_acc;
+    frame->accuracy_hDOP = e->hdop;
+    gps_log_oao_checksum(OAO_GNSS_FRAME_LENGTH, frame->bytes_gnss);
+}
+
+void gps_log_enc_oao_header(const gps_log_oao_enc_t *s, uint32_t distance, union OAO_Header *header) {
+    memset(header, 0, sizeof(*header));
+    header->mode = OAO_MODE_HEADER;
+    header->start_date = s->start_date;
+    header->start_latitude = s->start_latitude;
+    header->start_longitude = s->start_longitude;
+    header->start_altitude = s->start_altitude;
+    header->end_date = s->end_date;
+    header->end_latitude = s->end_latitude;
+    header->end_longitude = s->end_longitude;
+    header->end_altitude = s->end_altitude;
+    header->distance = distance;
+    header->minimum_latitude = s->minimum_latitude;
+    header->minimum_longitude = s->minimum_longitude;
+    header->minimum_altitude = s->minimum_altitude;
+    header->minimum_speed = s->minimum_speed;
+    header->maximum_latitude = s->maximum_latitude;
+    header->maximum_longitude = s->maximum_longitude;
+    header->maximum_altitude = s->maximum_altitude;
+    header->maximum_speed = s->maximum_speed;
+    header->above_12kn = (uint32_t)(s->above_12kn_mm / 1000U);  // m
+    header->above_12kn_seconds = (uint32_t)(s->above_12kn_ms / 1000U);
+    header->elevation_gain = (uint32_t)s->elevation_gain;
+}
+
+// ============================================================================
+// GPX
+// ============================================================================
+
+static const char gpx_digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+#define GPX_PUT(p, lit) (memcpy((p), (lit), sizeof(lit) - 1), (p) + sizeof(lit) - 1)
+
+static inline char *gpx_put_2(char *p, uint32_t value) {
+    memcpy(p, &gpx_digit_pairs[value * 2], 2);
+    return p + 2;
+}
+
+static char *gpx_put_u(char *p, uint32_t value) {
+    char tmp[10];
+    char *t = tmp + sizeof(tmp);
+    while (value >= 100U) {
+        t -= 2;
+        memcpy(t, &gpx_digit_pairs[(value % 100U) * 2], 2);
+        value /= 100U;
+    }
+    if (value >= 10U) {
+        t -= 2;
+        memcpy(t, &gpx_digit_pairs[value * 2], 2);
+    } else {
+        *--t = (char)('0' + value);
+    }
+    size_t n = (size_t)(tmp + sizeof(tmp) - t);
+    memcpy(p, t, n);
+    return p + n;
+}
+
+static char *gpx_put_i(char *p, int32_t value) {
+    if (value < 0) {
+        *p++ = '-';
+        return gpx_put_u(p, 0U - (uint32_t)value);
+    }
+    return gpx_put_u(p, (uint32_t)value);
+}
+
+static char *gpx_put_coordinate(char *p, int32_t value) {
+    uint32_t abs_value = (uint32_t)value;
+    if (value < 0) {
+        *p++ = '-';
+        abs_value = 0U - abs_value;
+    }
+    p = gpx_put_u(p, abs_value / 10000000U);
+    *p++ = '.';
+    uint32_t fraction = abs_value % 10000000U;  // 7 digits
+    *p++ = (char)('0' + fraction / 1000000U);
+    fraction %= 1000000U;
+    p = gpx_put_2(p, fraction / 10000U);
+    p = gpx_put_2(p, fraction / 100U % 100U);
+    return gpx_put_2(p, fraction % 100U);
+}
+
+/**
+ * @brief value / 100 with two decimals
+ */
+static char *gpx_put_centi(char *p, uint32_t value) {
+    p = gpx_put_u(p, value / 100U);
+    *p++ = '.';
+    return gpx_put_2(p, value % 100U);
+}
+
+static char *gpx_put_timestamp(char *p, const gps_log_epoch_t *e, bool millis) {
+    p = gpx_put_2(p, e->year / 100U % 100U);
+    p = gpx_put_2(p, e->year % 100U);
+    *p++ = '-';
+    p = gpx_put_2(p, e->month % 100U);
+    *p++ = '-';
+    p = gpx_put_2(p, e->day % 100U);
+    *p++ = 'T';
+    p = gpx_put_2(p, e->hour % 100U);
+    *p++ = ':';
+    p = gpx_put_2(p, e->minute % 100U);
+    *p++ = ':';
+    p = gpx_put_2(p, e->second % 100U);
+    if (millis) {
+        *p++ = '.';
+        *p++ = (char)('0' + e->millis / 100U % 10U);
+        p = gpx_put_2(p, e->millis % 100U);
+    }
+    *p++ = 'Z';
+    return p;
+}
+
+size_t gps_log_enc_gpx(char *out, const gps_log_epoch_t *e, bool millis) {
+    uint32_t speed_abs = (uint32_t)(e->gspeed < 0 ? -e->gspeed : e->gspeed);
+    char *p = GPX_PUT(out, "<trkpt lat=\"");
+    p = gpx_put_coordinate(p, e->lat);
+    p = GPX_PUT(p, "\" lon=\"");
+    p = gpx_put_coordinate(p, e->lon);
+    p = GPX_PUT(p, "\"><ele>");
+    p = gpx_put_i(p, e->hmsl / 1000);  // mm -> m
+    p = GPX_PUT(p, "</ele><time>");
+    p = gpx_put_timestamp(p, e, millis);
+    p = GPX_PUT(p, "</time><course>");
+    p = gpx_put_i(p, e->heading / 100000);  // 1e-5 deg -> deg
+    p = GPX_PUT(p, "</course><speed>");
+    p = gpx_put_centi(p, speed_abs / 10U);  // mm/s -> m/s, 2 decimals
+    p = GPX_PUT(p, "</speed><sat>");
+    p = gpx_put_u(p, e->num_sv);
+    p = GPX_PUT(p, "</sat><hdop>");
+    p = gpx_put_centi(p, e->hdop);
+    p = GPX_PUT(p, "</hdop></trkpt>\n");
+    return (size_t)(p - out);
+}
@@ -2,10 +2,12 @@
 
 #if (defined(CONFIG_UBLOX_ENABLED) && defined(CONFIG_GPS_LOG_ENABLED))
 
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/stat.h>
 #include <sys/unistd.h>
 #include <math.h>
@@ -14,11 +16,11 @@
 
 #include <esp_mac.h>
 #include <esp_heap_caps.h>
+#include <esp_timer.h>
 
 #include "gps_log.h"
 // #include "esp_log.h"
 #include "logger_buffer_pool.h"
-#include "logger_fixed_pool.h"
 
 #include "strbf.h"
 #include "numstr.h"
@@ -28,16 +30,27 @@
 #include "oao.h"
 #endif
 #include "sbp.h"
+#include "gps_log_encode.h"
 #if defined(GPS_LOG_HAS_GPY)
 #include "gpy.h"
 #endif
+#if defined(GPS_LOG_HAS_CHUNKS)
+#include <esp_rom_crc.h>
+#include "gps_log_container.h"
+#endif
+#if defined(CONFIG_GPS_LOG_UBZ)
+#include "ubz.h"
+#endif
+#if defined(CONFIG_GPS_LOG_INDEX)
+#include "gps_log_index.h"
+#endif
 #include "vfs.h"
 #include "vfs_events.h"
 #include "context.h"
 
 // #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 static const char *TAG = "gps_log";
 
@@ -58,54 +71,201 @@ static const char *TAG = "gps_log";
     #define ASYNC_WRITER_BUFFER_SIZE    4096   // Default to 4KB for modern cards
 #endif
 
-#define ASYNC_WRITER_QUEUE_DEPTH    16     // Queue depth for 1x20Hz = 20 writes/sec
 #define ASYNC_WRITER_FLUSH_TIMEOUT_MS 1000 // Flush buffer after 1 second if not full
-
-typedef enum {
-    ASYNC_WRITE_REQUEST_DATA,     // Write data to buffer
-    ASYNC_WRITE_REQUEST_FLUSH,    // Force buffer flush
-    ASYNC_WRITE_REQUEST_CLOSE,    // Close file and cleanup
-} async_write_request_type_t;
+#define ASYNC_WRITER_LOCK_TIMEOUT_MS  250  // Producer wait for the ring lock (writer start/stop, flush)
 
 // ============================================================================
-// ASYNC WRITE POOL - Pre-allocated fixed-size blocks eliminate hot-path malloc.
-// GPS frames: UBX/SBP typically <128B, GPX text <400B; 512B covers all cases.
-// 16 blocks x 512B = 8KB static DRAM; zero alloc/free on GPS hot path.
+// PER-FILE WRITE RINGS - frames are encoded in place, no intermediate copies.
+// Every open file owns a ring of sector-sized slots. A producer reserves room
+// in the open slot with log_reserve(), encodes the frame straight into it and
+// publishes it with log_commit(). When the next frame does not fit (or on
+// flush/deadline) the slot is sealed and the writer task write()s it directly
+// from the ring. log_write() is reserve + memcpy + commit for callers that
+// already hold the bytes (TXT, UBX NAV-SAT).
+// Single consumer (writer task). Producers (GPS task, VFS worker writing TXT)
+// are serialized by a recursive lock that log_to_file() holds for a whole
+// epoch, so the per-frame lock in reserve is only a counter increment.
+// A full ring drops the frame instead of writing synchronously, which would
+// put it in the file ahead of still buffered data.
+// Ring depth is configured per format (CONFIG_GPS_LOG_RING_SLOTS_*): while the
+// writer is stuck in a card stall of slots-1 slot fill times the producer
+// keeps encoding into the remaining slots.
 // ============================================================================
-#define ASYNC_POOL_BLOCK_SIZE   512   // Max GPS frame (covers GPX text ~400B)
-#define ASYNC_POOL_BLOCK_COUNT  16    // Matches QUEUE_DEPTH; total pool = 8KB
+#define ASYNC_RING_SLOTS_MAX 16
+#define ASYNC_WRITER_STALL_MS 100  // write() slower than this counts as a card stall
+#define LOG_SYNC_FRAME_SIZE 512  // Largest in-place frame while the writer is stopped (GPX 384B)
+#if defined(GPS_LOG_HAS_CHUNKS)
+#define LOG_CHUNK_HEADER_SIZE sizeof(struct GLC_Chunk_Header)
+#else
+#define LOG_CHUNK_HEADER_SIZE 0
+#endif
+// Payload room of a ring slot, with framed writes the chunk header precedes it
+#define ASYNC_SLOT_PAYLOAD (ASYNC_WRITER_BUFFER_SIZE - LOG_CHUNK_HEADER_SIZE)
 
 typedef struct {
-    uint8_t data[ASYNC_POOL_BLOCK_SIZE];
-    size_t  len;                  // Actual data length in this block
-} async_pool_block_t;
+    uint8_t *storage;                     // slots * ASYNC_WRITER_BUFFER_SIZE
+    uint8_t slots;                        // Ring depth of this file
+    uint8_t backlog_max;                  // Most sealed slots waiting for the writer
+    uint16_t slot_len[ASYNC_RING_SLOTS_MAX]; // Payload bytes in each sealed slot
+    TickType_t slot_tick[ASYNC_RING_SLOTS_MAX]; // First commit into each sealed slot
+    uint8_t slot_flags[ASYNC_RING_SLOTS_MAX]; // RING_SLOT_* of each sealed slot
+    uint8_t open_flags;                   // RING_SLOT_* for the open slot, applied at seal
+    atomic_uint head;                     // Slots sealed by producers (free running)
+    atomic_uint tail;                     // Slots written by the writer (free running)
+    atomic_uint fill;                     // Bytes committed to the open slot
+    TickType_t dirty_tick;                // When the open slot received its first byte
+    uint32_t dropped;                     // Frames dropped on a full ring
+    uint32_t stalls;                      // write() calls over ASYNC_WRITER_STALL_MS
+    uint32_t stall_max_ms;                // Longest single write()
+    uint32_t stall_total_ms;              // Time spent in stalled write() calls
+} file_write_ring_t;
+
+#define RING_SLOT_SEGMENT 0x01  // Slot starts a new file segment, the writer switches fd first
+
+static const uint8_t async_ring_depth[sd_log_end] = {
+    [sd_log_txt] = CONFIG_GPS_LOG_RING_SLOTS_TXT,
+    [sd_log_sbp] = CONFIG_GPS_LOG_RING_SLOTS_SBP,
+    [sd_log_ubx] = CONFIG_GPS_LOG_RING_SLOTS_UBX,
+    [sd_log_gpx] = CONFIG_GPS_LOG_RING_SLOTS_GPX,
+#if defined(GPS_LOG_HAS_OAO)
+    [sd_log_oao] = CONFIG_GPS_LOG_RING_SLOTS_OAO,
+#endif
+#if defined(GPS_LOG_HAS_GPY)
+    [sd_log_gpy] = CONFIG_GPS_LOG_RING_SLOTS_GPY,
+#endif
+};
 
+static TaskHandle_t async_writer_task_handle = NULL;
+static file_write_ring_t file_rings[sd_log_end] = {0}; // Max 6 file types (UBX, SBP, GPX, OAO, GPY, TXT)
+static atomic_bool async_writer_running = false;
+// Writer sleeps on a task notification: producers only wake it when a slot is
+// sealed or when it is idle (no deadline armed) and a ring turns dirty.
+static atomic_bool async_writer_idle = false;
+static uint32_t async_writer_wakeups = 0;
+static uint32_t async_writer_slots = 0;       // Slots written
+static uint32_t async_writer_stack_free = 0;  // Stack high water mark at the last writer exit
+
+// Producer side lock, created once by open_files()
+static SemaphoreHandle_t log_producer_mutex = NULL;
+// In-place frame buffer used while the writer is not running, guarded by the producer lock
+static uint8_t log_sync_frame[LOG_CHUNK_HEADER_SIZE + LOG_SYNC_FRAME_SIZE];
+
+// ============================================================================
+// DURABILITY SCHEDULER - bounded data loss on power cut.
+// Every format has a loss window (CONFIG_GPS_LOG_LOSS_WINDOW_*): data committed
+// to a file is fsync()ed within that time. The writer arms a deadline when a
+// synced file receives data and, ahead of the deadline by the measured sync
+// cost, seals and writes the open slot and fsyncs the file. At most one file is
+// synced per wakeup so syncs of different files never share a tick. When the
+// measured sync cost of all files would exceed CONFIG_GPS_LOG_SYNC_BUDGET_PERCENT
+// of the time, all windows are stretched until it fits (counted as late syncs).
+// A window of 0 leaves the file to the periodic flush_files().
+// ============================================================================
 typedef struct {
-    async_write_request_type_t type;
-    uint8_t file_index;           // sd_log_ubx, sd_log_sbp, etc.
-    async_pool_block_t *block;    // DATA: borrowed pool block; NULL for FLUSH/CLOSE
-} async_write_request_t;
+    uint32_t window_ms;           // Configured loss window, 0 = not scheduled
+    uint32_t cost_us;             // Moving average of fsync() duration
+    uint32_t cost_max_us;
+    uint32_t syncs;
+    uint32_t late;                // Syncs that completed after the loss window
+    TickType_t dirty_since;       // Oldest commit not yet synced
+    TickType_t due;               // Sync deadline while armed
+    bool armed;
+    bool written;                 // Data written since the last sync
+} file_sync_t;
+
+static const uint16_t async_loss_window_s[sd_log_end] = {
+    [sd_log_txt] = CONFIG_GPS_LOG_LOSS_WINDOW_TXT,
+    [sd_log_sbp] = CONFIG_GPS_LOG_LOSS_WINDOW_SBP,
+    [sd_log_ubx] = CONFIG_GPS_LOG_LOSS_WINDOW_UBX,
+    [sd_log_gpx] = CONFIG_GPS_LOG_LOSS_WINDOW_GPX,
+#if defined(GPS_LOG_HAS_OAO)
+    [sd_log_oao] = CONFIG_GPS_LOG_LOSS_WINDOW_OAO,
+#endif
+#if defined(GPS_LOG_HAS_GPY)
+    [sd_log_gpy] = CONFIG_GPS_LOG_LOSS_WINDOW_GPY,
+#endif
+};
 
-// Per-file write buffer state
+static file_sync_t file_syncs[sd_log_end] = {0};
+static uint32_t sync_stretch_pct = 100;       // Window scale to stay in the I/O budget
+
+// ============================================================================
+// I/O TELEMETRY - per file since open_files(), ring or synchronous path alike.
+// bytes_out / bytes_in is the write amplification (chunk headers, partial
+// slots) or compression, write and fsync latency is what the card gave us.
+// Read with gps_log_file_get_io_stats(), appended to the TXT session summary.
+// ============================================================================
 typedef struct {
-    uint8_t *buffer;              // 4KB buffer (malloc'd)
-    size_t buffer_used;           // Bytes used in buffer
-    TickType_t last_write_tick;   // Last write timestamp for timeout flush
-} file_write_buffer_t;
+    uint64_t bytes_in;            // Bytes committed by the encoders
+    uint64_t bytes_out;           // Bytes passed to write()
+    uint64_t write_us;            // Time in write()
+    uint64_t sync_us;             // Time in fsync()
+    uint32_t writes;
+    uint32_t write_max_us;
+    uint32_t timeout_flushes;     // Partial slots sealed by the flush timeout
+    uint32_t syncs;
+    uint32_t sync_max_us;
+} file_io_t;
+
+static file_io_t file_io[sd_log_end] = {0};
 
-static QueueHandle_t async_writer_queue = NULL;
-static TaskHandle_t async_writer_task_handle = NULL;
-static file_write_buffer_t file_buffers[sd_log_end] = {0}; // Max 6 file types (UBX, SBP, GPX, OAO, GPY, TXT)
-static atomic_bool async_writer_running = false;
+/**
+ * @brief write() with I/O accounting
+ */
+static ssize_t log_io_write(uint8_t file_index, int fd, const void *buf, size_t len) {
+    file_io_t *io = &file_io[file_index];
+    int64_t start_us = esp_timer_get_time();
+    ssize_t written = write(fd, buf, len);
+    uint32_t write_us = (uint32_t)(esp_timer_get_time() - start_us);
+    io->writes++;
+    io->write_us += write_us;
+    if (write_us > io->write_max_us) {
+        io->write_max_us = write_us;
+    }
+    if (written > 0) {
+        io->bytes_out += (size_t)written;
+    }
+    return written;
+}
 
-// Pool storage - dynamically allocated on init, freed on stop; lifecycle managed by logger_fixed_pool
-static async_pool_block_t *async_pool_storage = NULL;
-static logger_fixed_pool_t async_pool = {0};
+/**
+ * @brief fsync() with I/O accounting
+ * @param duration_us optional, receives the fsync() duration
+ */
+static int log_io_fsync(uint8_t file_index, int fd, uint32_t *duration_us) {
+    file_io_t *io = &file_io[file_index];
+    int64_t start_us = esp_timer_get_time();
+    int result = fsync(fd);
+    if (result < 0) {
+        ELOG(TAG, "Failed to sync (%s) %" PRIu8, strerror(errno), file_index);
+    }
+    uint32_t sync_us = (uint32_t)(esp_timer_get_time() - start_us);
+    io->syncs++;
+    io->sync_us += sync_us;
+    if (sync_us > io->sync_max_us) {
+        io->sync_max_us = sync_us;
+    }
+    if (duration_us) {
+        *duration_us = sync_us;
+    }
+    return result;
+}
 
 // Forward declarations
 static void async_writer_task(void *arg);
-static esp_err_t async_writer_flush_buffer(uint8_t file_index);
-static esp_err_t async_writer_write_buffered(uint8_t file_index, const uint8_t *data, size_t len);
+static void log_rate_reset(void);
+#if defined(CONFIG_GPS_LOG_SHED_ENABLED)
+static void log_shed_reset(void);
+static void log_shed_close(void);
+static void log_shed_print_stats(void);
+#endif
+#if defined(CONFIG_GPS_LOG_SEGMENT_ENABLED)
+static void write_log_file_header(gps_context_t *context, uint8_t file_index);
+static void log_segment_bytes(uint8_t file_index, size_t len);
+#endif
+#if defined(CONFIG_GPS_LOG_SEGMENT_ENABLED) && defined(CONFIG_GPS_LOG_INDEX)
+static void log_idx_segment(uint8_t file_index, uint8_t n);
+#endif
 
 // Definitions for functions declared in log_private.h
 float get_spd(float b) {
@@ -179,6 +339,23 @@ static bool gps_log_file_is_enabled(const cfg_gps_log_enables_t *enables,
     }
 }
 
+static const char *log_file_ext(uint8_t file_index) {
+#if defined(CONFIG_GPS_LOG_UBZ)
+    return file_index == sd_log_ubx ? ".ubz"
+#else
+    return file_index == sd_log_ubx ? ".ubx"
+#endif
+        : file_index == sd_log_sbp ? ".sbp"
+        : file_index == sd_log_gpx ? ".gpx"
+#if defined(GPS_LOG_HAS_OAO)
+        : file_index == sd_log_oao ? ".oao"
+#endif
+#if defined(GPS_LOG_HAS_GPY)
+        : file_index == sd_log_gpy ? ".gpy"
+#endif
+        : ".txt";
+}
+
 void gps_config_fix_values(void) {
     FUNC_ENTRY(TAG);
     gps_log_sync_bits_from_config(&log_config);
@@ -206,378 +383,1802 @@ static float get_avg(const gps_run_t *b) {
 // ASYNC WRITER IMPLEMENTATION - FAT-optimized buffered I/O
 // ============================================================================
 
+static inline uint8_t *ring_slot(const file_write_ring_t *r, unsigned n) {
+    return r->storage + (n % r->slots) * ASYNC_WRITER_BUFFER_SIZE;
+}
+
+static bool log_producer_lock(TickType_t wait) {
+    return log_producer_mutex && xSemaphoreTakeRecursive(log_producer_mutex, wait) == pdTRUE;
+}
+
+static void log_producer_unlock(void) {
+    xSemaphoreGiveRecursive(log_producer_mutex);
+}
+
 /**
- * @brief Flush write buffer to file
- * Must be called from async writer task only
+ * @brief Hand the open slot to the writer
+ * Caller holds the producer lock (or is the writer while async_writer_stop() holds it).
  */
-static esp_err_t async_writer_flush_buffer(uint8_t file_index) {
-    if (file_index >= sd_log_end) return ESP_ERR_INVALID_ARG;
-
-    file_write_buffer_t *fb = &file_buffers[file_index];
-    if (!fb->buffer || fb->buffer_used == 0) {
-        return ESP_OK; // Nothing to flush
+static void ring_seal(file_write_ring_t *r) {
+    unsigned fill = atomic_load(&r->fill);
+    if (fill == 0) {
+        return;
     }
-
-    int fd = GET_FD(file_index);
-    if (fd < 0) {
-        ELOG(TAG, "Invalid FD for file %"PRIu8, file_index);
-        return ESP_ERR_INVALID_STATE;
+    unsigned head = atomic_load(&r->head);
+    r->slot_len[head % r->slots] = (uint16_t)fill;
+    r->slot_tick[head % r->slots] = r->dirty_tick;
+    r->slot_flags[head % r->slots] = r->open_flags;
+    r->open_flags = 0;
+#if defined(CONFIG_GPS_LOG_SEGMENT_ENABLED)
+    log_segment_bytes((uint8_t)(r - file_rings), fill);
+#endif
+    atomic_store(&r->fill, 0);
+    atomic_store(&r->head, head + 1);
+    unsigned backlog = head + 1 - atomic_load(&r->tail);
+    if (backlog > r->backlog_max) {
+        r->backlog_max = (uint8_t)backlog;
     }
+}
 
-    // Perform synchronous write (we're in dedicated writer task)
-    ssize_t written = write(fd, fb->buffer, fb->buffer_used);
-    if (written != fb->buffer_used) {
-        ELOG(TAG, "Flush failed for file %"PRIu8": wrote %zu of %zu bytes (%s)", 
-             file_index, written, fb->buffer_used, strerror(errno));
-        return ESP_FAIL;
-    }
+#if defined(CONFIG_GPS_LOG_PREALLOCATE)
+// ============================================================================
+// FILE PREALLOCATION - reserve the cluster chain up front.
+// Growing a file sector by sector makes FAT extend the cluster chain and
+// rewrite the FAT table in the middle of a session, which shows up as write
+// latency spikes. open_files() writes zeros up to the estimated session size
+// (the FAT VFS refuses to extend a file with ftruncate, f_expand only takes
+// empty files and leaves stale data in the tail) and reopens the file without
+// O_APPEND at its logical end. The writer keeps a chunk reserved ahead in
+// small top-ups, log_close() truncates to the real length. A marker names
+// the session while files are preallocated, so the next start cuts the zero
+// tail a power cut left behind.
+// ============================================================================
+#define FILE_UPDATE "r+"
+#define LOG_PREALLOC_CHUNK ((size_t)CONFIG_GPS_LOG_PREALLOC_CHUNK_KB * 1024)
+#define LOG_PREALLOC_STEP ((size_t)32 * 1024)  // Zeros written by the writer per top-up
+#define LOG_PREALLOC_BLOCK 4096                // Zero and tail scan buffer
+#define LOG_PREALLOC_MARKER "prealloc.cur"
 
-    DLOG(TAG, "Flushed %zu bytes to file %"PRIu8, fb->buffer_used, file_index);
-    fb->buffer_used = 0;
-    fb->last_write_tick = xTaskGetTickCount();
+static size_t file_alloc[sd_log_end] = {0}; // Preallocated size, 0 if not preallocated
 
-    return ESP_OK;
+/**
+ * @brief Estimated session size of a format at the current output rate
+ */
+static size_t log_prealloc_estimate(uint8_t file_index) {
+    size_t rate = ubx_get_effective_output_rate();
+    size_t per_second = file_index == sd_log_ubx ? 128 * rate + 512  // PVT+DOP per epoch, NAV-SAT
+                      : file_index == sd_log_sbp ? 32 * rate
+                      : file_index == sd_log_gpx ? 256                // 1 point per second
+#if defined(GPS_LOG_HAS_OAO)
+                      : file_index == sd_log_oao ? 52 * rate
+#endif
+#if defined(GPS_LOG_HAS_GPY)
+                      : file_index == sd_log_gpy ? 24 * rate          // mostly compressed frames
+#endif
+                      : 64;
+    size_t size = per_second * CONFIG_GPS_LOG_PREALLOC_MINUTES * 60;
+    return (size + LOG_PREALLOC_CHUNK - 1) / LOG_PREALLOC_CHUNK * LOG_PREALLOC_CHUNK;
 }
 
 /**
- * @brief Write data to buffer, flushing if full
- * Must be called from async writer task only
+ * @brief Write zeros from the end of the data up to size, the position is left at from
+ * @return true if the whole range was written
  */
-static esp_err_t async_writer_write_buffered(uint8_t file_index, const uint8_t *data, size_t len) {
-    if (file_index >= sd_log_end || !data || len == 0) return ESP_ERR_INVALID_ARG;
-
-    file_write_buffer_t *fb = &file_buffers[file_index];
+static bool log_prealloc_fill(int fd, size_t from, size_t size) {
+    uint8_t *zeros = calloc(1, LOG_PREALLOC_BLOCK);
+    bool ok = zeros && lseek(fd, (off_t)from, SEEK_SET) == (off_t)from;
+    for (size_t pos = from; ok && pos < size;) {
+        size_t n = size - pos < LOG_PREALLOC_BLOCK ? size - pos : LOG_PREALLOC_BLOCK;
+        ok = write(fd, zeros, n) == (ssize_t)n;
+        pos += n;
+    }
+    free(zeros);
+    if (lseek(fd, (off_t)from, SEEK_SET) != (off_t)from) {
+        ok = false;
+    }
+    return ok;
+}
 
-    // Allocate buffer on first write
-    if (!fb->buffer) {
-        /* Prefer internal DRAM; fall back to DEFAULT (may include SPIRAM) */
-        fb->buffer = (uint8_t *)heap_caps_malloc(ASYNC_WRITER_BUFFER_SIZE, buffer_caps);
-        if (!fb->buffer) {
-            ELOG(TAG, "Failed to allocate %dB buffer for file %"PRIu8, ASYNC_WRITER_BUFFER_SIZE, file_index);
-            return ESP_ERR_NO_MEM;
+/**
+ * @brief Extend an opened (and headed) log file to its estimated size
+ * Reopens the file for update positioned at its logical end.
+ * @return the new file descriptor, -1 if the reopen failed
+ */
+static int log_preallocate(const char *filename, const char *base_path, int fd,
+                           size_t estimate, size_t *alloc) {
+    struct stat file_stat = {0};
+    if (fd < 0 || fstat(fd, &file_stat) != 0) {
+        return fd;
+    }
+    close(fd);
+    fd = s_open(filename, base_path, FILE_UPDATE);
+    if (fd < 0) {
+        ELOG(TAG, "Reopen for preallocation failed: %s", filename);
+        return fd;
+    }
+    size_t length = (size_t)file_stat.st_size;
+    size_t size = length + estimate;
+    int64_t start_us = esp_timer_get_time();
+    if (!log_prealloc_fill(fd, length, size)) {
+        WLOG(TAG, "Preallocation of %zu bytes failed (%s) %s", size, strerror(errno), filename);
+        // Drop a partial reserve, the file continues at its logical end
+        if (ftruncate(fd, (off_t)length) != 0 || lseek(fd, (off_t)length, SEEK_SET) != (off_t)length) {
+            ELOG(TAG, "Truncate to logical length failed (%s) %s", strerror(errno), filename);
         }
-        fb->buffer_used = 0;
-        fb->last_write_tick = xTaskGetTickCount();
-        ILOG(TAG, "Allocated %dB write buffer for file %"PRIu8, ASYNC_WRITER_BUFFER_SIZE, file_index);
+        return fd;
     }
+    fsync(fd);  // cluster chain and FAT table written now, not mid-session
+    *alloc = size;
+    ILOG(TAG, "Preallocated %s: %zu bytes in %" PRId64 "ms", filename,
+         size, (esp_timer_get_time() - start_us) / 1000);
+    return fd;
+}
 
-    size_t bytes_written = 0;
-    while (bytes_written < len) {
-        size_t space_available = ASYNC_WRITER_BUFFER_SIZE - fb->buffer_used;
-        size_t bytes_to_copy = (len - bytes_written) < space_available ? 
-                               (len - bytes_written) : space_available;
-
-        memcpy(fb->buffer + fb->buffer_used, data + bytes_written, bytes_to_copy);
-        fb->buffer_used += bytes_to_copy;
-        bytes_written += bytes_to_copy;
+/**
+ * @brief Cut the preallocated tail at the logical end before close
+ */
+static void log_prealloc_trim(size_t *alloc, int fd) {
+    if (!*alloc) {
+        return;
+    }
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    if (pos < 0 || ftruncate(fd, pos) != 0) {
+        ELOG(TAG, "Truncate to logical length failed (%s) fd %d", strerror(errno), fd);
+    }
+    *alloc = 0;
+}
 
-        // Flush if buffer full
-        if (fb->buffer_used >= ASYNC_WRITER_BUFFER_SIZE) {
-            esp_err_t err = async_writer_flush_buffer(file_index);
-            if (err != ESP_OK) {
-                return err;
-            }
-        }
+/**
+ * @brief Keep a chunk reserved ahead of the next write
+ * Called from the writer task, so the FAT update stays off the GPS task. Tops up
+ * by LOG_PREALLOC_STEP (or what the write needs) per call to keep each stall short.
+ */
+static void log_prealloc_extend(size_t *alloc, int fd, size_t len) {
+    if (!*alloc) {
+        return;
+    }
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    if (pos < 0 || (size_t)pos + len + LOG_PREALLOC_CHUNK <= *alloc) {
+        return;
+    }
+    size_t size = *alloc + LOG_PREALLOC_STEP;
+    if (size < (size_t)pos + len) {
+        size = (size_t)pos + len;
     }
+    bool ok = log_prealloc_fill(fd, *alloc, size);
+    if (lseek(fd, pos, SEEK_SET) != pos) {
+        ELOG(TAG, "Seek back to %ld failed (%s) fd %d", (long)pos, strerror(errno), fd);
+    }
+    *alloc = size;
+    if (ok) {
+        DLOG(TAG, "Extended preallocation of fd %d to %zu bytes", fd, size);
+    } else {
+        // Cut what was written past the data, FAT grows the file per write from here on
+        WLOG(TAG, "Preallocation top-up failed (%s) fd %d", strerror(errno), fd);
+        log_prealloc_trim(alloc, fd);
+    }
+}
 
-    fb->last_write_tick = xTaskGetTickCount();
-    return ESP_OK;
+static void log_prealloc_marker_path(char *path, size_t size, const char *base_path) {
+    snprintf(path, size, "%s/%s", base_path, LOG_PREALLOC_MARKER);
 }
 
 /**
- * @brief Async writer task - processes write requests from queue
+ * @brief Cut the zero filled tail of a file preallocated before a power cut
+ * The log ends at its last non-zero byte; a record ending in zero bytes loses them
+ * and reads as the torn last record it would be without preallocation.
+ * @return false if the file does not exist
  */
-static void async_writer_task(void *arg) {
-    ILOG(TAG, "Async writer task started");
-    async_write_request_t req;
-    TickType_t last_timeout_check = xTaskGetTickCount();
-
-    while (async_writer_running) {
-        // Wait for request with timeout for periodic flush check
-        if (xQueueReceive(async_writer_queue, &req, pdMS_TO_TICKS(100)) == pdTRUE) {
-            switch (req.type) {
-                case ASYNC_WRITE_REQUEST_DATA:
-                    if (req.block) {
-                        if (req.block->len > 0) {
-                            async_writer_write_buffered(req.file_index,
-                                                        req.block->data, req.block->len);
-                        }
-                        logger_fixed_pool_free(&async_pool, req.block);  // Return block to pool (O(1))
-                        req.block = NULL;
-                    }
-                    break;
-
-                case ASYNC_WRITE_REQUEST_FLUSH:
-                    async_writer_flush_buffer(req.file_index);
-                    break;
-
-                case ASYNC_WRITE_REQUEST_CLOSE:
-                    // Flush before closing
-                    async_writer_flush_buffer(req.file_index);
-                    // Free buffer
-                    if (file_buffers[req.file_index].buffer) {
-                        heap_caps_free(file_buffers[req.file_index].buffer);
-                        file_buffers[req.file_index].buffer = NULL;
-                        file_buffers[req.file_index].buffer_used = 0;
-                    }
-                    break;
-            }
+static bool log_prealloc_cut(const char *path, uint8_t *buf) {
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        return false;
+    }
+    off_t size = lseek(fd, 0, SEEK_END);
+    off_t end = size;
+    while (end > 0) {
+        off_t from = end > LOG_PREALLOC_BLOCK ? end - LOG_PREALLOC_BLOCK : 0;
+        ssize_t n = end - from;
+        if (lseek(fd, from, SEEK_SET) != from || read(fd, buf, n) != n) {
+            ELOG(TAG, "Tail of %s not read (%s)", path, strerror(errno));
+            end = size;
+            break;
+        }
+        while (n > 0 && buf[n - 1] == 0) {
+            n--;
+        }
+        end = from + n;
+        if (n > 0) {
+            break;
+        }
+    }
+    if (end < size) {
+        if (ftruncate(fd, end) == 0) {
+            ILOG(TAG, "Cut %ld preallocated bytes of %s", (long)(size - end), path);
+        } else {
+            ELOG(TAG, "Cut of %s failed (%s)", path, strerror(errno));
         }
+    }
+    close(fd);
+    return true;
+}
 
-        // Periodic timeout flush check (every 100ms)
-        TickType_t now = xTaskGetTickCount();
-        if ((now - last_timeout_check) >= pdMS_TO_TICKS(100)) {
+/**
+ * @brief Cut the zero tails of a session whose marker a power cut left behind
+ * Called by open_files() before any file is opened, so an appending session
+ * continues after the data and not after the zeros.
+ */
+static void log_prealloc_recover(const char *base_path) {
+    char marker[ESP_VFS_PATH_MAX + PATH_MAX_CHAR_SIZE + 2];
+    char name[PATH_MAX_CHAR_SIZE] = {0};
+    log_prealloc_marker_path(marker, sizeof(marker), base_path);
+    int fd = open(marker, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    ssize_t n = read(fd, name, sizeof(name) - 1);
+    close(fd);
+    size_t size = ESP_VFS_PATH_MAX + PATH_MAX_CHAR_SIZE + 16;
+    uint8_t *buf = n > 0 ? malloc(LOG_PREALLOC_BLOCK) : NULL;
+    char *path = buf ? malloc(size) : NULL;  // off the stack of the caller
+    if (path) {
+        int64_t start_us = esp_timer_get_time();
+#if defined(CONFIG_GPS_LOG_CONTAINER)
+        snprintf(path, size, "%s/%s.glc", base_path, name);
+        log_prealloc_cut(path, buf);
+#else
+        // The session files, then its segments up to the first number without any file
+        for (unsigned seg = 0; seg <= UINT8_MAX; seg++) {
+            bool found = false;
             for (uint8_t i = 0; i < sd_log_end; i++) {
-                file_write_buffer_t *fb = &file_buffers[i];
-                if (fb->buffer && fb->buffer_used > 0) {
-                    // Flush if data older than timeout threshold
-                    if ((now - fb->last_write_tick) >= pdMS_TO_TICKS(ASYNC_WRITER_FLUSH_TIMEOUT_MS)) {
-                        DLOG(TAG, "Timeout flush for file %d (%zu bytes)", i, fb->buffer_used);
-                        async_writer_flush_buffer(i);
-                    }
+                if (seg) {
+                    snprintf(path, size, "%s/%s_s%02u%s", base_path, name, seg, log_file_ext(i));
+                } else {
+                    snprintf(path, size, "%s/%s%s", base_path, name, log_file_ext(i));
                 }
+                found |= log_prealloc_cut(path, buf);
+            }
+            if (seg && !found) {
+                break;
             }
-            last_timeout_check = now;
         }
+#endif
+        ILOG(TAG, "Preallocated session %s recovered in %" PRId64 "ms", name,
+             (esp_timer_get_time() - start_us) / 1000);
     }
+    free(path);
+    free(buf);
+    unlink(marker);
+}
 
-    // Cleanup on exit: flush all buffers
-    for (uint8_t i = 0; i < sd_log_end; i++) {
-        if (file_buffers[i].buffer) {
-            async_writer_flush_buffer(i);
-            heap_caps_free(file_buffers[i].buffer);
-            file_buffers[i].buffer = NULL;
-            file_buffers[i].buffer_used = 0;
-        }
+/**
+ * @brief Name the session in the marker while its files carry a preallocated tail
+ */
+static void log_prealloc_mark(const gps_log_file_config_t *config) {
+    char marker[ESP_VFS_PATH_MAX + PATH_MAX_CHAR_SIZE + 2];
+    log_prealloc_marker_path(marker, sizeof(marker), config->base_path);
+    size_t len = strlen(config->filename_base);
+    int fd = open(marker, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || write(fd, config->filename_base, len) != (ssize_t)len) {
+        WLOG(TAG, "Preallocation marker not written, no tail cut after a power cut");
+    }
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
     }
+}
 
-    ILOG(TAG, "Async writer task stopped");
-    async_writer_task_handle = NULL;
-    vTaskDelete(NULL);
+/**
+ * @brief All files are trimmed: nothing to recover at the next start
+ */
+static void log_prealloc_unmark(const gps_log_file_config_t *config) {
+    char marker[ESP_VFS_PATH_MAX + PATH_MAX_CHAR_SIZE + 2];
+    log_prealloc_marker_path(marker, sizeof(marker), config->base_path);
+    unlink(marker);
 }
-#define ASYNC_WRITER_TASK_STACK_SIZE 2560
+#endif
+
+#if defined(CONFIG_GPS_LOG_CONTAINER)
+// ============================================================================
+// CONTAINER FILE - all streams in one file (include/gps_log_container.h).
+// Every enabled stream shares the fd of one .glc file, so the card sees a
+// single sequential append stream with one directory entry and one cluster
+// chain. Each ring slot and each synchronous write becomes one chunk: the
+// chunk header is written into room reserved in front of the payload and
+// goes out with it in a single write(), so chunks of different streams never
+// interleave. scripts/gps_log_split.py rebuilds the per-format files.
+// ============================================================================
+static struct {
+    int fd;
+    uint8_t streams;              // Streams sharing fd, the last log_close() closes it
+    bool created;                 // File was empty at open: header and stream headers written
+    size_t alloc;                 // Preallocated size (CONFIG_GPS_LOG_PREALLOCATE)
+    char filename[PATH_MAX_CHAR_SIZE + 8];
+} log_container = {.fd = -1};
+
 /**
- * @brief Start async writer subsystem
+ * @brief Open (once) the container of this session and write its stream directory
+ * @return the shared file descriptor
  */
-esp_err_t async_writer_start(void) {
-    if (async_writer_running) {
-        WLOG(TAG, "Async writer already running");
-        return ESP_OK;
+static int log_container_open(gps_log_file_config_t *config, const cfg_gps_log_enables_t *enables) {
+    if (log_container.fd >= 0) {
+        return log_container.fd;
     }
-    task_memory_info(__func__);
-    mem_info();
-    // Allocate pool storage dynamically (eliminates static memory usage)
-    FUNC_ENTRY_ARGS(TAG, "Starting async writer with pool block size %d bytes, count %d, total %zu bytes", 
-              ASYNC_POOL_BLOCK_SIZE, ASYNC_POOL_BLOCK_COUNT, ASYNC_POOL_BLOCK_COUNT * sizeof(async_pool_block_t));
-    async_pool_storage = (async_pool_block_t *)heap_caps_malloc(
-        ASYNC_POOL_BLOCK_COUNT * sizeof(async_pool_block_t), buffer_caps);
-    if (!async_pool_storage) {
-        ELOG(TAG, "Failed to allocate async write pool (%zu bytes)", 
-             ASYNC_POOL_BLOCK_COUNT * sizeof(async_pool_block_t));
-        return ESP_ERR_NO_MEM;
+    strcpy(log_container.filename, config->filename_base);
+    strcat(log_container.filename, ".glc");
+    int fd = s_open(log_container.filename, config->base_path, FILE_APPEND);
+    if (fd < 0) {
+        return fd;
     }
-
-    // Initialize pre-allocated block pool (eliminates hot-path malloc)
-    esp_err_t pool_err = logger_fixed_pool_init(&async_pool, async_pool_storage,
-                                                 sizeof(async_pool_block_t),
-                                                 ASYNC_POOL_BLOCK_COUNT);
-    if (pool_err != ESP_OK) {
-        ELOG(TAG, "Failed to initialize async write pool");
-        heap_caps_free(async_pool_storage);
-        async_pool_storage = NULL;
-        return pool_err;
+    struct stat file_stat = {0};
+    log_container.created = fstat(fd, &file_stat) == 0 && file_stat.st_size == 0;
+    log_container.streams = 0;
+    log_container.alloc = 0;
+    if (log_container.created) {
+        struct GLC_Header header = {
+            .magic = GLC_MAGIC,
+            .version = GLC_VERSION,
+            .header_size = sizeof(struct GLC_Header),
+            .chunk_header_size = sizeof(struct GLC_Chunk_Header),
+        };
+        for (uint8_t i = 0; i < sd_log_end && header.stream_count < GLC_MAX_STREAMS; i++) {
+            if (gps_log_file_is_enabled(enables, i)) {
+                struct GLC_Stream *stream = &header.streams[header.stream_count++];
+                stream->id = i;
+                memcpy(stream->ext, log_file_ext(i) + 1, sizeof(stream->ext));
+            }
+        }
+        if (write(fd, &header, sizeof(header)) != sizeof(header)) {
+            ELOG(TAG, "Container header write failed (%s)", strerror(errno));
+        }
     }
+    log_container.fd = fd;
+    ILOG(TAG, "Logging all streams to %s", log_container.filename);
+    return fd;
+}
 
-    // Create queue for write requests
-    async_writer_queue = xQueueCreate(ASYNC_WRITER_QUEUE_DEPTH, sizeof(async_write_request_t));
-    if (!async_writer_queue) {
-        ELOG(TAG, "Failed to create async writer queue");
-        logger_fixed_pool_deinit(&async_pool);
-        return ESP_ERR_NO_MEM;
+#endif
+
+#if defined(GPS_LOG_HAS_CHUNKS)
+// ============================================================================
+// CHUNK FRAMING - every ring slot and every synchronous write is one chunk:
+// a header with stream id, per-stream sequence number, length and the CRC32
+// of the payload, written with the payload in a single write(). A torn sector
+// or a corrupted byte after a power cut then costs only the chunks it hits,
+// scripts/gps_log_recover.py keeps every chunk whose CRC matches. GPY v1
+// frames restart with a full frame in each chunk (log_chunk_start()), so
+// every intact chunk decodes without the ones before it.
+// ============================================================================
+static uint32_t log_chunk_seq[sd_log_end];  // Next chunk sequence number per stream
+
+static void log_chunk_header(uint8_t file_index, uint8_t *buf, size_t len) {
+    struct GLC_Chunk_Header *chunk = (struct GLC_Chunk_Header *)buf;
+    uint32_t seq = log_chunk_seq[file_index]++;
+    chunk->magic = GLC_CHUNK_MAGIC;
+    chunk->stream = file_index;
+    chunk->flags = seq == 0 ? GLC_CHUNK_FLAG_FIRST : 0;
+    chunk->seq = seq;
+    chunk->len = (uint32_t)len;
+    chunk->crc = esp_rom_crc32_le(0, buf + LOG_CHUNK_HEADER_SIZE, len);
+}
+#endif
+
+/**
+ * @brief write() len payload bytes that follow LOG_CHUNK_HEADER_SIZE free bytes at buf
+ * With framed writes the free bytes take the chunk header.
+ * @return payload bytes written, -1 on error
+ */
+static ssize_t log_write_chunk(uint8_t file_index, int fd, uint8_t *buf, size_t len) {
+#if defined(GPS_LOG_HAS_CHUNKS)
+    log_chunk_header(file_index, buf, len);
+#endif
+    ssize_t written = log_io_write(file_index, fd, buf, len + LOG_CHUNK_HEADER_SIZE);
+    return written < 0 ? written : written - (ssize_t)LOG_CHUNK_HEADER_SIZE;
+}
+
+#if defined(CONFIG_GPS_LOG_UBZ)
+// ============================================================================
+// UBX COMPRESSION (include/ubz.h) - every UBX slot is coded into one block on
+// its way to the card, in the writer task (or the producer while it is
+// stopped). RAM: the match finder table in log_ubz.c plus one output block.
+// ============================================================================
+static uint8_t ubz_out[LOG_CHUNK_HEADER_SIZE + sizeof(struct UBZ_Block_Header)
+                       + UBZ_BOUND(ASYNC_SLOT_PAYLOAD)];
+static struct {
+    uint32_t blocks;
+    uint64_t raw_bytes;
+    uint64_t out_bytes;
+    uint64_t encode_us;
+    uint32_t encode_max_us;
+} ubz_stats;
+
+static void ubz_print_stats(void) {
+    if (!ubz_stats.blocks) {
+        return;
     }
+    printf("[GPS] UBX compression: %" PRIu32 " blocks, ratio %.2f, %.0fus/block (max %" PRIu32 "us)\n",
+           ubz_stats.blocks, (double)ubz_stats.raw_bytes / ubz_stats.out_bytes,
+           (double)ubz_stats.encode_us / ubz_stats.blocks, ubz_stats.encode_max_us);
+}
+#endif
 
-    // Pre-allocate sector buffers for currently open files.
-    // Avoids first-write allocation failure mid-recording; non-fatal if heap tight.
-    for (uint8_t i = 0; i < sd_log_end; i++) {
-        if (GET_FD(i) >= 0 && !file_buffers[i].buffer) {
-            FUNC_ENTRY_ARGS(TAG, "Pre-allocating buffer for open file %d (%dB)", i, ASYNC_WRITER_BUFFER_SIZE);
-            file_buffers[i].buffer = (uint8_t *)heap_caps_malloc(ASYNC_WRITER_BUFFER_SIZE, buffer_caps);
-            if (!file_buffers[i].buffer) {
-                WLOG(TAG, "Pre-alloc failed for file %d (%dB), will retry on first write",
-                     i, ASYNC_WRITER_BUFFER_SIZE);
-            } else {
-                file_buffers[i].buffer_used = 0;
-                file_buffers[i].last_write_tick = xTaskGetTickCount();
-            }
+/**
+ * @brief log_write_chunk() with the per-format coding stage in front
+ * @return payload bytes consumed, -1 on error
+ */
+static ssize_t log_write_block(uint8_t file_index, int fd, uint8_t *buf, size_t len) {
+#if defined(CONFIG_GPS_LOG_UBZ)
+    if (file_index == sd_log_ubx) {
+        int64_t start_us = esp_timer_get_time();
+        size_t out = ubz_encode_block(buf + LOG_CHUNK_HEADER_SIZE, len, ubz_out + LOG_CHUNK_HEADER_SIZE);
+        uint32_t encode_us = (uint32_t)(esp_timer_get_time() - start_us);
+        ubz_stats.blocks++;
+        ubz_stats.raw_bytes += len;
+        ubz_stats.out_bytes += out;
+        ubz_stats.encode_us += encode_us;
+        if (encode_us > ubz_stats.encode_max_us) {
+            ubz_stats.encode_max_us = encode_us;
         }
+        ssize_t written = log_write_chunk(file_index, fd, ubz_out, out);
+        return written == (ssize_t)out ? (ssize_t)len : -1;
     }
+#endif
+    return log_write_chunk(file_index, fd, buf, len);
+}
 
-    task_memory_info(__func__);
-    mem_info();
-    
-    // Create writer task (priority 5, below GPS task priority 10)
-    async_writer_running = true;
-    BaseType_t ret = xTaskCreatePinnedToCore(
-        async_writer_task,
-        "async_writer",
-        ASYNC_WRITER_TASK_STACK_SIZE,
-        NULL,
-        5,                              // Priority 5 (lower than GPS task)
-        &async_writer_task_handle,
-        tskNO_AFFINITY                  // No CPU affinity
-    );
-
-    if (ret != pdPASS) {
-        ELOG(TAG, "Failed to create async writer task");
-        vQueueDelete(async_writer_queue);
-        async_writer_queue = NULL;
-        async_writer_running = false;
-        logger_fixed_pool_deinit(&async_pool);
-        return ESP_FAIL;
+#if defined(CONFIG_GPS_LOG_PREALLOCATE)
+static size_t *log_file_alloc(uint8_t file_index) {
+#if defined(CONFIG_GPS_LOG_CONTAINER)
+    if (GET_FD(file_index) == log_container.fd) {
+        return &log_container.alloc;
     }
+#endif
+    return &file_alloc[file_index];
+}
+#endif
 
-    ILOG(TAG, "Async writer started (%dB sector-aligned buffering, %dms flush timeout)", 
-         ASYNC_WRITER_BUFFER_SIZE, ASYNC_WRITER_FLUSH_TIMEOUT_MS);
-    task_memory_info(__func__);
-    mem_info();
-    return ESP_OK;
+#if defined(CONFIG_GPS_LOG_SEGMENT_ENABLED)
+// ============================================================================
+// SEGMENTS - long sessions are split into <base>_sNN.<ext> files after
+// CONFIG_GPS_LOG_SEGMENT_MINUTES or CONFIG_GPS_LOG_SEGMENT_MB. The producer
+// decides at an epoch boundary: it seals the open slot, flags the next one
+// RING_SLOT_SEGMENT and writes the format header (GPX footer before) into it.
+// The writer opens the next segment ahead of time and switches its fd when
+// it reaches the flagged slot, so the GPS task never waits on FAT.
+// scripts/gps_log_concat.py joins the segments again.
+// ============================================================================
+#define LOG_SEGMENT_MAX 99
+#define LOG_SEGMENT_BYTES ((uint64_t)CONFIG_GPS_LOG_SEGMENT_MB << 20)
+#define LOG_SEGMENT_TICKS pdMS_TO_TICKS((uint32_t)CONFIG_GPS_LOG_SEGMENT_MINUTES * 60000)
+
+static struct {
+    // Producer side
+    uint8_t requested[sd_log_end];      // Segments flagged so far
+    TickType_t start_tick[sd_log_end];  // Start of the current segment
+    uint64_t bytes[sd_log_end];         // Sealed bytes in the current segment
+    // Writer side
+    uint8_t index[sd_log_end];          // Current segment, 0 = the session file
+    int next_fd[sd_log_end];            // Next segment opened ahead, -1 none, -2 open failed
+    size_t next_alloc[sd_log_end];      // Its preallocation (CONFIG_GPS_LOG_PREALLOCATE)
+#if defined(GPS_LOG_HAS_OAO)
+    // Handed over: header of the OAO segment ending at the flagged slot
+    union OAO_Header oao_header;
+    bool oao_header_set;
+#endif
+} log_segment;
+
+static void log_segment_bytes(uint8_t file_index, size_t len) {
+    log_segment.bytes[file_index] += len;
+}
+
+static void log_segment_reset(void) {
+    TickType_t now = xTaskGetTickCount();
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        log_segment.requested[i] = 0;
+        log_segment.start_tick[i] = now;
+        log_segment.bytes[i] = 0;
+        log_segment.index[i] = 0;
+        log_segment.next_fd[i] = -1;
+        log_segment.next_alloc[i] = 0;
+    }
+#if defined(GPS_LOG_HAS_OAO)
+    log_segment.oao_header_set = false;
+#endif
 }
 
 /**
- * @brief Stop async writer subsystem
+ * @brief Segment used share in percent, by time or size whichever is further
  */
-void async_writer_stop(void) {
-    if (!async_writer_running) {
-        return;
-    }
+static uint32_t log_segment_progress(uint8_t file_index) {
+    uint32_t pct = 0;
+#if CONFIG_GPS_LOG_SEGMENT_MINUTES > 0
+    pct = (uint32_t)((uint64_t)(xTaskGetTickCount() - log_segment.start_tick[file_index]) * 100
+                     / LOG_SEGMENT_TICKS);
+#endif
+#if CONFIG_GPS_LOG_SEGMENT_MB > 0
+    uint32_t bytes_pct = (uint32_t)(log_segment.bytes[file_index] * 100 / LOG_SEGMENT_BYTES);
+    if (bytes_pct > pct)
+        pct = bytes_pct;
+#endif
+    return pct;
+}
 
-    ILOG(TAG, "Stopping async writer...");
-    async_writer_running = false;
+static void log_segment_name(const gps_log_file_config_t *config, uint8_t file_index, uint8_t n,
+                             char *name, size_t size) {
+    snprintf(name, size, "%s_s%02" PRIu8 "%s", config->filename_base, n, log_file_ext(file_index));
+}
 
-    // Wait for task to finish (max 2 seconds)
-    for (int i = 0; i < 20 && async_writer_task_handle != NULL; i++) {
-        vTaskDelay(pdMS_TO_TICKS(100));
+static int log_segment_open(gps_log_file_config_t *config, uint8_t file_index, uint8_t n,
+                            size_t *alloc) {
+    char name[PATH_MAX_CHAR_SIZE];
+    log_segment_name(config, file_index, n, name, sizeof(name));
+    int fd = s_open(name, config->base_path, FILE_APPEND);
+    if (fd < 0) {
+        ELOG(TAG, "Segment open failed: %s", name);
+        return fd;
     }
-    // Grace period: task sets handle NULL then calls vTaskDelete(NULL);
-    // a brief yield ensures the scheduler has cleaned up the TCB before
-    // we delete the queue that the task may still reference in that window.
-    vTaskDelay(pdMS_TO_TICKS(10));
+#if defined(CONFIG_GPS_LOG_PREALLOCATE)
+    // The writer opens segments ahead: reserve one chunk, its top-ups keep the reserve
+    fd = log_preallocate(name, config->base_path, fd, LOG_PREALLOC_CHUNK, alloc);
+#else
+    (void)alloc;
+#endif
+    return fd;
+}
 
-    if (async_writer_queue) {
-        vQueueDelete(async_writer_queue);
-        async_writer_queue = NULL;
+/**
+ * @brief Producer: start a new segment for every file that is due
+ * Called with the producer lock held at the start of an epoch.
+ */
+static void log_segment_check(gps_context_t *context) {
+    if (!async_writer_running) {
+        return;
     }
-
-    logger_fixed_pool_deinit(&async_pool);
-    if (async_pool_storage) {
-        heap_caps_free(async_pool_storage);
-        async_pool_storage = NULL;
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        file_write_ring_t *r = &file_rings[i];
+        if (!r->storage || GET_FD(i) < 0 || (r->open_flags & RING_SLOT_SEGMENT)
+            || log_segment.requested[i] >= LOG_SEGMENT_MAX || log_segment_progress(i) < 100) {
+            continue;
+        }
+        if (i == sd_log_gpx) {
+            log_footer_GPX(context);
+        }
+#if defined(GPS_LOG_HAS_GPY)
+        if (i == sd_log_gpy) {
+            log_footer_GPY(context);
+        }
+#endif
+#if defined(GPS_LOG_HAS_OAO)
+        if (i == sd_log_oao) {
+            // Published with the seal, the writer fills it in at the switch
+            log_segment.oao_header_set = log_segment_header_OAO(context, &log_segment.oao_header);
+        }
+#endif
+        ring_seal(r);
+        r->open_flags |= RING_SLOT_SEGMENT;
+        log_segment.requested[i]++;
+#if defined(CONFIG_GPS_LOG_INDEX)
+        log_idx_segment(i, log_segment.requested[i]);
+#endif
+        log_segment.start_tick[i] = xTaskGetTickCount();
+        log_segment.bytes[i] = 0;
+        write_log_file_header(context, i);
+#if defined(GPS_LOG_HAS_GPY)
+        if (i == sd_log_gpy) {
+            context->next_gpy_full_frame = 1;  // segments decode on their own
+        }
+#endif
+    }
+}
+
+/**
+ * @brief Writer: open the next segment of files close to their limit
+ */
+static void log_segment_prepare(void) {
+    gps_log_file_config_t *config = gps->log_config;
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        if (!file_rings[i].storage || GET_FD(i) < 0 || log_segment.next_fd[i] != -1
+            || log_segment.index[i] >= LOG_SEGMENT_MAX || log_segment_progress(i) < 75) {
+            continue;
+        }
+        int fd = log_segment_open(config, i, log_segment.index[i] + 1, &log_segment.next_alloc[i]);
+        log_segment.next_fd[i] = fd < 0 ? -2 : fd;
+    }
+}
+
+#if defined(GPS_LOG_HAS_OAO)
+/**
+ * @brief Writer: fill the header reserved at the start of a finished OAO segment
+ * Reopened like log_close_OAO() does, a positional write to an append fd lands at the end.
+ */
+static void log_segment_header(gps_log_file_config_t *config, uint8_t file_index) {
+    if (file_index != sd_log_oao || !log_segment.oao_header_set) {
+        return;
+    }
+    log_segment.oao_header_set = false;
+    const char *name = config->filenames[file_index];
+    int fd = s_open(name, config->base_path, FILE_UPDATE);
+    if (fd < 0 || pwrite(fd, log_segment.oao_header.bytes, OAO_HEADER_LENGTH, 0) != OAO_HEADER_LENGTH) {
+        ELOG(TAG, "Segment header not written (%s) %s", strerror(errno), name);
+    }
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+#endif
+
+/**
+ * @brief Writer: finish the current segment of a file and continue in the next
+ * @return fd to write the flagged slot to, the old one if no segment could be opened
+ */
+static int log_segment_switch(uint8_t file_index, int fd) {
+    gps_log_file_config_t *config = gps->log_config;
+    uint8_t n = log_segment.index[file_index] + 1;
+    int next = log_segment.next_fd[file_index];
+    log_segment.next_fd[file_index] = -1;
+    if (next < 0) {
+        next = log_segment_open(config, file_index, n, &log_segment.next_alloc[file_index]);
+        if (next < 0) {
+            return fd;
+        }
+    }
+    log_io_fsync(file_index, fd, NULL);
+#if defined(CONFIG_GPS_LOG_PREALLOCATE)
+    log_prealloc_trim(&file_alloc[file_index], fd);
+    file_alloc[file_index] = log_segment.next_alloc[file_index];
+    log_segment.next_alloc[file_index] = 0;
+#endif
+    close(fd);
+#if defined(GPS_LOG_HAS_OAO)
+    log_segment_header(config, file_index);
+#endif
+    GET_FD(file_index) = next;
+#if defined(GPS_LOG_HAS_CHUNKS)
+    log_chunk_seq[file_index] = 0;  // every segment recovers on its own
+#endif
+    log_segment.index[file_index] = n;
+    log_segment_name(config, file_index, n, config->filenames[file_index], PATH_MAX_CHAR_SIZE);
+    file_syncs[file_index].written = false;
+    ILOG(TAG, "Logging to segment %s", config->filenames[file_index]);
+    return next;
+}
+
+/**
+ * @brief Close and remove segments opened ahead but never used
+ */
+static void log_segment_close(gps_log_file_config_t *config) {
+    char name[PATH_MAX_CHAR_SIZE], path[ESP_VFS_PATH_MAX + PATH_MAX_CHAR_SIZE + 2];
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        int fd = log_segment.next_fd[i];
+        log_segment.next_fd[i] = -1;
+        if (fd < 0) {
+            continue;
+        }
+        close(fd);
+        log_segment_name(config, i, log_segment.index[i] + 1, name, sizeof(name));
+        snprintf(path, sizeof(path), "%s/%s", config->base_path, name);
+        if (unlink(path) != 0) {
+            WLOG(TAG, "Unused segment not removed (%s) %s", strerror(errno), path);
+        }
+    }
+}
+#endif
+
+/**
+ * @brief Write all sealed slots of a ring
+ * Must be called from async writer task only
+ */
+static void async_writer_write_ring(uint8_t file_index) {
+    file_write_ring_t *r = &file_rings[file_index];
+    int fd = GET_FD(file_index);
+    unsigned tail = atomic_load(&r->tail);
+
+    while (tail != atomic_load(&r->head)) {
+        size_t len = r->slot_len[tail % r->slots];
+#if defined(CONFIG_GPS_LOG_SEGMENT_ENABLED)
+        if (fd >= 0 && (r->slot_flags[tail % r->slots] & RING_SLOT_SEGMENT)) {
+            fd = log_segment_switch(file_index, fd);
+        }
+#endif
+        if (fd >= 0) {
+#if defined(CONFIG_GPS_LOG_PREALLOCATE)
+            log_prealloc_extend(log_file_alloc(file_index), fd, len + LOG_CHUNK_HEADER_SIZE);
+#endif
+            // Perform synchronous write (we're in dedicated writer task)
+            int64_t start_us = esp_timer_get_time();
+            ssize_t written = log_write_block(file_index, fd, ring_slot(r, tail), len);
+            uint32_t write_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+            if (write_ms > r->stall_max_ms) {
+                r->stall_max_ms = write_ms;
+            }
+            if (write_ms >= ASYNC_WRITER_STALL_MS) {
+                r->stalls++;
+                r->stall_total_ms += write_ms;
+                DLOG(TAG, "Card stall on file %"PRIu8": %" PRIu32 "ms, backlog %u slots",
+                     file_index, write_ms, atomic_load(&r->head) - tail);
+            }
+            if (written != (ssize_t)len) {
+                ELOG(TAG, "Flush failed for file %"PRIu8": wrote %zd of %zu bytes (%s)",
+                     file_index, written, len, strerror(errno));
+            } else {
+                DLOG(TAG, "Flushed %zu bytes to file %"PRIu8, len, file_index);
+            }
+            file_sync_t *fs = &file_syncs[file_index];
+            if (!fs->written) {
+                fs->written = true;
+                fs->dirty_since = r->slot_tick[tail % r->slots];
+            }
+        }
+        atomic_store(&r->tail, ++tail);
+        async_writer_slots++;
+    }
+}
+
+#if defined(GPS_LOG_HAS_SIDE)
+// ============================================================================
+// SIDE FILES - small files next to the log (summary journal, time index):
+// records queued by the producer under its lock, appended by the writer
+// ============================================================================
+#define LOG_SIDE_BUFFER_SIZE 1024
+
+static struct {
+    int fd;
+    bool sync;               // fsync after each append
+    size_t fill;             // Queued bytes in buf, producer lock
+    atomic_bool busy;        // Writer is writing out without the lock
+    uint8_t buf[LOG_SIDE_BUFFER_SIZE];
+} log_side[LOG_SIDE_END] = {[0 ... LOG_SIDE_END - 1] = {.fd = -1}};
+static uint8_t log_side_out[LOG_SIDE_BUFFER_SIZE];  // Writer copy of a queue
+
+static void log_side_write(uint8_t side, int fd, const uint8_t *buf, size_t len) {
+    ssize_t written = write(fd, buf, len);
+    if (written != (ssize_t)len) {
+        ELOG(TAG, "Side file %" PRIu8 " write failed (%s), %zd of %zu bytes", side, strerror(errno),
+             written, len);
+    }
+    if (log_side[side].sync) {
+        fsync(fd);
+    }
+}
+
+/**
+ * @brief Append the queued side file records, writer side
+ * @param locked caller already holds the producer lock (writer exit)
+ * @return false if the lock was busy and records are still queued
+ */
+static bool log_side_flush(bool locked) {
+    bool done = true;
+    for (uint8_t i = 0; i < LOG_SIDE_END; i++) {
+        if (log_side[i].fd < 0) {
+            continue;
+        }
+        if (!locked && !log_producer_lock(0)) {
+            done = false;
+            continue;
+        }
+        int fd = log_side[i].fd;
+        size_t len = log_side[i].fill;
+        memcpy(log_side_out, log_side[i].buf, len);
+        log_side[i].fill = 0;
+        atomic_store(&log_side[i].busy, len > 0);
+        if (!locked) {
+            log_producer_unlock();
+        }
+        if (len) {
+            log_side_write(i, fd, log_side_out, len);
+            atomic_store(&log_side[i].busy, false);
+        }
+    }
+    return done;
+}
+#endif
+
+static bool async_writer_pending(void) {
+#if defined(GPS_LOG_HAS_SIDE)
+    for (uint8_t i = 0; i < LOG_SIDE_END; i++) {
+        if (log_side[i].fill) {
+            return true;
+        }
+    }
+#endif
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        const file_write_ring_t *r = &file_rings[i];
+        if (r->storage && (atomic_load(&r->head) != atomic_load(&r->tail)
+                           || atomic_load(&r->fill) > 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void async_writer_sync_reset(void) {
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        file_sync_t *fs = &file_syncs[i];
+        memset(fs, 0, sizeof(*fs));
+        fs->window_ms = (uint32_t)async_loss_window_s[i] * 1000;
+    }
+    sync_stretch_pct = 100;
+}
+
+/**
+ * @brief Recompute the window stretch from the measured sync costs
+ * load = sum(cost / window) of the scheduled files, in percent of the time
+ */
+static void async_writer_sync_budget(void) {
+    uint32_t load_ppm = 0;
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        const file_sync_t *fs = &file_syncs[i];
+        if (fs->window_ms && file_rings[i].storage) {
+            load_ppm += (uint32_t)((uint64_t)fs->cost_us * 1000 / fs->window_ms);
+        }
+    }
+    uint32_t budget_ppm = CONFIG_GPS_LOG_SYNC_BUDGET_PERCENT * 10000;
+    uint32_t stretch = load_ppm > budget_ppm ? load_ppm * 100 / budget_ppm : 100;
+    if (stretch != sync_stretch_pct) {
+        if (stretch > 100 && sync_stretch_pct == 100) {
+            WLOG(TAG, "fsync cost %" PRIu32 "ppm over budget, loss windows stretched to %" PRIu32 "%%",
+                 load_ppm, stretch);
+        }
+        sync_stretch_pct = stretch;
+    }
+}
+
+/**
+ * @brief Sync interval of a file: stretched window minus the worst sync time
+ * The average alone let every slower than average sync end past the window
+ * (scripts/gps_log_durability_sim.py), so keep the slowest sync seen, at least
+ * a card stall, and one tick of wakeup latency in hand.
+ */
+static TickType_t async_writer_sync_interval(const file_sync_t *fs) {
+    uint32_t window_ms = fs->window_ms * sync_stretch_pct / 100;
+    uint32_t worst_ms = fs->cost_max_us / 1000 + 1;
+    uint32_t cost_ms = (worst_ms > ASYNC_WRITER_STALL_MS ? worst_ms : ASYNC_WRITER_STALL_MS) + portTICK_PERIOD_MS;
+    return pdMS_TO_TICKS(window_ms > 2 * cost_ms ? window_ms - cost_ms : window_ms / 2);
+}
+
+/**
+ * @brief Seal, write and fsync one file
+ * @return false if the producer lock was busy, retry on the next tick
+ */
+static bool async_writer_sync(uint8_t file_index) {
+    file_write_ring_t *r = &file_rings[file_index];
+    file_sync_t *fs = &file_syncs[file_index];
+    int fd = GET_FD(file_index);
+    if (!log_producer_lock(0)) {
+        return false;
+    }
+    ring_seal(r);
+    log_producer_unlock();
+    async_writer_write_ring(file_index);
+    fs->armed = false;
+    fs->written = false;
+    if (fd < 0) {
+        return true;
+    }
+
+    uint32_t cost_us = 0;
+    log_io_fsync(file_index, fd, &cost_us);
+    fs->cost_us = fs->syncs ? (fs->cost_us * 7 + cost_us) / 8 : cost_us;
+    if (cost_us > fs->cost_max_us) {
+        fs->cost_max_us = cost_us;
+    }
+    fs->syncs++;
+    if (xTaskGetTickCount() - fs->dirty_since > pdMS_TO_TICKS(fs->window_ms)) {
+        fs->late++;
+    }
+    async_writer_sync_budget();
+    return true;
+}
+
+/**
+ * @brief Arm sync deadlines of files with unsynced data and run the first due sync
+ * @param wait lowered to the next sync deadline
+ */
+static void async_writer_schedule_syncs(TickType_t *wait) {
+    const TickType_t now = xTaskGetTickCount();
+    bool synced = false;
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        file_write_ring_t *r = &file_rings[i];
+        file_sync_t *fs = &file_syncs[i];
+        if (!r->storage || !fs->window_ms) {
+            continue;
+        }
+        if (!fs->armed) {
+            // Oldest unsynced byte: first slot written since the last sync, else the open slot
+            if (!fs->written) {
+                if (atomic_load(&r->fill) == 0) {
+                    continue;
+                }
+                fs->dirty_since = r->dirty_tick;
+            }
+            fs->due = fs->dirty_since + async_writer_sync_interval(fs);
+            fs->armed = true;
+        }
+        TickType_t left = (TickType_t)(fs->due - now);
+        if ((int32_t)left <= 0) {
+            // One fsync per wakeup, later files are staggered to the next tick
+            if (synced || !async_writer_sync(i)) {
+                *wait = 1;
+            } else {
+                synced = true;
+            }
+        } else if (left < *wait) {
+            *wait = left;
+        }
+    }
+}
+
+/**
+ * @brief Write sealed slots and seal open slots whose oldest byte reached the flush timeout
+ * @return ticks until the next open slot expires, portMAX_DELAY if none is dirty
+ */
+static TickType_t async_writer_flush_expired(void) {
+    const TickType_t timeout = pdMS_TO_TICKS(ASYNC_WRITER_FLUSH_TIMEOUT_MS);
+    const TickType_t now = xTaskGetTickCount();
+    TickType_t wait = portMAX_DELAY;
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        file_write_ring_t *r = &file_rings[i];
+        if (!r->storage) {
+            continue;
+        }
+        async_writer_write_ring(i);
+        if (atomic_load(&r->fill) == 0) {
+            continue;
+        }
+        TickType_t age = now - r->dirty_tick;
+        if (age >= timeout) {
+            // Producers hold the lock for one epoch at most, retry next tick if busy
+            if (log_producer_lock(0)) {
+                DLOG(TAG, "Timeout flush for file %d (%u bytes)", i, atomic_load(&r->fill));
+                file_io[i].timeout_flushes++;
+                ring_seal(r);
+                log_producer_unlock();
+                async_writer_write_ring(i);
+            } else {
+                wait = 1;
+            }
+        } else if (timeout - age < wait) {
+            wait = timeout - age;
+        }
+    }
+    async_writer_schedule_syncs(&wait);
+#if defined(CONFIG_GPS_LOG_SEGMENT_ENABLED)
+    log_segment_prepare();
+#endif
+#if defined(GPS_LOG_HAS_SIDE)
+    if (!log_side_flush(false)) {
+        wait = 1;
+    }
+#endif
+    return wait;
+}
+
+/**
+ * @brief Wake the writer if it needs to see the rings now
+ * @param force always wake (sealed slot, flush)
+ */
+static inline void async_writer_kick(bool force) {
+    if (!async_writer_task_handle) {
+        return;
+    }
+    if (force || atomic_load(&async_writer_idle)) {
+        xTaskNotifyGive(async_writer_task_handle);
+    }
+}
+
+#if defined(GPS_LOG_HAS_SIDE)
+/**
+ * @brief Hand an open side file to the writer
+ * @param sync fsync after each append (journal)
+ */
+void log_side_attach(uint8_t side, int fd, bool sync) {
+    log_side[side].fill = 0;
+    log_side[side].sync = sync;
+    log_side[side].fd = fd;
+}
+
+/**
+ * @brief Queue a side file record, written synchronously without the writer
+ * @return false if the queue is full, retry later
+ */
+bool log_side_append(uint8_t side, const void *data, size_t len) {
+    if (log_side[side].fd < 0) {
+        return false;
+    }
+    if (!async_writer_running) {
+        log_side_write(side, log_side[side].fd, data, len);
+        return true;
+    }
+    if (!log_producer_lock(pdMS_TO_TICKS(ASYNC_WRITER_LOCK_TIMEOUT_MS))) {
+        return false;
+    }
+    bool queued = log_side[side].fill + len <= sizeof(log_side[side].buf);
+    if (queued) {
+        memcpy(log_side[side].buf + log_side[side].fill, data, len);
+        log_side[side].fill += len;
+    }
+    log_producer_unlock();
+    async_writer_kick(log_side[side].sync);  // unsynced records ride along with the next flush
+    return queued;
+}
+
+/**
+ * @brief Take a side file back from the writer with all queued records written
+ * @return fd, -1 if none was attached
+ */
+int log_side_detach(uint8_t side) {
+    bool locked = log_producer_lock(portMAX_DELAY);
+    int fd = log_side[side].fd;
+    log_side[side].fd = -1;
+    if (locked) {
+        log_producer_unlock();
+    }
+    while (atomic_load(&log_side[side].busy)) {
+        vTaskDelay(1);
+    }
+    if (fd >= 0 && log_side[side].fill) {
+        log_side_write(side, fd, log_side[side].buf, log_side[side].fill);
+    }
+    log_side[side].fill = 0;
+    return fd;
+}
+#endif
+
+// Segment open/close and unlink (FatFs LFN buffers), fsync, UBZ and ELOG
+// with strerror all run on the writer, see the high water mark in the stats
+#define ASYNC_WRITER_TASK_STACK_SIZE CONFIG_GPS_LOG_WRITER_STACK_SIZE
+
+/**
+ * @brief Writer stack bytes never used, live while it runs, else at its last exit
+ */
+static uint32_t async_writer_stack_unused(void) {
+    TaskHandle_t task = async_writer_task_handle;
+    return task ? uxTaskGetStackHighWaterMark(task) : async_writer_stack_free;
+}
+
+/**
+ * @brief Async writer task - writes sealed ring slots
+ * Sleeps until notified or until the oldest open slot reaches its deadline.
+ */
+static void async_writer_task(void *arg) {
+    ILOG(TAG, "Async writer task started");
+    TickType_t wait = portMAX_DELAY;
+
+    while (async_writer_running) {
+        if (wait == portMAX_DELAY) {
+            // Publish idle before the last ring check so a producer that
+            // missed the flag still sees its data picked up here
+            atomic_store(&async_writer_idle, true);
+            if (async_writer_pending()) {
+                wait = 0;
+            }
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+        atomic_store(&async_writer_idle, false);
+        async_writer_wakeups++;
+        wait = async_writer_flush_expired();
+    }
+
+    // Cleanup on exit: async_writer_stop() holds the producer lock, seal and write everything
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        if (file_rings[i].storage) {
+            ring_seal(&file_rings[i]);
+            async_writer_write_ring(i);
+        }
+    }
+#if defined(GPS_LOG_HAS_SIDE)
+    log_side_flush(true);
+#endif
+
+    async_writer_stack_free = uxTaskGetStackHighWaterMark(NULL);
+    ILOG(TAG, "Async writer task stopped, %" PRIu32 " of %d stack bytes never used",
+         async_writer_stack_free, ASYNC_WRITER_TASK_STACK_SIZE);
+    async_writer_task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+static void async_writer_free_rings(void) {
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        file_write_ring_t *r = &file_rings[i];
+        if (r->storage) {
+            heap_caps_free(r->storage);
+            r->storage = NULL;
+        }
+        atomic_store(&r->head, 0);
+        atomic_store(&r->tail, 0);
+        atomic_store(&r->fill, 0);
+    }
+}
+
+/**
+ * @brief Start async writer subsystem
+ */
+esp_err_t async_writer_start(void) {
+    if (async_writer_running) {
+        WLOG(TAG, "Async writer already running");
+        return ESP_OK;
+    }
+    if (!log_producer_lock(pdMS_TO_TICKS(ASYNC_WRITER_LOCK_TIMEOUT_MS))) {
+        ELOG(TAG, "Async writer start: producer lock unavailable");
+        return ESP_ERR_INVALID_STATE;
+    }
+    task_memory_info(__func__);
+    mem_info();
+
+    // Allocate rings for currently open files. A file without a ring keeps
+    // writing synchronously; non-fatal if heap tight.
+    size_t total = 0;
+    uint8_t rings = 0;
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        file_write_ring_t *r = &file_rings[i];
+        if (GET_FD(i) < 0 || r->storage) {
+            continue;
+        }
+        uint8_t slots = async_ring_depth[i];
+        if (slots < 2)
+            slots = 2;
+        if (slots > ASYNC_RING_SLOTS_MAX)
+            slots = ASYNC_RING_SLOTS_MAX;
+        size_t ring_size = (size_t)slots * ASYNC_WRITER_BUFFER_SIZE;
+        r->storage = (uint8_t *)heap_caps_malloc(ring_size, buffer_caps);
+        if (!r->storage) {
+            WLOG(TAG, "Ring alloc failed for file %d (%zuB), using sync writes", i, ring_size);
+            continue;
+        }
+        r->slots = slots;
+        atomic_store(&r->head, 0);
+        atomic_store(&r->tail, 0);
+        atomic_store(&r->fill, 0);
+        r->open_flags = 0;
+        r->backlog_max = 0;
+        r->dropped = 0;
+        r->stalls = 0;
+        r->stall_max_ms = 0;
+        r->stall_total_ms = 0;
+        total += ring_size;
+        rings++;
+    }
+    FUNC_ENTRY_ARGS(TAG, "Allocated %" PRIu8 " write rings, %zu bytes", rings, total);
+    if (!rings) {
+        log_producer_unlock();
+        return ESP_ERR_NO_MEM;
+    }
+
+    async_writer_sync_reset();
+#if defined(CONFIG_GPS_LOG_SHED_ENABLED)
+    log_shed_reset();
+#endif
+    task_memory_info(__func__);
+    mem_info();
+    
+    // Create writer task (priority 5, below GPS task priority 10)
+    async_writer_running = true;
+    BaseType_t ret = xTaskCreatePinnedToCore(
+        async_writer_task,
+        "async_writer",
+        ASYNC_WRITER_TASK_STACK_SIZE,
+        NULL,
+        5,                              // Priority 5 (lower than GPS task)
+        &async_writer_task_handle,
+        tskNO_AFFINITY                  // No CPU affinity
+    );
+
+    if (ret != pdPASS) {
+        ELOG(TAG, "Failed to create async writer task");
+        async_writer_running = false;
+        async_writer_free_rings();
+        log_producer_unlock();
+        return ESP_FAIL;
+    }
+    log_producer_unlock();
+
+    ILOG(TAG, "Async writer started (%zuB in %dB sector-aligned ring slots, %dms flush timeout)", 
+         total, ASYNC_WRITER_BUFFER_SIZE, ASYNC_WRITER_FLUSH_TIMEOUT_MS);
+    task_memory_info(__func__);
+    mem_info();
+    return ESP_OK;
+}
+
+/**
+ * @brief Stop async writer subsystem
+ * Holds the producer lock until the rings are written, so no frame can
+ * overtake buffered data with a synchronous write.
+ */
+void async_writer_stop(void) {
+    if (!async_writer_running) {
+        return;
+    }
+
+    ILOG(TAG, "Stopping async writer...");
+    bool locked = log_producer_lock(portMAX_DELAY);
+#if defined(CONFIG_GPS_LOG_SHED_ENABLED)
+    log_shed_close();
+#endif
+    async_writer_running = false;
+    if (async_writer_task_handle) {
+        xTaskNotifyGive(async_writer_task_handle);
+    }
+
+    // Wait for task to finish (max 2 seconds)
+    for (int i = 0; i < 20 && async_writer_task_handle != NULL; i++) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    // Grace period: task sets handle NULL then calls vTaskDelete(NULL);
+    // a brief yield ensures the scheduler has cleaned up the TCB before
+    // we free the rings that the task may still reference in that window.
+    vTaskDelay(pdMS_TO_TICKS(10));
+
+    if (async_writer_task_handle == NULL) {
+        async_writer_free_rings();
+    } else {
+        WLOG(TAG, "Async writer did not stop, keeping ring buffers");
+    }
+    if (locked) {
+        log_producer_unlock();
+    }
+    ILOG(TAG, "Async writer stopped");
+}
+
+esp_err_t gps_log_file_get_io_stats(uint8_t file, gps_log_file_io_stats_t *stats) {
+    if (file >= sd_log_end || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const file_io_t *io = &file_io[file];
+    const file_write_ring_t *r = &file_rings[file];
+    stats->bytes_in = io->bytes_in;
+    stats->bytes_out = io->bytes_out;
+    stats->writes = io->writes;
+    stats->write_avg_us = io->writes ? (uint32_t)(io->write_us / io->writes) : 0;
+    stats->write_max_us = io->write_max_us;
+    stats->timeout_flushes = io->timeout_flushes;
+    stats->syncs = io->syncs;
+    stats->sync_avg_us = io->syncs ? (uint32_t)(io->sync_us / io->syncs) : 0;
+    stats->sync_max_us = io->sync_max_us;
+    stats->stalls = r->stalls;
+    stats->dropped = r->dropped;
+    return ESP_OK;
+}
+
+/**
+ * @brief Append the I/O counters of all open files to the TXT session summary
+ */
+static void log_io_summary(void) {
+    char line[224];
+    gps_log_file_io_stats_t st;
+    WRITETXT("\n*** Log I/O ***\n", 17);
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        if (GET_FD(i) < 0 || gps_log_file_get_io_stats(i, &st) != ESP_OK || !st.bytes_in) {
+            continue;
+        }
+        // Fixed point: amplification in hundredths, times in tenths of a ms
+        uint32_t amp = (uint32_t)(st.bytes_out * 100 / st.bytes_in);
+        int n = snprintf(line, sizeof(line),
+                         "%s: in %" PRIu64 " B, out %" PRIu64 " B (x%" PRIu32 ".%02" PRIu32 "), %" PRIu32
+                         " writes of %" PRIu64 " B, write %" PRIu32 ".%" PRIu32 "/%" PRIu32 ".%" PRIu32
+                         " ms, %" PRIu32 " timeout flushes, %" PRIu32 " syncs %" PRIu32 ".%" PRIu32
+                         "/%" PRIu32 ".%" PRIu32 " ms, %" PRIu32 " stalls, %" PRIu32 " dropped\n",
+                         log_file_ext(i) + 1, st.bytes_in, st.bytes_out, amp / 100, amp % 100, st.writes,
+                         st.writes ? st.bytes_out / st.writes : 0,
+                         st.write_avg_us / 1000, st.write_avg_us / 100 % 10,
+                         st.write_max_us / 1000, st.write_max_us / 100 % 10, st.timeout_flushes,
+                         st.syncs, st.sync_avg_us / 1000, st.sync_avg_us / 100 % 10,
+                         st.sync_max_us / 1000, st.sync_max_us / 100 % 10,
+                         st.stalls, st.dropped);
+        if (n > 0) {
+            WRITETXT(line, (size_t)n < sizeof(line) ? (size_t)n : sizeof(line) - 1);
+        }
+    }
+    int n = snprintf(line, sizeof(line), "writer stack: %" PRIu32 " of %d B never used\n",
+                     async_writer_stack_unused(), ASYNC_WRITER_TASK_STACK_SIZE);
+    if (n > 0) {
+        WRITETXT(line, (size_t)n);
+    }
+}
+
+/**
+ * @brief Print async writer wakeup statistics for the last period
+ * Stall and backlog figures are per file since the writer started, compare
+ * backlog with the ring depth to size CONFIG_GPS_LOG_RING_SLOTS_* for a card.
+ */
+void gps_log_file_print_stats(uint32_t period_ms) {
+    static uint32_t prev_wakeups = 0, prev_slots = 0;
+    uint32_t wakeups = async_writer_wakeups - prev_wakeups;
+    uint32_t slots = async_writer_slots - prev_slots;
+    prev_wakeups = async_writer_wakeups;
+    prev_slots = async_writer_slots;
+    // Tenths in integers, no float formatting on the logging path
+    uint32_t rate10 = period_ms ? (uint32_t)((uint64_t)wakeups * 10000 / period_ms) : 0;
+    uint32_t per10 = wakeups ? slots * 10 / wakeups : 0;
+    printf("[GPS] Async writer: %" PRIu32 ".%" PRIu32 " wakeups/s, %" PRIu32 ".%" PRIu32
+           " slots/wakeup, %" PRIu32 "/%d stack bytes unused\n",
+           rate10 / 10, rate10 % 10, per10 / 10, per10 % 10,
+           async_writer_stack_unused(), ASYNC_WRITER_TASK_STACK_SIZE);
+#if defined(CONFIG_GPS_LOG_SHED_ENABLED)
+    log_shed_print_stats();
+#endif
+#if defined(CONFIG_GPS_LOG_UBZ)
+    ubz_print_stats();
+#endif
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        const file_write_ring_t *r = &file_rings[i];
+        if (!r->storage) {
+            continue;
+        }
+        const file_sync_t *fs = &file_syncs[i];
+        printf("[GPS]   file %" PRIu8 ": ring %" PRIu8 "/%" PRIu8 " max backlog, %" PRIu32 " stalls (max %" PRIu32 "ms, total %" PRIu32 "ms), %" PRIu32 " dropped\n",
+               i, r->backlog_max, r->slots, r->stalls, r->stall_max_ms,
+               r->stall_total_ms, r->dropped);
+        if (fs->window_ms) {
+            printf("[GPS]   file %" PRIu8 ": %" PRIu32 " syncs (avg %" PRIu32 ".%" PRIu32 "ms, max %" PRIu32
+                   ".%" PRIu32 "ms), %" PRIu32 " late, window %" PRIu32 "ms x %" PRIu32 "%%\n",
+                   i, fs->syncs, fs->cost_us / 1000, fs->cost_us / 100 % 10,
+                   fs->cost_max_us / 1000, fs->cost_max_us / 100 % 10,
+                   fs->late, fs->window_ms, sync_stretch_pct);
+        }
+    }
+}
+
+/**
+ * @brief Reserve room for a frame of up to len bytes in the file's open ring slot
+ * On success the producer lock stays held until log_commit().
+ * While the writer is not running a scratch frame is returned and log_commit()
+ * writes it synchronously.
+ * @return where to encode the frame, NULL if the file is closed or the ring is full
+ */
+void *log_reserve(const struct gps_context_s * context, uint8_t file, size_t len) {
+    if (file >= sd_log_end || GET_FD(file) < 0 || len == 0 || len > ASYNC_SLOT_PAYLOAD) {
+        return NULL;
+    }
+    if (!log_producer_lock(pdMS_TO_TICKS(ASYNC_WRITER_LOCK_TIMEOUT_MS))) {
+        return NULL;
+    }
+    file_write_ring_t *r = &file_rings[file];
+    if (!async_writer_running || !r->storage) {
+        if (len <= LOG_SYNC_FRAME_SIZE) {
+            return log_sync_frame + LOG_CHUNK_HEADER_SIZE;
+        }
+        log_producer_unlock();
+        return NULL;
+    }
+
+    unsigned fill = atomic_load(&r->fill);
+    if (fill + len > ASYNC_SLOT_PAYLOAD) {
+        ring_seal(r);
+        async_writer_kick(true);
+        fill = 0;
+    }
+    unsigned head = atomic_load(&r->head);
+    if (head - atomic_load(&r->tail) >= r->slots) {
+        if ((r->dropped++ & 0x3F) == 0) {
+            WLOG(TAG, "Write ring full for file %"PRIu8", dropped %" PRIu32 " frames",
+                 file, r->dropped);
+        }
+        async_writer_kick(true);
+        log_producer_unlock();
+        return NULL;
+    }
+    return ring_slot(r, head) + LOG_CHUNK_HEADER_SIZE + fill;
+}
+
+/**
+ * @brief Publish len bytes encoded at the pointer returned by log_reserve()
+ * len may be smaller than reserved, 0 cancels the reservation.
+ */
+void log_commit(const struct gps_context_s * context, uint8_t file, size_t len) {
+    file_write_ring_t *r = &file_rings[file];
+    file_io[file].bytes_in += len;
+    if (!async_writer_running || !r->storage) {
+        if (len && log_write_block(file, GET_FD(file), log_sync_frame, len) < 0) {
+            ELOG(TAG, "Failed to write (%s) %" PRIu8, strerror(errno), file);
+        }
+        log_producer_unlock();
+        return;
+    }
+
+    if (len) {
+        unsigned fill = atomic_load(&r->fill);
+        if (fill == 0) {
+            r->dirty_tick = xTaskGetTickCount();
+        }
+        atomic_store(&r->fill, fill + len);
+        if (fill + len >= ASYNC_SLOT_PAYLOAD) {
+            ring_seal(r);
+            async_writer_kick(true);
+        } else if (fill == 0) {
+            async_writer_kick(false);  // arm the flush deadline of an idle writer
+        }
+    }
+    log_producer_unlock();
+}
+
+/**
+ * @brief True if the next bytes written to the file land at file offset 0
+ * While the writer is stopped the file is empty, while it runs the open
+ * slot is still empty and starts a new segment.
+ */
+bool log_at_file_start(uint8_t file) {
+    if (file >= sd_log_end || GET_FD(file) < 0) {
+        return false;
+    }
+    file_write_ring_t *r = &file_rings[file];
+    if (async_writer_running && r->storage) {
+        return (r->open_flags & RING_SLOT_SEGMENT) && atomic_load(&r->fill) == 0;
+    }
+    return lseek(GET_FD(file), 0, SEEK_END) == 0;
+}
+
+#if defined(GPS_LOG_HAS_CHUNKS)
+/**
+ * @brief True if the frame reserved last with log_reserve() opens a new chunk
+ * Call between log_reserve() and log_commit(). Synchronous writes are one chunk each.
+ */
+bool log_chunk_start(uint8_t file) {
+    file_write_ring_t *r = &file_rings[file];
+    return !async_writer_running || !r->storage || atomic_load(&r->fill) == 0;
+}
+#endif
+
+#if defined(CONFIG_GPS_LOG_SHED_ENABLED)
+// ============================================================================
+// BACKPRESSURE SHEDDING - keep the primary format alive through card stalls.
+// Ring pressure is the fullest ring's share of sealed slots waiting for the
+// writer. At or above CONFIG_GPS_LOG_SHED_HIGH_PERCENT log_to_file() sheds the
+// next output of CONFIG_GPS_LOG_SHED_ORDER (one per epoch); after a second at
+// or below CONFIG_GPS_LOG_SHED_LOW_PERCENT the last shed output comes back.
+// GPY and UBX NAV-PVT are never shed. Each shed interval is recorded as a
+// "gap" line in the TXT file once TXT itself is not shed. Nothing here waits,
+// frames of shed outputs are simply not encoded.
+// ============================================================================
+typedef enum {
+    LOG_SHED_GPX,
+    LOG_SHED_TXT,
+    LOG_SHED_SBP,
+    LOG_SHED_OAO,
+    LOG_SHED_NAV_SAT,
+    LOG_SHED_OUTPUTS
+} log_shed_output_t;
+
+static const char *const log_shed_names[LOG_SHED_OUTPUTS] = {"gpx", "txt", "sbp", "oao", "navsat"};
+
+typedef struct {
+    uint32_t start_ms;            // UTC ms of day the output was shed
+    uint32_t end_ms;              // UTC ms of day it came back
+    uint32_t frames;              // Epochs not logged in this gap
+    uint32_t total_frames;        // Epochs not logged since the writer started
+    bool pending;                 // Gap closed, marker not written yet
+} log_shed_gap_t;
+
+static struct {
+    uint8_t order[LOG_SHED_OUTPUTS];
+    uint8_t count;                // Outputs in order[]
+    uint8_t level;                // order[0..level) are shed
+    uint16_t calm_epochs;         // Consecutive epochs at low pressure
+    uint8_t mask;                 // BIT(log_shed_output_t) of shed outputs
+    uint32_t dropped_seen;        // Ring drops at the last update
+    uint32_t last_ms;             // UTC ms of day of the last epoch
+    log_shed_gap_t gaps[LOG_SHED_OUTPUTS];
+} log_shed = {0};
+
+#define LOG_SHED(o) (log_shed.mask & (1U << (o)))
+
+static void log_shed_reset(void) {
+    const char *p = CONFIG_GPS_LOG_SHED_ORDER;
+    memset(&log_shed, 0, sizeof(log_shed));
+    while (*p && log_shed.count < LOG_SHED_OUTPUTS) {
+        size_t len = strcspn(p, ", ");
+        uint8_t o = 0;
+        for (; o < LOG_SHED_OUTPUTS; o++) {
+            if (strlen(log_shed_names[o]) == len && !strncmp(p, log_shed_names[o], len))
+                break;
+        }
+        if (o < LOG_SHED_OUTPUTS && !memchr(log_shed.order, o, log_shed.count)) {
+            log_shed.order[log_shed.count++] = o;
+        } else if (len) {
+            WLOG(TAG, "Shed order: ignoring '%.*s'", (int)len, p);
+        }
+        p += len;
+        while (*p == ',' || *p == ' ')
+            ++p;
+    }
+}
+
+static uint8_t log_ring_pressure(void) {
+    uint32_t dropped = 0;
+    uint8_t pressure = 0;
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        const file_write_ring_t *r = &file_rings[i];
+        if (!r->storage) {
+            continue;
+        }
+        unsigned backlog = atomic_load(&r->head) - atomic_load(&r->tail);
+        uint8_t p = (uint8_t)(backlog * 100 / r->slots);
+        if (p > pressure)
+            pressure = p;
+        dropped += r->dropped;
+    }
+    if (dropped != log_shed.dropped_seen) {
+        log_shed.dropped_seen = dropped;
+        pressure = 100;  // a ring overflowed since the last epoch
+    }
+    return pressure;
+}
+
+static uint32_t log_shed_ms_of_day(const struct nav_pvt_s *nav_pvt) {
+    int32_t ms = c_nano_to_millis_round(nav_pvt->nano);
+    if (ms < 0)
+        ms = 0;
+    if (ms > 999)
+        ms = 999;
+    return ((uint32_t)nav_pvt->hour * 3600 + nav_pvt->minute * 60 + nav_pvt->second) * 1000 + ms;
+}
+
+static void log_shed_put_time(strbf_t *sb, uint32_t ms_of_day) {
+    char tekst[16];
+    uint32_t ms = ms_of_day % 1000;
+    uint32_t s = ms_of_day / 1000;
+    time_to_char_hms(s / 3600, (s / 60) % 60, s % 60, tekst);
+    strbf_puts(sb, tekst);
+    strbf_putc(sb, '.');
+    strbf_putc(sb, '0' + ms / 100);
+    strbf_putc(sb, '0' + (ms / 10) % 10);
+    strbf_putc(sb, '0' + ms % 10);
+}
+
+/**
+ * @brief Write "gap" lines for closed shed intervals (TXT must not be shed)
+ */
+static void log_shed_write_markers(const gps_context_t *context) {
+    char line[80];
+    strbf_t sb;
+    for (uint8_t o = 0; o < LOG_SHED_OUTPUTS; o++) {
+        log_shed_gap_t *gap = &log_shed.gaps[o];
+        if (!gap->pending) {
+            continue;
+        }
+        strbf_inits(&sb, line, sizeof(line));
+        strbf_puts(&sb, "gap ");
+        strbf_puts(&sb, log_shed_names[o]);
+        strbf_putc(&sb, ' ');
+        log_shed_put_time(&sb, gap->start_ms);
+        strbf_putc(&sb, '-');
+        log_shed_put_time(&sb, gap->end_ms);
+        strbf_putc(&sb, ' ');
+        strbf_putul(&sb, gap->frames);
+        strbf_puts(&sb, " frames\n");
+        WRITETXT(strbf_finish(&sb), sb.cur - sb.start);
+        gap->pending = false;
+        gap->frames = 0;
     }
-    async_writer_task_handle = NULL;
-    ILOG(TAG, "Async writer stopped");
 }
 
 /**
- * @brief Queue async write request (non-blocking)
- * @param file_index File index (sd_log_ubx, sd_log_sbp, etc.)
- * @param data Data to write (will be copied and freed by writer task)
- * @param len Length of data
- * @return ESP_OK on success, error otherwise
+ * @brief Adjust the shed level to the ring pressure, once per epoch
+ * @return BIT(log_shed_output_t) mask of outputs to skip this epoch
  */
-static esp_err_t queue_async_write(uint8_t file_index, const uint8_t *data, size_t len) {
-    if (!async_writer_running || !async_writer_queue) {
-        return ESP_ERR_INVALID_STATE;
+static uint8_t log_shed_update(const gps_context_t *context, const struct nav_pvt_s *nav_pvt) {
+    if (!async_writer_running) {
+        return 0;
     }
+    uint8_t pressure = log_ring_pressure();
+    uint32_t now_ms = log_shed_ms_of_day(nav_pvt);
+    log_shed.last_ms = now_ms;
 
-    if (file_index >= sd_log_end) {
-        return ESP_ERR_INVALID_ARG;
+    if (pressure >= CONFIG_GPS_LOG_SHED_HIGH_PERCENT && log_shed.level < log_shed.count) {
+        uint8_t o = log_shed.order[log_shed.level++];
+        log_shed_gap_t *gap = &log_shed.gaps[o];
+        if (!gap->pending) {
+            gap->start_ms = now_ms;  // a still unwritten gap is extended instead
+        }
+        gap->pending = false;
+        log_shed.mask |= 1U << o;
+        log_shed.calm_epochs = 0;
+        WLOG(TAG, "Write backlog %" PRIu8 "%%: shedding %s", pressure, log_shed_names[o]);
+    } else if (pressure <= CONFIG_GPS_LOG_SHED_LOW_PERCENT && log_shed.level) {
+        if (++log_shed.calm_epochs >= ubx_get_effective_output_rate()) {
+            uint8_t o = log_shed.order[--log_shed.level];
+            log_shed.gaps[o].end_ms = now_ms;
+            log_shed.gaps[o].pending = true;
+            log_shed.mask &= ~(1U << o);
+            log_shed.calm_epochs = 0;
+            ILOG(TAG, "Write backlog %" PRIu8 "%%: restored %s", pressure, log_shed_names[o]);
+        }
+    } else {
+        log_shed.calm_epochs = 0;
     }
 
-    if (!data || len == 0) {
-        return ESP_ERR_INVALID_ARG;
+    for (uint8_t o = 0; o < LOG_SHED_OUTPUTS; o++) {
+        if (LOG_SHED(o)) {
+            log_shed.gaps[o].frames++;
+            log_shed.gaps[o].total_frames++;
+        }
+    }
+    if (!LOG_SHED(LOG_SHED_TXT)) {
+        log_shed_write_markers(context);
     }
+    return log_shed.mask;
+}
 
-    // Reject frames too large for the pool (caller falls back to sync write)
-    if (len > ASYNC_POOL_BLOCK_SIZE) {
-        WLOG(TAG, "Frame too large for pool (%zu > %d), using sync write", len, ASYNC_POOL_BLOCK_SIZE);
-        return ESP_ERR_NO_MEM;
+/**
+ * @brief Close all open gaps at the last epoch and write their markers
+ * Called with the producer lock held while the writer still runs.
+ */
+static void log_shed_close(void) {
+    for (uint8_t o = 0; o < LOG_SHED_OUTPUTS; o++) {
+        if (LOG_SHED(o)) {
+            log_shed.gaps[o].end_ms = log_shed.last_ms;
+            log_shed.gaps[o].pending = true;
+        }
     }
+    log_shed.mask = 0;
+    log_shed.level = 0;
+    log_shed_write_markers(gps);
+}
 
-    // Borrow a pre-allocated block from pool (O(1), zero heap pressure)
-    async_pool_block_t *blk = (async_pool_block_t *)logger_fixed_pool_alloc(&async_pool);
-    if (!blk) {
-        WLOG(TAG, "Write pool exhausted for file %"PRIu8" (%zu B), using sync write",
-             file_index, len);
-        return ESP_ERR_NO_MEM;
+static void log_shed_print_stats(void) {
+    printf("[GPS] Shedding level %" PRIu8 "/%" PRIu8, log_shed.level, log_shed.count);
+    for (uint8_t o = 0; o < LOG_SHED_OUTPUTS; o++) {
+        if (log_shed.gaps[o].total_frames) {
+            printf(", %s %" PRIu32 " epochs shed", log_shed_names[o], log_shed.gaps[o].total_frames);
+        }
     }
-    memcpy(blk->data, data, len);
-    blk->len = len;
+    printf("\n");
+}
+#else
+#define LOG_SHED(o) 0
+#endif
 
-    async_write_request_t req = {
-        .type = ASYNC_WRITE_REQUEST_DATA,
-        .file_index = file_index,
-        .block = blk,
-    };
+/**
+ * @brief Hold the producer lock for a whole epoch
+ * All log_reserve()/log_write() calls of this task until log_epoch_end()
+ * then only bump the recursive lock count.
+ */
+static bool log_epoch_begin(void) {
+    return async_writer_running && log_producer_lock(pdMS_TO_TICKS(ASYNC_WRITER_LOCK_TIMEOUT_MS));
+}
 
-    // Non-blocking send (0 timeout)
-    if (xQueueSend(async_writer_queue, &req, 0) != pdTRUE) {
-        logger_fixed_pool_free(&async_pool, blk);
-        ELOG(TAG, "Async writer queue full (dropped %zu bytes for file %"PRIu8")", len, file_index);
-        return ESP_ERR_TIMEOUT;
+static void log_epoch_end(bool locked) {
+    if (locked) {
+        log_producer_unlock();
     }
-
-    return ESP_OK;
 }
 
 /**
- * @brief Queue async flush request
+ * @brief Seal the open slot of a file and wait until the writer wrote it
  */
-static esp_err_t queue_async_flush(uint8_t file_index) {
-    if (!async_writer_running || !async_writer_queue) {
+static esp_err_t async_writer_drain(uint8_t file_index, uint32_t timeout_ms) {
+    if (!async_writer_running || file_index >= sd_log_end) {
         return ESP_ERR_INVALID_STATE;
     }
+    file_write_ring_t *r = &file_rings[file_index];
+    if (!log_producer_lock(pdMS_TO_TICKS(ASYNC_WRITER_LOCK_TIMEOUT_MS))) {
+        return ESP_ERR_TIMEOUT;
+    }
+    ring_seal(r);
+    unsigned head = atomic_load(&r->head);
+    log_producer_unlock();
+    async_writer_kick(true);
 
-    if (file_index >= sd_log_end) {
-        return ESP_ERR_INVALID_ARG;
+    for (uint32_t i = 0; i < timeout_ms / 10
+        && (int)(head - atomic_load(&r->tail)) > 0; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
     }
+    return (int)(head - atomic_load(&r->tail)) > 0 ? ESP_ERR_TIMEOUT : ESP_OK;
+}
 
-    async_write_request_t req = {
-        .type = ASYNC_WRITE_REQUEST_FLUSH,
-        .file_index = file_index,
-        .block = NULL,
-    };
+#if defined(CONFIG_LOGGER_VFS_ENABLED)
+// ============================================================================
+// LOG FILE INDEX - lowest free <name>_<mac>NNN session number. One directory
+// scan after boot or a (re)mount records the numbers in use in RTC memory,
+// later sessions take the lowest free one with one existence check, so open
+// latency does not grow with the sessions on the card.
+// ============================================================================
+#define LOG_INDEX_MAX 1000
+#define LOG_INDEX_VALID 0x4C49
 
-    if (xQueueSend(async_writer_queue, &req, 0) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
-    }
+RTC_DATA_ATTR static struct {
+    uint16_t valid;                          // LOG_INDEX_VALID when used[] is known for prefix
+    uint8_t used[(LOG_INDEX_MAX + 7) / 8];   // Numbers found by the scan or claimed since
+    char prefix[PATH_MAX_CHAR_SIZE];         // filename_base without the index digits
+} log_index;
 
-    return ESP_OK;
+static void log_index_invalidate(void) {
+    log_index.valid = 0;
+}
+
+static void log_index_mark(uint16_t index) {
+    log_index.used[index / 8] |= 1 << (index % 8);
 }
 
 /**
- * @brief Queue async close request
+ * @brief Lowest number not in use, LOG_INDEX_MAX if all are taken
  */
-static esp_err_t queue_async_close(uint8_t file_index) {
-    if (!async_writer_running || !async_writer_queue) {
-        return ESP_ERR_INVALID_STATE;
+static uint16_t log_index_lowest_free(void) {
+    for (uint16_t i = 0; i < LOG_INDEX_MAX; i++) {
+        if (!(log_index.used[i / 8] & (1 << (i % 8)))) {
+            return i;
+        }
     }
+    return LOG_INDEX_MAX;
+}
 
-    if (file_index >= sd_log_end) {
-        return ESP_ERR_INVALID_ARG;
+/**
+ * @brief Record the <prefix>NNN numbers in the log directory
+ */
+static void log_index_scan(const char *base_path, const char *prefix, size_t prefix_len) {
+    memset(log_index.used, 0, sizeof(log_index.used));
+    int64_t start_us = esp_timer_get_time();
+    DIR *dir = opendir(base_path);
+    if (!dir) {
+        WLOG(TAG, "Log dir scan failed (%s) %s", strerror(errno), base_path);
+        return;
+    }
+    struct dirent *entry;
+    uint16_t entries = 0, taken = 0;
+    while ((entry = readdir(dir)) != NULL) {
+        const char *name = entry->d_name, *d;
+        entries++;
+        if (strncasecmp(name, prefix, prefix_len)) {
+            continue;
+        }
+        d = name + prefix_len;
+        if (d[0] < '0' || d[0] > '9' || d[1] < '0' || d[1] > '9' || d[2] < '0' || d[2] > '9'
+            || (d[3] != '.' && d[3] != '\0' && d[3] != '_')) {  // '_' segment files
+            continue;
+        }
+        uint16_t index = (d[0] - '0') * 100 + (d[1] - '0') * 10 + (d[2] - '0');
+        taken += !(log_index.used[index / 8] & (1 << (index % 8)));
+        log_index_mark(index);
     }
+    closedir(dir);
+    ILOG(TAG, "Log dir scan: %" PRIu16 " entries, %" PRIu16 " numbers taken in %" PRId64 "ms",
+         entries, taken, (esp_timer_get_time() - start_us) / 1000);
+}
 
-    async_write_request_t req = {
-        .type = ASYNC_WRITE_REQUEST_CLOSE,
-        .file_index = file_index,
-        .block = NULL,
-    };
+static void log_index_put(char *digits, uint16_t i) {
+    digits[0] = '0' + ((i / 100) % 10);
+    digits[1] = '0' + ((i / 10) % 10);
+    digits[2] = '0' + i % 10;
+}
 
-    if (xQueueSend(async_writer_queue, &req, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
+/**
+ * @brief Claim the lowest free number for filename_base (prefix followed by 3 digits)
+ * The cached numbers cost one existence check, a scan only runs when the cache
+ * is cold or stale. Names the scan cannot see (8.3 only volumes) fall back to probing.
+ * @return false if all LOG_INDEX_MAX numbers are taken, filename_base is then unusable
+ */
+static bool log_index_claim(const char *base_path, char *filename_base, size_t prefix_len) {
+    char *digits = filename_base + prefix_len;
+    bool cached = log_index.valid == LOG_INDEX_VALID
+               && strlen(log_index.prefix) == prefix_len
+               && !strncmp(log_index.prefix, filename_base, prefix_len);
+    if (!cached) {
+        log_index_scan(base_path, filename_base, prefix_len);
+    }
+    uint16_t i;
+    for (i = log_index_lowest_free(); i < LOG_INDEX_MAX; i = log_index_lowest_free()) {
+        log_index_put(digits, i);
+        if (!s_xfile_exists(filename_base)) {
+            break;
+        }
+        if (cached) {
+            cached = false;  // card changed behind our back
+            log_index_scan(base_path, filename_base, prefix_len);
+            continue;
+        }
+        log_index_mark(i);  // a name the scan could not match
     }
-
-    return ESP_OK;
+    if (i >= LOG_INDEX_MAX) {
+        log_index_invalidate();  // rescan next time, sessions may have been deleted
+        return false;
+    }
+    log_index_mark(i);
+    memcpy(log_index.prefix, filename_base, prefix_len);
+    log_index.prefix[prefix_len] = '\0';
+    log_index.valid = LOG_INDEX_VALID;
+    return true;
 }
+#endif
 
 // ============================================================================
 // VFS EVENT HANDLERS - Reinitialize logging config when partition available
@@ -640,6 +2241,11 @@ static void vfs_event_handler(void *arg, esp_event_base_t event_base, int32_t ev
 
     const bool partition_available = gps_log_partition_is_available();
 
+#if defined(CONFIG_LOGGER_VFS_ENABLED)
+    if (is_mount_event || is_unmount_event) {
+        log_index_invalidate();  // possibly another card, rescan on next open
+    }
+#endif
     if (partition_available && is_mount_event) {
         ILOG(TAG, "VFS partition available - refreshing GPS log config and scheduling file reopen");
         gps_log_config_init();
@@ -689,44 +2295,122 @@ void gps_log_unregister_vfs_handler(void) {
 
 /**
  * @brief Write data to file (async buffered)
- * Replaces synchronous write with async buffered write for 20Hz+ performance
+ * Copies into the file's write ring; frames larger than a slot are split.
+ * Writes synchronously while the writer is not running (headers, footers).
  */
 size_t log_write(const struct gps_context_s * context, uint8_t file, const void *msg, size_t len) {
     int fd = GET_FD(file);
-    if (fd < 0)
+    if (fd < 0 || !len)
+        return 0;
+    if (file == sd_log_txt && LOG_SHED(LOG_SHED_TXT))
+        return 0;  // counted per epoch, reported as a gap marker
+    if (!log_producer_lock(pdMS_TO_TICKS(ASYNC_WRITER_LOCK_TIMEOUT_MS)))
         return 0;
 
-    // Use async writer if running
-    if (async_writer_running) {
-        esp_err_t err = queue_async_write(file, (const uint8_t *)msg, len);
-        if (err == ESP_OK) {
-            return len; // Return requested length on successful queue
+    const uint8_t *src = (const uint8_t *)msg;
+    size_t done = 0;
+    file_write_ring_t *r = &file_rings[file];
+    if (async_writer_running && r->storage) {
+        // bytes_in is counted per piece by log_commit()
+        while (done < len) {
+            size_t chunk = len - done;
+            if (chunk > ASYNC_SLOT_PAYLOAD) {
+                // Larger than a slot: top up the open slot, continue in the next
+                chunk = ASYNC_SLOT_PAYLOAD - atomic_load(&r->fill);
+            }
+            uint8_t *dst = log_reserve(context, file, chunk);
+            if (!dst)
+                break;
+            memcpy(dst, src + done, chunk);
+            log_commit(context, file, chunk);
+            done += chunk;
         }
-        // Fall through to synchronous write on error
-        WLOG(TAG, "Async write failed, falling back to sync");
-    }
-
-    // Fallback: synchronous write
-    ssize_t result = write(fd, msg, len);
-    if (result < 0) {
-        ELOG(TAG, "Failed to write (%s) %" PRIu8, strerror(errno), file);
+    } else {
+        // Fallback: synchronous write
+        file_io[file].bytes_in += len;
+#if defined(GPS_LOG_HAS_CHUNKS) || defined(CONFIG_GPS_LOG_UBZ)
+        // One chunk/block per scratch frame, header room in front of the copied payload
+        while (done < len) {
+            size_t chunk = len - done < LOG_SYNC_FRAME_SIZE ? len - done : LOG_SYNC_FRAME_SIZE;
+            memcpy(log_sync_frame + LOG_CHUNK_HEADER_SIZE, src + done, chunk);
+            ssize_t result = log_write_block(file, fd, log_sync_frame, chunk);
+            if (result < 0) {
+                ELOG(TAG, "Failed to write (%s) %" PRIu8, strerror(errno), file);
+                break;
+            }
+            done += (size_t)result;
+        }
+#else
+        ssize_t result = log_io_write(file, fd, msg, len);
+        if (result < 0) {
+            ELOG(TAG, "Failed to write (%s) %" PRIu8, strerror(errno), file);
+        } else {
+            done = (size_t)result;
+        }
+#endif
     }
-    return result;
+    log_producer_unlock();
+    return done;
 }
 
-static void write_log_file_header_if_empty(gps_context_t *context,
-                                           uint8_t file_index) {
-    struct stat file_stat = {0};
-    int fd = GET_FD(file_index);
-
-    if (!context || fd < 0) {
-        return;
+/**
+ * @brief Write the parts of one frame back to back, all or nothing
+ * The frame may span ring slots. Without room for all of it in the ring it is
+ * dropped and counted like a frame log_reserve() has no room for, so a reader
+ * never sees half a message.
+ * @return bytes written, 0 if dropped
+ */
+size_t log_write_parts(const struct gps_context_s * context, uint8_t file, const log_part_t *parts, size_t count) {
+    if (file >= sd_log_end || GET_FD(file) < 0)
+        return 0;
+    if (!log_producer_lock(pdMS_TO_TICKS(ASYNC_WRITER_LOCK_TIMEOUT_MS)))
+        return 0;
+    size_t total = 0, done = 0;
+    for (size_t i = 0; i < count; i++)
+        total += parts[i].len;
+    file_write_ring_t *r = &file_rings[file];
+    if (!async_writer_running || !r->storage) {
+        for (size_t i = 0; i < count; i++)
+            done += log_write(context, file, parts[i].data, parts[i].len);
+        log_producer_unlock();
+        return done;
+    }
+
+    // The producer lock is held, the writer can only free slots meanwhile
+    unsigned queued = atomic_load(&r->head) - atomic_load(&r->tail);
+    size_t room = queued >= r->slots ? 0
+                : (ASYNC_SLOT_PAYLOAD - atomic_load(&r->fill))
+                  + (size_t)(r->slots - queued - 1) * ASYNC_SLOT_PAYLOAD;
+    if (room < total) {
+        if ((r->dropped++ & 0x3F) == 0) {
+            WLOG(TAG, "Write ring full for file %"PRIu8", dropped %" PRIu32 " frames",
+                 file, r->dropped);
+        }
+        async_writer_kick(true);
+        log_producer_unlock();
+        return 0;
     }
-
-    if (fstat(fd, &file_stat) != 0 || file_stat.st_size > 0) {
-        return;
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *src = (const uint8_t *)parts[i].data;
+        for (size_t off = 0; off < parts[i].len;) {
+            // Top up the open slot, log_commit() seals it once full
+            size_t chunk = ASYNC_SLOT_PAYLOAD - atomic_load(&r->fill);
+            if (chunk > parts[i].len - off)
+                chunk = parts[i].len - off;
+            uint8_t *dst = log_reserve(context, file, chunk);
+            if (!dst)
+                break;
+            memcpy(dst, src + off, chunk);
+            log_commit(context, file, chunk);
+            off += chunk;
+            done += chunk;
+        }
     }
+    log_producer_unlock();
+    return done;
+}
 
+static void write_log_file_header(gps_context_t *context, uint8_t file_index) {
     if (file_index == sd_log_sbp) {
         log_header_SBP(context);
     }
@@ -743,32 +2427,59 @@ static void write_log_file_header_if_empty(gps_context_t *context,
         log_header_GPY(context);
     }
 #endif
+}
+
+static void write_log_file_header_if_empty(gps_context_t *context,
+                                           uint8_t file_index) {
+    struct stat file_stat = {0};
+    int fd = GET_FD(file_index);
+
+    if (!context || fd < 0) {
+        return;
+    }
+
+#if defined(CONFIG_GPS_LOG_CONTAINER)
+    (void)file_stat;
+    if (!log_container.created) {
+        return;
+    }
+#else
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size > 0) {
+        return;
+    }
+#endif
 
+    write_log_file_header(context, file_index);
 }
 
 /**
- * @brief Close file (async close + flush)
+ * @brief Close file (flushes its ring first)
  */
 int log_close(const struct gps_context_s * context, uint8_t file) {
     int fd = GET_FD(file);
     if (fd < 0)
         return fd;
 
-    // Queue async close request (flushes buffer automatically)
-    if (async_writer_running) {
-        queue_async_close(file);
-        // Wait for queue to drain (bounded, up to 500ms)
-        for (int i = 0; i < 50
-            && uxQueueMessagesWaiting(async_writer_queue) > 0; i++) {
-            vTaskDelay(pdMS_TO_TICKS(10));
-        }
+#if defined(CONFIG_GPS_LOG_CONTAINER)
+    if (fd == log_container.fd && log_container.streams > 1) {
+        log_container.streams--;  // the last stream closes the shared file
+        return 0;
     }
-
+#endif
     log_fsync(context, file);
+#if defined(CONFIG_GPS_LOG_PREALLOCATE)
+    log_prealloc_trim(log_file_alloc(file), fd);
+#endif
     int result = close(fd);
     if (result < 0) {
         ELOG(TAG, "Failed to close (%s) fd: %" PRIu8, strerror(errno), file);
     }
+#if defined(CONFIG_GPS_LOG_CONTAINER)
+    if (fd == log_container.fd) {
+        log_container.fd = -1;
+        log_container.streams = 0;
+    }
+#endif
     return result;
 }
 
@@ -780,21 +2491,12 @@ int log_fsync(const struct gps_context_s * context, uint8_t file) {
     if (fd < 0)
         return fd;
 
-    // Queue async flush if writer running
+    // Have the writer write the partial slot first (bounded, up to 250ms)
     if (async_writer_running) {
-        queue_async_flush(file);
-        // Wait for queue to drain (bounded, up to 250ms)
-        for (int i = 0; i < 25
-            && uxQueueMessagesWaiting(async_writer_queue) > 0; i++) {
-            vTaskDelay(pdMS_TO_TICKS(10));
-        }
+        async_writer_drain(file, 250);
     }
 
-    int result = fsync(fd);
-    if (result < 0) {
-        ELOG(TAG, "Failed to sync (%s) %" PRIu8, strerror(errno), file);
-    }
-    return result;
+    return log_io_fsync(file, fd, NULL);
 }
 
 void log_err(const gps_context_t *context, const char *message) {
@@ -878,6 +2580,132 @@ gps_log_file_config_t *gps_log_config_init(void) {
 #define FILE_APPEND "a"
 #endif
 
+#if defined(CONFIG_GPS_LOG_INDEX)
+// ============================================================================
+// TIME INDEX - .idx sidecar: file offsets of the UBX and GPY epochs every
+// GPS_LOG_INDEX_INTERVAL_S and at run starts, appended by the writer. Without
+// UBZ, chunks or a container every committed byte lands in the file as is,
+// so the offset is the committed byte count from where the file (or segment)
+// started plus what the file held before.
+// ============================================================================
+
+static struct {
+    bool open;
+    int32_t last_ms;         // get_millis() of the last periodic entry
+    uint16_t last_run;
+    int64_t base[sd_log_end];     // File offset minus bytes_in
+    uint8_t segment[sd_log_end];  // Segment the producer writes to
+} log_idx;
+
+static void log_idx_base(uint8_t file_index, int64_t offset) {
+    log_idx.base[file_index] = offset - (int64_t)file_io[file_index].bytes_in;
+}
+
+static void log_idx_open(gps_context_t *context) {
+    gps_log_file_config_t *config = context->log_config;
+    char name[PATH_MAX_CHAR_SIZE + 8];
+    strcpy(name, config->filename_base);
+    strcat(name, ".idx");
+    int fd = s_open(name, config->base_path, FILE_APPEND);
+    if (fd < 0) {
+        ELOG(TAG, "Failed to open index %s", name);
+        return;
+    }
+    if (lseek(fd, 0, SEEK_END) == 0) {
+        struct GPS_Idx_Header header = {
+            .magic = GPS_IDX_MAGIC,
+            .version = GPS_IDX_VERSION,
+            .entry_size = sizeof(struct GPS_Idx_Entry),
+            .interval_ms = CONFIG_GPS_LOG_INDEX_INTERVAL_S * 1000,
+        };
+        if (write(fd, &header, sizeof(header)) != sizeof(header)) {
+            ELOG(TAG, "Index header write failed (%s)", strerror(errno));
+        }
+    }
+    log_side_attach(LOG_SIDE_INDEX, fd, false);
+    // Headers are written and the rings are empty: the data ends at the end of the file,
+    // an O_APPEND fd that has not written yet reports 0 for SEEK_CUR. Preallocated files
+    // are reopened without O_APPEND at their logical end, before the zero filled tail.
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        int whence = SEEK_END;
+#if defined(CONFIG_GPS_LOG_PREALLOCATE)
+        if (GET_FD(i) >= 0 && *log_file_alloc(i)) {
+            whence = SEEK_CUR;
+        }
+#endif
+        off_t pos = GET_FD(i) >= 0 ? lseek(GET_FD(i), 0, whence) : 0;
+        log_idx_base(i, pos < 0 ? 0 : pos);
+        log_idx.segment[i] = 0;
+    }
+    log_idx.open = true;
+    log_idx.last_ms = get_millis() - CONFIG_GPS_LOG_INDEX_INTERVAL_S * 1000;  // first epoch is indexed
+    log_idx.last_run = context->run_count;
+}
+
+#if defined(CONFIG_GPS_LOG_SEGMENT_ENABLED)
+/**
+ * @brief Producer: the next bytes of the file start segment n at offset 0
+ */
+static void log_idx_segment(uint8_t file_index, uint8_t n) {
+    log_idx_base(file_index, 0);
+    log_idx.segment[file_index] = n;
+}
+#endif
+
+static void log_idx_close(void) {
+    log_idx.open = false;
+    int fd = log_side_detach(LOG_SIDE_INDEX);
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+/**
+ * @brief Producer: index this epoch if due, before its frames are encoded
+ */
+static void log_idx_epoch(gps_context_t *context, const struct nav_pvt_s *nav_pvt) {
+    if (!log_idx.open) {
+        return;
+    }
+    int32_t now = get_millis();
+    uint8_t flags = 0;
+    if (now - log_idx.last_ms >= CONFIG_GPS_LOG_INDEX_INTERVAL_S * 1000) {
+        flags |= GPS_IDX_FLAG_TIME;
+        log_idx.last_ms = now;
+    }
+    if (context->run_count != log_idx.last_run) {
+        flags |= GPS_IDX_FLAG_RUN;
+        log_idx.last_run = context->run_count;
+    }
+    if (!flags) {
+        return;
+    }
+    struct GPS_Idx_Entry entry = {
+        .utc_ms = (int64_t)c_utc_ms_from_date_time(nav_pvt->year, nav_pvt->month, nav_pvt->day,
+                                                   nav_pvt->hour, nav_pvt->minute, nav_pvt->second,
+                                                   c_nano_to_millis_round(nav_pvt->nano), NULL),
+        .flags = flags,
+        .run = context->run_count,
+    };
+    if (GET_FD(sd_log_ubx) >= 0) {
+        entry.stream = GPS_IDX_STREAM_UBX;
+        entry.offset = (uint64_t)(log_idx.base[sd_log_ubx] + (int64_t)file_io[sd_log_ubx].bytes_in);
+        entry.segment = log_idx.segment[sd_log_ubx];
+        log_side_append(LOG_SIDE_INDEX, &entry, sizeof(entry));
+    }
+#if defined(GPS_LOG_HAS_GPY)
+    if (GET_FD(sd_log_gpy) >= 0) {
+        log_footer_GPY(context);  // the open v2 block holds older frames, not at the entry
+        entry.stream = GPS_IDX_STREAM_GPY;
+        entry.offset = (uint64_t)(log_idx.base[sd_log_gpy] + (int64_t)file_io[sd_log_gpy].bytes_in);
+        entry.segment = log_idx.segment[sd_log_gpy];
+        log_side_append(LOG_SIDE_INDEX, &entry, sizeof(entry));
+        context->next_gpy_full_frame = 1;  // decodable from the entry on
+    }
+#endif
+}
+#endif
+
 // esp_err_t save_log_file_bits(gps_context_t *context, uint8_t *log_file_bits) {
 //     assert(context && context->log_config);
 //     logger_config_t *config = context->log_config->config;
@@ -919,6 +2747,10 @@ void open_files(gps_context_t *context) {
     }
 
     // Partition is available - safe to proceed with file operations
+    if (!log_producer_mutex) {
+        log_producer_mutex = xSemaphoreCreateRecursiveMutex();
+    }
+    memset(file_io, 0, sizeof(file_io));
     gps_log_file_config_t *config = context->log_config;
     // logger_config_t *cfg = config->config;
     // save_log_file_bits(context, log_config.log_file_bits);
@@ -977,21 +2809,24 @@ void open_files(gps_context_t *context) {
         strbf_puts(&sb, macAddr);
         int filenameSize = sb.cur - sb.start;  // dit is dan 7 + NULL = 8
         strbf_puts(&sb, "000");                 // dit wordt dan /BN280A000.txt
-        for (uint16_t i = 0; i < 1000; i++) {
-            config->filename_base[filenameSize + 2] = '0' + i % 10;
-            config->filename_base[filenameSize + 1] = '0' + ((i / 10) % 10);
-            config->filename_base[filenameSize] = '0' + ((i / 100) % 10);
-            // create if does not exist, do not open existing, write, sync after
-            // write
 #if defined(CONFIG_LOGGER_VFS_ENABLED)
-            if (!s_xfile_exists(config->filename_base)) {
-                break;
+        if (!log_index_claim(config->base_path, config->filename_base, filenameSize)) {
+            ELOG(TAG, "All %d log file numbers of %.*s are taken, not logging", LOG_INDEX_MAX,
+                 filenameSize, config->filename_base);
+            if (esp_event_post(GPS_LOG_EVENT, GPS_LOG_EVENT_LOG_FILES_OPEN_FAILED, NULL, 0,
+                               pdMS_TO_TICKS(100)) != ESP_OK) {
+                WLOG(TAG, "EVT_FAIL: LOG_FILES_OPEN_FAILED");
             }
-#endif
+            return;
         }
+#endif
     }
         // Refresh selection from runtime config just before open
         gps_log_sync_bits_from_config(config);
+#if defined(CONFIG_GPS_LOG_PREALLOCATE)
+    log_prealloc_recover(config->base_path);
+    log_prealloc_mark(config);  // before the first zero is written
+#endif
     const char * fn = 0;
     cfg_gps_log_enables_t *enables = &g_rtc_config.gps.log_enables;
     if(!gps_log_file_bits_check(enables)) // at least one file must be opened
@@ -999,29 +2834,55 @@ void open_files(gps_context_t *context) {
     for(uint8_t i = 0; i < sd_log_end; i++) {
         FUNC_ENTRY_ARGSD(TAG, "opening %s", config->filenames[i]);
         if (gps_log_file_is_enabled(enables, i)) {
-            fn = i == sd_log_ubx ? ".ubx"
-                : i == sd_log_sbp ? ".sbp"
-                : i == sd_log_gpx ? ".gpx"
-#if defined(GPS_LOG_HAS_OAO)
-                : i == sd_log_oao ? ".oao"
-#endif
-#if defined(GPS_LOG_HAS_GPY)
-                : i == sd_log_gpy ? ".gpy"
-#endif
-                : ".txt";
+            fn = log_file_ext(i);
             strcpy(config->filenames[i], config->filename_base);
             strcat(config->filenames[i], fn);
             FUNC_ENTRY_ARGSD(TAG, "opening %s", config->filenames[i]);
+#if defined(GPS_LOG_HAS_CHUNKS)
+            log_chunk_seq[i] = 0;  // chunk 0 is flagged GLC_CHUNK_FLAG_FIRST
+#endif
 #if defined(CONFIG_LOGGER_VFS_ENABLED)
+#if defined(CONFIG_GPS_LOG_CONTAINER)
+            GET_FD(i) = log_container_open(config, enables);
+#else
             GET_FD(i) = s_open(config->filenames[i], config->base_path, FILE_APPEND);
+#endif
             if(GET_FD(i) < 0) {
                 open_failed++;
             } else {
+#if defined(CONFIG_GPS_LOG_CONTAINER)
+                log_container.streams++;
+#endif
                 write_log_file_header_if_empty(context, i);
+#if defined(CONFIG_GPS_LOG_PREALLOCATE) && !defined(CONFIG_GPS_LOG_CONTAINER)
+                GET_FD(i) = log_preallocate(config->filenames[i], config->base_path, GET_FD(i),
+                                            log_prealloc_estimate(i), &file_alloc[i]);
+                if (GET_FD(i) < 0)
+                    open_failed++;
+#endif
             }
 #endif
         }
     }
+#if defined(CONFIG_GPS_LOG_CONTAINER) && defined(CONFIG_GPS_LOG_PREALLOCATE)
+    if (log_container.fd >= 0) {
+        // One extent for the whole session: the sum of the stream estimates
+        size_t estimate = 0;
+        for (uint8_t i = 0; i < sd_log_end; i++) {
+            if (GET_FD(i) == log_container.fd)
+                estimate += log_prealloc_estimate(i);
+        }
+        int fd = log_preallocate(log_container.filename, config->base_path, log_container.fd,
+                                 estimate, &log_container.alloc);
+        for (uint8_t i = 0; i < sd_log_end; i++) {
+            if (GET_FD(i) == log_container.fd)
+                GET_FD(i) = fd;
+        }
+        if (fd < 0)
+            open_failed++;
+        log_container.fd = fd;
+    }
+#endif
     if (esp_event_post(GPS_LOG_EVENT,
                       open_failed ? GPS_LOG_EVENT_LOG_FILES_OPEN_FAILED
                                   : GPS_LOG_EVENT_LOG_FILES_OPENED,
@@ -1035,12 +2896,26 @@ void open_files(gps_context_t *context) {
     }
 
     // Start async writer after files opened (only if partition is still available)
+    log_rate_reset();
+#if defined(CONFIG_GPS_LOG_SEGMENT_ENABLED)
+    log_segment_reset();
+#endif
     if (!open_failed && gps_log_partition_is_available()) {
         esp_err_t err = async_writer_start();
         if (err != ESP_OK) {
             WLOG(TAG, "Failed to start async writer, using synchronous writes");
         }
     }
+#if defined(CONFIG_GPS_LOG_SUMMARY_JOURNAL)
+    if (context->files_opened) {
+        log_journal_open_SUM(context);
+    }
+#endif
+#if defined(CONFIG_GPS_LOG_INDEX)
+    if (context->files_opened) {
+        log_idx_open(context);
+    }
+#endif
 }
 
 void close_files(gps_context_t *context) {
@@ -1059,10 +2934,36 @@ void close_files(gps_context_t *context) {
             if (i == sd_log_gpx) {
                 log_footer_GPX(context);
             }
+#if defined(GPS_LOG_HAS_GPY)
+            if (i == sd_log_gpy) {
+                log_footer_GPY(context);
+            }
+#endif
             log_close(context, i);
             GET_FD(i) = -1;
+#if defined(GPS_LOG_HAS_OAO)
+            if (i == sd_log_oao) {
+                log_close_OAO(context);
+            }
+#endif
         }
     }
+#if defined(CONFIG_GPS_LOG_SEGMENT_ENABLED)
+    log_segment_close(config);
+#endif
+#if defined(CONFIG_GPS_LOG_PREALLOCATE)
+    log_prealloc_unmark(config);
+#endif
+#if defined(CONFIG_GPS_LOG_SUMMARY_JOURNAL)
+    // Closed without the session summary: left unsealed for recovery
+    int journal_fd = log_side_detach(LOG_SIDE_JOURNAL);
+    if (journal_fd >= 0) {
+        close(journal_fd);
+    }
+#endif
+#if defined(CONFIG_GPS_LOG_INDEX)
+    log_idx_close();
+#endif
     context->files_opened = 0;
     if (esp_event_post(GPS_LOG_EVENT, GPS_LOG_EVENT_LOG_FILES_CLOSED,
                       NULL, 0, pdMS_TO_TICKS(100)) != ESP_OK) {
@@ -1072,6 +2973,16 @@ void close_files(gps_context_t *context) {
 
 static int load_balance = 0;
 
+/**
+ * @brief fsync a file unless the durability scheduler of the writer owns it
+ */
+static void flush_file(const gps_context_t *context, uint8_t file) {
+    if (async_writer_running && file_syncs[file].window_ms) {
+        return;
+    }
+    log_fsync(context, file);
+}
+
 void flush_files(const gps_context_t *context) {
     if(!context) return;
     if (!context->files_opened) {
@@ -1079,25 +2990,25 @@ void flush_files(const gps_context_t *context) {
     }
     if (ubx_get_effective_output_rate() <= 10) {
         if (load_balance == sd_log_ubx) {
-            log_fsync(context, sd_log_ubx);
+            flush_file(context, sd_log_ubx);
         }
         if (load_balance == sd_log_txt) {
-            log_fsync(context, sd_log_txt);
+            flush_file(context, sd_log_txt);
         }
         if (load_balance == sd_log_sbp) {
-            log_fsync(context, sd_log_sbp);
+            flush_file(context, sd_log_sbp);
         }
         if (load_balance == sd_log_gpx) {
-            log_fsync(context, sd_log_gpx);
+            flush_file(context, sd_log_gpx);
 #if defined(GPS_LOG_HAS_OAO)
         }
         if (load_balance == sd_log_oao) {
-            log_fsync(context, sd_log_oao);
+            flush_file(context, sd_log_oao);
 #endif
 #if defined(GPS_LOG_HAS_GPY)
         }
         if (load_balance == sd_log_gpy) {
-            log_fsync(context, sd_log_gpy);
+            flush_file(context, sd_log_gpy);
 #endif
             load_balance = -1;
         }
@@ -1134,6 +3045,66 @@ esp_err_t log_gps_timeout(const gps_context_t *context, uint32_t time_diff_ms, c
     return ESP_OK;
 }
 
+// ============================================================================
+// OUTPUT RATES - per format decimation ahead of the encoders. A format at N Hz
+// takes the first epoch in each 1/N s slot of the UTC second, the same epochs
+// for every format at that rate and whole seconds at 1 Hz. A rate of 0 or at
+// or above the receiver rate logs every epoch. Defaults CONFIG_GPS_LOG_*_HZ,
+// changed at runtime with gps_log_file_set_rate(). TXT is not per epoch.
+// ============================================================================
+#ifndef CONFIG_GPS_LOG_GPX_RATE_HZ
+#define CONFIG_GPS_LOG_GPX_RATE_HZ 1
+#endif
+#define LOG_RATE_HZ_MAX 50
+
+static uint8_t log_rate_hz[sd_log_end] = {
+    [sd_log_sbp] = CONFIG_GPS_LOG_RATE_HZ_SBP,
+    [sd_log_ubx] = CONFIG_GPS_LOG_RATE_HZ_UBX,
+    [sd_log_gpx] = CONFIG_GPS_LOG_GPX_RATE_HZ,
+#if defined(GPS_LOG_HAS_OAO)
+    [sd_log_oao] = CONFIG_GPS_LOG_RATE_HZ_OAO,
+#endif
+#if defined(GPS_LOG_HAS_GPY)
+    [sd_log_gpy] = CONFIG_GPS_LOG_RATE_HZ_GPY,
+#endif
+};
+static int64_t log_rate_slot[sd_log_end];  // Rate slot of the last logged epoch, -1 none
+
+static void log_rate_reset(void) {
+    for (uint8_t i = 0; i < sd_log_end; i++) {
+        log_rate_slot[i] = -1;
+    }
+}
+
+/**
+ * @brief True if the epoch opens a new rate slot of the file and is to be logged
+ */
+static bool log_rate_due(uint8_t file, const gps_log_epoch_t *epoch) {
+    uint8_t hz = log_rate_hz[file];
+    if (hz == 0 || epoch->utc_ms <= 0) {
+        return true;
+    }
+    int64_t slot = epoch->utc_ms / 1000 * hz + epoch->utc_ms % 1000 * hz / 1000;
+    if (slot == log_rate_slot[file]) {
+        return false;
+    }
+    log_rate_slot[file] = slot;
+    return true;
+}
+
+esp_err_t gps_log_file_set_rate(uint8_t file, uint8_t hz) {
+    if (file >= sd_log_end || file == sd_log_txt || hz > LOG_RATE_HZ_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    log_rate_hz[file] = hz;
+    log_rate_slot[file] = -1;
+    return ESP_OK;
+}
+
+uint8_t gps_log_file_get_rate(uint8_t file) {
+    return file < sd_log_end ? log_rate_hz[file] : 0;
+}
+
 // ============================================================================
 // GPS LOG TO FILE - Main entry point called from GPS task
 // Formats GPS data and writes to enabled file formats via async writer
@@ -1147,27 +3118,46 @@ void log_to_file(gps_context_t *context) {
 
     struct nav_pvt_s * nav_pvt = &ubx->ubx_msg.navPvt;
 
-    // Log data in all enabled formats (consolidated bit checks)
+    // Log data in all enabled formats (consolidated bit checks), batched
+    // under one producer lock per epoch
     cfg_gps_log_enables_t enables = g_rtc_config.gps.log_enables;
-    if (enables.bits.log_ubx) {
-        log_ubx(context, &ubx->ubx_msg, g_rtc_config.ubx.log_sat_details);
+    bool epoch_locked = log_epoch_begin();
+#if defined(CONFIG_GPS_LOG_SHED_ENABLED)
+    log_shed_update(context, nav_pvt);
+#endif
+#if defined(CONFIG_GPS_LOG_SEGMENT_ENABLED)
+    log_segment_check(context);
+#endif
+#if defined(CONFIG_GPS_LOG_INDEX)
+    log_idx_epoch(context, nav_pvt);
+#endif
+    // One decoded epoch for all frame encoders, its time drives the output rates
+    gps_log_epoch_t epoch;
+    log_ubx_epoch(&ubx->ubx_msg, &epoch);
+    if (enables.bits.log_ubx && log_rate_due(sd_log_ubx, &epoch)) {
+        log_ubx(context, &ubx->ubx_msg, g_rtc_config.ubx.log_sat_details,
+                !LOG_SHED(LOG_SHED_NAV_SAT));
     }
-    if (enables.bits.log_sbp) {
-        log_SBP(context);
+    if (enables.bits.log_sbp && !LOG_SHED(LOG_SHED_SBP) && log_rate_due(sd_log_sbp, &epoch)) {
+        log_SBP(context, &epoch);
     }
-    if (enables.bits.log_gpx) {
-        log_GPX(context);
+    if (enables.bits.log_gpx && !LOG_SHED(LOG_SHED_GPX) && log_rate_due(sd_log_gpx, &epoch)) {
+        log_GPX(context, &epoch);
     }
 #if defined(GPS_LOG_HAS_OAO)
-    if (enables.bits.log_oao) {
-        log_OAO(context);
+    if (enables.bits.log_oao && !LOG_SHED(LOG_SHED_OAO) && log_rate_due(sd_log_oao, &epoch)) {
+        log_OAO(context, &epoch);
     }
 #endif
 #if defined(GPS_LOG_HAS_GPY)
-    if (enables.bits.log_gpy) {
-        log_GPY(context);
+    if (enables.bits.log_gpy && log_rate_due(sd_log_gpy, &epoch)) {
+        log_GPY(context, &epoch);
     }
 #endif
+#if defined(CONFIG_GPS_LOG_SUMMARY_JOURNAL)
+    log_journal_SUM(context);
+#endif
+    log_epoch_end(epoch_locked);
 }
 
 // Prints the content of a file to the Serial
@@ -1499,7 +3489,14 @@ static void gps_metrics_result_max(void) {
 
 void gps_speed_metrics_save_session(void) {
     FUNC_ENTRY(TAG);
+#if defined(CONFIG_GPS_LOG_SUMMARY_BINARY)
+    // One binary record set instead of the formatted results, rendered by scripts/gps_summary.py
+    if (gps->files_opened) {
+        log_session_SUM(gps);
+    }
+#endif
     if (g_rtc_config.gps.log_enables.bits.log_txt && gps->log_config->filefds[sd_log_txt] > 0) {
+#if !defined(CONFIG_GPS_LOG_SUMMARY_BINARY)
         session_info(gps, &gps->Ublox);
         gps_metrics_result_max();
         for(uint8_t i = 0, j = gps->num_speed_metrics; i < j; i++) {
@@ -1512,6 +3509,8 @@ void gps_speed_metrics_save_session(void) {
                 }
             }
         }
+#endif
+        log_io_summary();
     }
 }
 
@@ -808,6 +808,7 @@ static inline void move_distance_window(struct gps_speed_by_dist_s *me) {
 float update_speed_by_distance(struct gps_speed_by_dist_s *me) {
     // printf("[%s]\n", __func__);
     if(!me) return 0.0f;
+    if (!log_p_lctx.buf_gspeed_size) return me->speed.max_speed;  // speed buffer not allocated
     // uint32_t distance_window = convert_distance_to_mm(me->distance_window, g_rtc_config.ubx.output_rate);  // Note that m_distance_window should now be in mm, so multiply by 1000 and consider the sample_rate !!
     me->distance = me->distance + log_p_lctx.buf_gspeed[buf_index(log_p_lctx.index_gspeed)];  // the resolution of the distance is 0.1 mm
                                                                                   // the max int32  is 2,147,483,647 mm eq 214,748.3647 meters eq ~214 kilometers !!
@@ -915,9 +916,10 @@ static inline void store_and_reset_time_data_after_run(struct gps_speed_by_time_
 static inline bool store_avg_speed_by_time_optimized(struct gps_speed_by_time_s *me, uint32_t time_window_delta, uint8_t sample_rate) {
     // printf("[%s] %" PRIu32 "\n", __func__, time_window_delta);
     bool window_reached = false;
-    const uint32_t current_speed = log_p_lctx.buf_gspeed[buf_index(log_p_lctx.index_gspeed)];
 
     if (time_window_delta < log_p_lctx.buf_gspeed_size) {  // if time window is smaller than the sample_rate*BUFFER, use normal buffer
+        // never taken without a speed buffer (size 0), then only the seconds buffer is used
+        const uint32_t current_speed = log_p_lctx.buf_gspeed[buf_index(log_p_lctx.index_gspeed)];
         me->avg_s_sum += current_speed;  // always add gSpeed at every update
         if (log_p_lctx.index_gspeed >= time_window_delta) { // once window is reached, subtract old value from the sum
             me->avg_s_sum -= log_p_lctx.buf_gspeed[buf_index(log_p_lctx.index_gspeed - time_window_delta)];
@@ -0,0 +1,94 @@
+#ifndef GPS_LOG_CHECKSUM_H
+#define GPS_LOG_CHECKSUM_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+/// Checksum kernels shared by the writers (gps_log_encode.c) and the readers
+/// (gps_log_reader.h): the 8-bit Fletcher sums of GPY (Fletcher16), OAO and UBX.
+///
+/// All three keep both sums modulo 256. 2^32 is a multiple of 256, so the sums
+/// run in plain 32-bit accumulators without masking and only their low bytes
+/// are used. That allows blocks of bytes at a time: over n bytes x0..xn-1,
+/// a += sum(x) and b += n * a + sum((n - i) * xi). The MCU takes 8 bytes per
+/// step, hosts with SSSE3 16. scripts/gps_log_checksum_bench.c checks them
+/// against the byte loop and measures them.
+
+typedef struct {
+    uint32_t a, b;           // only the low bytes count
+} gps_log_fletcher_t;
+
+#if defined(__SSSE3__)
+static inline uint32_t gps_log_hsum_epi32(__m128i v) {
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t)_mm_cvtsi128_si32(v);
+}
+#endif
+
+/** @brief Add n bytes to the running sums, chunks can be fed one after the other */
+static inline void gps_log_fletcher_update(gps_log_fletcher_t *s, const uint8_t *p, size_t n) {
+    uint32_t a = s->a, b = s->b;
+#if defined(__SSSE3__)
+    if (n >= 16) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ones = _mm_set1_epi16(1);
+        const __m128i weights = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+        __m128i va = zero, vprefix = zero, vb = zero;
+        size_t blocks = n / 16;
+        for (size_t i = 0; i < blocks; i++) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(p + i * 16));
+            vprefix = _mm_add_epi32(vprefix, va);  // a of the blocks before this one
+            va = _mm_add_epi32(va, _mm_sad_epu8(x, zero));
+            vb = _mm_add_epi32(vb, _mm_madd_epi16(_mm_maddubs_epi16(x, weights), ones));
+        }
+        b += 16U * ((uint32_t)blocks * a + gps_log_hsum_epi32(vprefix)) + gps_log_hsum_epi32(vb);
+        a += gps_log_hsum_epi32(va);
+        p += blocks * 16;
+        n -= blocks * 16;
+    }
+#endif
+    while (n >= 8) {
+        uint32_t x0 = p[0], x1 = p[1], x2 = p[2], x3 = p[3];
+        uint32_t x4 = p[4], x5 = p[5], x6 = p[6], x7 = p[7];
+        b += 8U * (a + x0) + 7U * x1 + 6U * x2 + 5U * x3 + 4U * x4 + 3U * x5 + 2U * x6 + x7;
+        a += x0 + x1 + x2 + x3 + x4 + x5 + x6 + x7;
+        p += 8;
+        n -= 8;
+    }
+    while (n--) {
+        a += *p++;
+        b += a;
+    }
+    s->a = a;
+    s->b = b;
+}
+
+/** @brief GPY Fletcher16 and UBX checksum over n bytes, a in the low and b in the high byte */
+static inline uint16_t gps_log_fletcher16(const uint8_t *p, size_t n) {
+    gps_log_fletcher_t s = {0, 0};
+    gps_log_fletcher_update(&s, p, n);
+    return (uint16_t)(((s.b & 0xFF) << 8) | (s.a & 0xFF));
+}
+
+/** @brief OAO checksum: the mode bytes and everything after the checksum at [2], [3] */
+static inline uint16_t gps_log_oao_sum(const uint8_t *frame, size_t len) {
+    gps_log_fletcher_t s = {0, 0};
+    gps_log_fletcher_update(&s, frame, 2);
+    gps_log_fletcher_update(&s, frame + 4, len - 4);
+    return (uint16_t)(((s.b & 0xFF) << 8) | (s.a & 0xFF));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
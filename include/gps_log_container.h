@@ -0,0 +1,55 @@
+#ifndef C2E8A1F4_6B3D_4E57_9A0C_5D1F7B2E4A93
+#define C2E8A1F4_6B3D_4E57_9A0C_5D1F7B2E4A93
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/// GPS log container (.glc): all enabled streams (ubx, sbp, gpx, gpy, oao, txt)
+/// interleaved as tagged chunks in one file, see scripts/gps_log_split.py.
+///
+/// file   = header, chunk, chunk, ...
+/// chunk  = chunk header + len bytes of one stream, in stream order per stream
+/// All values little endian.
+/// With CONFIG_GPS_LOG_CHUNKED the per-format files are framed in the same
+/// chunks, without the file header; scripts/gps_log_recover.py unwraps both.
+
+#define GLC_MAGIC            "GPSLOGC1"
+#define GLC_VERSION          1
+#define GLC_CHUNK_MAGIC      0x4347  // "GC"
+#define GLC_MAX_STREAMS      8
+
+#define GLC_CHUNK_FLAG_FIRST 0x01    // First chunk of the stream in this file (carries its header)
+
+struct GLC_Stream {
+    uint8_t id;          // Stream id used in the chunk headers
+    char    ext[3];      // File extension of the stream, e.g. "ubx", not terminated
+} __attribute__((__packed__));
+
+struct GLC_Header {      // length = 64 bytes
+    char     magic[8];           // GLC_MAGIC
+    uint16_t version;            // GLC_VERSION
+    uint16_t header_size;        // sizeof(struct GLC_Header)
+    uint16_t chunk_header_size;  // sizeof(struct GLC_Chunk_Header)
+    uint8_t  stream_count;       // Valid entries in streams[]
+    uint8_t  reserved;
+    struct GLC_Stream streams[GLC_MAX_STREAMS];
+    uint8_t  pad[16];
+} __attribute__((__packed__));
+
+struct GLC_Chunk_Header { // length = 16 bytes
+    uint16_t magic;      // GLC_CHUNK_MAGIC
+    uint8_t  stream;     // GLC_Stream.id
+    uint8_t  flags;      // GLC_CHUNK_FLAG_*
+    uint32_t seq;        // Chunk sequence number within the stream
+    uint32_t len;        // Payload bytes following the header
+    uint32_t crc;        // CRC32 (zlib) of the payload, 0 from older firmware
+} __attribute__((__packed__));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* C2E8A1F4_6B3D_4E57_9A0C_5D1F7B2E4A93 */
@@ -0,0 +1,143 @@
+#ifndef GPS_LOG_ENCODE_H
+#define GPS_LOG_ENCODE_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gpy.h"
+#include "oao.h"
+#include "sbp.h"
+
+/// Frame encoders of the SBP, GPY, OAO and GPX logs over one decoded epoch.
+///
+/// No context and no globals: a stream keeps its state in its encoder struct
+/// and output goes to a caller buffer. The device log_* functions encode into
+/// their write ring slots from the UBX message (log_ubx_epoch), the host
+/// transcoder scripts/gps_log_transcode.c into files from decoded logs.
+
+typedef struct gps_log_epoch_s {
+    int64_t  utc_ms;         // ms since 1970, 0 without a valid time
+    uint16_t year;           // UTC, normalized with millis
+    uint8_t  month, day, hour, minute, second;
+    uint16_t millis;         // 0..999
+    int32_t  lat, lon;       // 1e-7 deg
+    int32_t  hmsl;           // mm
+    int32_t  gspeed;         // mm/s
+    int32_t  vel_d;          // mm/s, down
+    int32_t  heading;        // 1e-5 deg
+    uint32_t sacc;           // mm/s
+    uint32_t hacc, vacc;     // mm
+    uint32_t heading_acc;    // 1e-5 deg
+    uint16_t hdop;           // 0.01
+    uint8_t  num_sv;
+    uint8_t  fix_type;
+} gps_log_epoch_t;
+
+// ============================================================================
+// SBP
+// ============================================================================
+
+void gps_log_enc_sbp(struct SBP_frame *frame, const gps_log_epoch_t *epoch);
+
+// ============================================================================
+// GPY
+// ============================================================================
+
+#define GPY_BLOCK_PAYLOAD_MAX 480  // blocks stay within one write ring slot
+#define GPY_BLOCK_MAX (sizeof(struct GPY_Block_Header) + GPY_BLOCK_PAYLOAD_MAX + 2)
+
+typedef struct gps_log_gpy_enc_s {
+    struct GPY_Frame ref;    // v1: last full frame, the delta reference
+    bool started;            // v1: a full frame was written
+    uint8_t block_frames;    // v2: frames per block
+    uint8_t frames;          // v2: frames in the open block
+    uint16_t len;            // v2: frame bytes in buf after the block header
+    int64_t time, dtime;     // v2: previous value and step of the predicted fields
+    int64_t lat, dlat;
+    int64_t lon, dlon;
+    int32_t speed, speed_error, cog;
+    uint16_t hdop;
+    uint8_t sat, fix;
+    uint8_t buf[GPY_BLOCK_MAX];
+} gps_log_gpy_enc_t;
+
+/** @brief Reset for a new file, the next frame is a full (v1) or key (v2) frame */
+void gps_log_gpy_enc_init(gps_log_gpy_enc_t *enc, uint8_t block_frames);
+
+/**
+ * @brief Encode a v1 frame into out (sizeof(struct GPY_Frame) bytes)
+ * @return frame length, 36 for a full and 20 for a compressed frame
+ */
+size_t gps_log_enc_gpy(gps_log_gpy_enc_t *enc, const gps_log_epoch_t *epoch, bool full, uint8_t *out);
+
+/** @brief v2: the open block has no room for another frame */
+bool gps_log_gpy_block_full(const gps_log_gpy_enc_t *enc);
+
+/** @brief v2: add a frame to the open block, flush first when gps_log_gpy_block_full() */
+void gps_log_enc_gpy_v2(gps_log_gpy_enc_t *enc, const gps_log_epoch_t *epoch);
+
+/**
+ * @brief v2: close the open block
+ * @return block length at *block, 0 when no frame is pending
+ */
+size_t gps_log_gpy_block_flush(gps_log_gpy_enc_t *enc, const uint8_t **block);
+
+// ============================================================================
+// OAO
+// ============================================================================
+
+#define OAO_MODE_HEADER         0x0AD0
+#define OAO_MODE_GNSS_ALIGNED   0x0AD4
+#define OAO_MODE_GNSS_UNALIGNED 0x0AD5
+#define OAO_GNSS_FRAME_LENGTH   52
+#define OAO_HEADER_LENGTH       512
+
+/// Session values of the OAO header, over all frames of a file
+typedef struct gps_log_oao_enc_s {
+    uint32_t frames;
+    uint64_t start_date, end_date; // ms
+    int32_t start_latitude, start_longitude, start_altitude;
+    int32_t end_latitude, end_longitude, end_altitude;
+    int32_t minimum_latitude, minimum_longitude, minimum_altitude;
+    int32_t maximum_latitude, maximum_longitude, maximum_altitude;
+    uint32_t minimum_speed, maximum_speed;
+    uint64_t above_12kn_mm;
+    uint64_t above_12kn_ms;
+    uint64_t elevation_gain;       // mm
+    int32_t elevation_ref;
+} gps_log_oao_enc_t;
+
+/** @brief Encode a GNSS frame (OAO_GNSS_FRAME_LENGTH bytes) and update the session */
+void gps_log_enc_oao(gps_log_oao_enc_t *enc, const gps_log_epoch_t *epoch, union OAO_Frame *frame);
+
+/**
+ * @brief Header with the session values and distance (m)
+ * Bests are left zero and the checksum open: fill them, then gps_log_oao_checksum().
+ */
+void gps_log_enc_oao_header(const gps_log_oao_enc_t *enc, uint32_t distance, union OAO_Header *header);
+
+void gps_log_oao_checksum(uint16_t length, uint8_t *buffer);
+
+// ============================================================================
+// GPX
+// ============================================================================
+
+// Worst case <trkpt> line with millisecond time and int32 extremes is 209B
+#define GPX_TRKPT_MAX_LEN 224
+
+/**
+ * @brief Format a <trkpt> line into out (GPX_TRKPT_MAX_LEN bytes), integer math only
+ * @return line length
+ */
+size_t gps_log_enc_gpx(char *out, const gps_log_epoch_t *epoch, bool millis);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -85,6 +85,27 @@ void log_err(const struct gps_context_s * context, const char *message);
 void open_files(struct gps_context_s * context);
 void close_files(struct gps_context_s *context);
 void flush_files(const struct gps_context_s *context);
+void gps_log_file_print_stats(uint32_t period_ms);
+
+/** @brief I/O counters of one log file since the files were opened */
+typedef struct gps_log_file_io_stats_s {
+    uint64_t bytes_in;          // Bytes committed by the format encoders
+    uint64_t bytes_out;         // Bytes written to the card
+    uint32_t writes;            // write() calls
+    uint32_t write_avg_us;
+    uint32_t write_max_us;
+    uint32_t timeout_flushes;   // Partial ring slots written by the flush timeout
+    uint32_t syncs;             // fsync() calls
+    uint32_t sync_avg_us;
+    uint32_t sync_max_us;
+    uint32_t stalls;            // write() calls over the stall threshold
+    uint32_t dropped;           // Frames dropped on a full ring
+} gps_log_file_io_stats_t;
+
+esp_err_t gps_log_file_get_io_stats(uint8_t file, gps_log_file_io_stats_t *stats);
+/** @brief Output rate of a per-epoch log format in Hz on the UTC second grid, 0 = every epoch */
+esp_err_t gps_log_file_set_rate(uint8_t file, uint8_t hz);
+uint8_t gps_log_file_get_rate(uint8_t file);
 void log_to_file(struct gps_context_s * context); 
 bool log_files_opened(struct gps_context_s * context);
 
@@ -93,7 +114,9 @@ bool log_files_opened(struct gps_context_s * context);
 // void log_config_delete(gps_log_file_config_t *log);
 
 void log_ubx(struct gps_context_s *context, struct ubx_msg_s *ubxMessage,
-             bool log_nav_dop);
+             bool log_nav_dop, bool log_nav_sat);
+struct gps_log_epoch_s;
+void log_ubx_epoch(const struct ubx_msg_s *ubxMessage, struct gps_log_epoch_s *epoch);
 // esp_err_t save_log_file_bits(struct gps_context_s *config, uint8_t *log_file_bits);
 
 #ifdef __cplusplus
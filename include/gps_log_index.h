@@ -0,0 +1,53 @@
+#ifndef GPS_LOG_INDEX_H
+#define GPS_LOG_INDEX_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/// Time index sidecar (.idx) of the UBX and GPY streams, see scripts/gps_log_index.py.
+///
+/// file  = header, entry, entry, ...
+/// Entries are in time order, one per indexed stream every interval_ms and at
+/// the first epoch of each run. offset is the byte offset of the epoch in the
+/// log file, in segment `segment` (0 the session file, n <name>_sNN.<ext>).
+/// GPY restarts with a full frame (v2: a new block) at each entry. Version 1
+/// files have 16 byte entries with stream offsets and no segment. All values
+/// little endian.
+
+#define GPS_IDX_MAGIC        0x58444947  // "GIDX"
+#define GPS_IDX_VERSION      2
+
+enum gps_idx_stream {
+    GPS_IDX_STREAM_UBX = 1,
+    GPS_IDX_STREAM_GPY = 2,
+};
+
+#define GPS_IDX_FLAG_TIME 0x01  // Periodic entry
+#define GPS_IDX_FLAG_RUN  0x02  // First epoch of run `run`
+
+struct GPS_Idx_Header {      // length = 16 bytes
+    uint32_t magic;          // GPS_IDX_MAGIC
+    uint16_t version;        // GPS_IDX_VERSION
+    uint16_t entry_size;     // sizeof(struct GPS_Idx_Entry)
+    uint32_t interval_ms;    // Periodic entry interval
+    uint32_t reserved;
+} __attribute__((__packed__));
+
+struct GPS_Idx_Entry {       // length = 24 bytes
+    int64_t  utc_ms;         // GNSS UTC of the epoch
+    uint64_t offset;         // File byte offset of the epoch in its segment
+    uint8_t  stream;         // enum gps_idx_stream
+    uint8_t  flags;          // GPS_IDX_FLAG_*
+    uint16_t run;            // Run number at the epoch
+    uint8_t  segment;        // Segment of the file (GPS_LOG_SEGMENT_ENABLED), 0 without
+    uint8_t  reserved[3];
+} __attribute__((__packed__));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
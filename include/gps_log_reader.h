@@ -0,0 +1,434 @@
+#ifndef GPS_LOG_READER_H
+#define GPS_LOG_READER_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "gps_log_checksum.h"
+#include "gpy.h"
+#include "oao.h"
+#include "sbp.h"
+
+/// Header only decoders for the files this component writes: UBX (NAV-PVT,
+/// NAV-SAT, NAV-DOP), GPY (v1 frames, v2 blocks), SBP and OAO.
+///
+/// Readers walk a buffer in place, normally a mapped file (gps_log_map()),
+/// and return pointers into it where the format allows. Frames are checked
+/// with their checksum (UBX Fletcher-8, GPY Fletcher16, OAO sum); after a bad
+/// one the reader moves on byte by byte to the next valid frame and counts the
+/// skipped bytes in `skipped`. SBP has no checksum, frames are taken as is.
+/// See scripts/gps_log_scan.c for use and throughput numbers.
+
+typedef struct gps_log_reader_s {
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+    size_t skipped;          // Bytes skipped while resynchronizing
+} gps_log_reader_t;
+
+static inline void gps_log_reader_init(gps_log_reader_t *r, const void *data, size_t size) {
+    r->data = (const uint8_t *)data;
+    r->size = size;
+    r->pos = 0;
+    r->skipped = 0;
+}
+
+// ============================================================================
+// CHECKSUMS
+// ============================================================================
+
+/** @brief UBX 8-bit Fletcher over class, id, length and payload */
+static inline bool gps_log_ubx_checksum_ok(const uint8_t *msg, size_t payload_len) {
+    uint16_t sum = gps_log_fletcher16(msg, payload_len + 4);
+    return msg[payload_len + 4] == (sum & 0xFF) && msg[payload_len + 5] == (sum >> 8);
+}
+
+/** @brief GPY Fletcher16 (sums modulo 256) over all bytes but the trailing two */
+static inline bool gps_log_gpy_checksum_ok(const uint8_t *frame, size_t len) {
+    uint16_t sum = gps_log_fletcher16(frame, len - 2);
+    return frame[len - 2] == (sum & 0xFF) && frame[len - 1] == (sum >> 8);
+}
+
+/** @brief OAO sum over the mode and the bytes after the checksum */
+static inline bool gps_log_oao_checksum_ok(const uint8_t *frame, size_t len) {
+    uint16_t sum = gps_log_oao_sum(frame, len);
+    return frame[2] == (sum & 0xFF) && frame[3] == (sum >> 8);
+}
+
+// ============================================================================
+// UBX
+// ============================================================================
+
+#define GPS_LOG_UBX_CLASS_NAV   0x01
+#define GPS_LOG_UBX_ID_NAV_PVT  0x07
+#define GPS_LOG_UBX_ID_NAV_DOP  0x04
+#define GPS_LOG_UBX_ID_NAV_SAT  0x35
+
+typedef struct {
+    uint8_t cls;
+    uint8_t id;
+    uint16_t len;
+    const uint8_t *payload;
+} gps_log_ubx_msg_t;
+
+/// NAV-PVT payload, 92 bytes
+typedef struct {
+    uint32_t iTOW;
+    uint16_t year;
+    uint8_t  month, day, hour, minute, second;
+    uint8_t  valid;
+    uint32_t tAcc;
+    int32_t  nano;
+    uint8_t  fixType, flags, flags2, numSV;
+    int32_t  lon, lat, height, hMSL;
+    uint32_t hAcc, vAcc;
+    int32_t  velN, velE, velD, gSpeed, headMot;
+    uint32_t sAcc, headAcc;
+    uint16_t pDOP;
+    uint8_t  flags3[6];
+    int32_t  headVeh;
+    int16_t  magDec;
+    uint16_t magAcc;
+} __attribute__((__packed__)) gps_log_ubx_nav_pvt_t;
+
+/// NAV-DOP payload, 18 bytes, DOPs in 0.01
+typedef struct {
+    uint32_t iTOW;
+    uint16_t gDOP, pDOP, tDOP, vDOP, hDOP, nDOP, eDOP;
+} __attribute__((__packed__)) gps_log_ubx_nav_dop_t;
+
+/// NAV-SAT payload: this header and numSvs gps_log_ubx_nav_sat_sv_t
+typedef struct {
+    uint32_t iTOW;
+    uint8_t  version;
+    uint8_t  numSvs;
+    uint8_t  reserved[2];
+} __attribute__((__packed__)) gps_log_ubx_nav_sat_t;
+
+typedef struct {
+    uint8_t  gnssId, svId, cno;
+    int8_t   elev;
+    int16_t  azim, prRes;
+    uint32_t flags;
+} __attribute__((__packed__)) gps_log_ubx_nav_sat_sv_t;
+
+/**
+ * @brief Next UBX message with a valid checksum
+ * @return false at the end of the data
+ */
+static inline bool gps_log_ubx_next(gps_log_reader_t *r, gps_log_ubx_msg_t *msg) {
+    while (r->pos + 8 <= r->size) {
+        const uint8_t *p = r->data + r->pos;
+        if (p[0] == 0xB5 && p[1] == 0x62) {
+            uint16_t len = (uint16_t)(p[4] | (p[5] << 8));
+            if (r->pos + 8 + len <= r->size && gps_log_ubx_checksum_ok(p + 2, len)) {
+                msg->cls = p[2];
+                msg->id = p[3];
+                msg->len = len;
+                msg->payload = p + 6;
+                r->pos += 8 + len;
+                return true;
+            }
+        }
+        // Resync: the next sync byte pair
+        const uint8_t *next = memchr(p + 1, 0xB5, r->size - r->pos - 1);
+        size_t skip = next ? (size_t)(next - p) : r->size - r->pos;
+        r->skipped += skip;
+        r->pos += skip;
+    }
+    r->skipped += r->size - r->pos;
+    r->pos = r->size;
+    return false;
+}
+
+// ============================================================================
+// GPY
+// ============================================================================
+
+#define GPS_LOG_GPY_HEADER_SIZE 72
+
+typedef struct {
+    int64_t  unix_time;      // ms
+    uint32_t speed;          // mm/s
+    uint32_t speed_error;
+    int32_t  latitude;
+    int32_t  longitude;
+    int32_t  cog;            // 1e-5 deg, v2 and compressed v1 frames carry 0.01 deg
+    uint16_t hdop;
+    uint8_t  sat;
+    uint8_t  fix;
+} gps_log_gpy_point_t;
+
+typedef struct {
+    gps_log_reader_t r;
+    bool v2;
+    bool have_ref;           // v1: a full frame was seen
+    struct GPY_Frame ref;    // v1: delta reference
+    // v2 block in progress
+    const uint8_t *block;
+    size_t block_len;
+    size_t block_pos;
+    uint8_t block_frames;
+    uint8_t block_done;
+    int64_t dtime, dlat, dlon;
+    gps_log_gpy_point_t last;
+} gps_log_gpy_reader_t;
+
+/**
+ * @brief Start reading a GPY file, the header tells v1 from v2
+ */
+static inline void gps_log_gpy_open(gps_log_gpy_reader_t *g, const void *data, size_t size) {
+    memset(g, 0, sizeof(*g));
+    gps_log_reader_init(&g->r, data, size);
+    const uint8_t *p = (const uint8_t *)data;
+    if (size >= GPS_LOG_GPY_HEADER_SIZE && p[0] == 0xF0) {
+        g->v2 = (p[1] & GPY_HEADER_FLAG_V2) != 0;
+        g->r.pos = GPS_LOG_GPY_HEADER_SIZE;
+    }
+}
+
+static inline bool gps_log_varint(const uint8_t *p, size_t len, size_t *pos, uint64_t *v) {
+    uint64_t value = 0;
+    for (unsigned shift = 0; *pos < len && shift < 64; shift += 7) {
+        uint8_t b = p[(*pos)++];
+        value |= (uint64_t)(b & 0x7F) << shift;
+        if (b < 0x80) {
+            *v = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline bool gps_log_svarint(const uint8_t *p, size_t len, size_t *pos, int64_t *v) {
+    uint64_t u;
+    if (!gps_log_varint(p, len, pos, &u))
+        return false;
+    *v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+    return true;
+}
+
+static inline bool gps_log_gpy_v2_frame(gps_log_gpy_reader_t *g, gps_log_gpy_point_t *pt) {
+    const uint8_t *p = g->block;
+    size_t len = g->block_len, *pos = &g->block_pos;
+    gps_log_gpy_point_t *f = &g->last;
+    uint64_t u;
+    int64_t v, r;
+    if (*pos >= len)
+        return false;
+    uint8_t mask = p[(*pos)++];
+    if (g->block_done == 0) {
+        if (!gps_log_svarint(p, len, pos, &f->unix_time)) return false;
+        if (!gps_log_varint(p, len, pos, &u)) return false;
+        f->speed = (uint32_t)u;
+        if (!gps_log_varint(p, len, pos, &u)) return false;
+        f->speed_error = (uint32_t)u;
+        if (!gps_log_svarint(p, len, pos, &v)) return false;
+        f->latitude = (int32_t)v;
+        if (!gps_log_svarint(p, len, pos, &v)) return false;
+        f->longitude = (int32_t)v;
+        if (!gps_log_svarint(p, len, pos, &v)) return false;
+        f->cog = (int32_t)v;
+        g->dtime = g->dlat = g->dlon = 0;
+    } else {
+        if (!gps_log_svarint(p, len, pos, &r)) return false;
+        v = f->unix_time + g->dtime + r;
+        g->dtime = v - f->unix_time;
+        f->unix_time = v;
+        if (!gps_log_svarint(p, len, pos, &r)) return false;
+        f->speed = (uint32_t)((int64_t)f->speed + r);
+        if (!gps_log_svarint(p, len, pos, &r)) return false;
+        f->speed_error = (uint32_t)((int64_t)f->speed_error + r);
+        if (!gps_log_svarint(p, len, pos, &r)) return false;
+        v = f->latitude + g->dlat + r;
+        g->dlat = v - f->latitude;
+        f->latitude = (int32_t)v;
+        if (!gps_log_svarint(p, len, pos, &r)) return false;
+        v = f->longitude + g->dlon + r;
+        g->dlon = v - f->longitude;
+        f->longitude = (int32_t)v;
+        if (!gps_log_svarint(p, len, pos, &r)) return false;
+        f->cog += (int32_t)r;
+    }
+    if ((mask & GPY_MASK_HDOP) && gps_log_varint(p, len, pos, &u)) f->hdop = (uint16_t)u;
+    if ((mask & GPY_MASK_SAT) && gps_log_varint(p, len, pos, &u)) f->sat = (uint8_t)u;
+    if ((mask & GPY_MASK_FIX) && gps_log_varint(p, len, pos, &u)) f->fix = (uint8_t)u;
+    *pt = *f;
+    pt->cog = f->cog * 1000;
+    g->block_done++;
+    return true;
+}
+
+/**
+ * @brief Next GPY point, v1 frames or v2 blocks
+ * @return false at the end of the data
+ */
+static inline bool gps_log_gpy_next(gps_log_gpy_reader_t *g, gps_log_gpy_point_t *pt) {
+    gps_log_reader_t *r = &g->r;
+    if (g->v2 && g->block_done < g->block_frames) {
+        if (gps_log_gpy_v2_frame(g, pt))
+            return true;
+        g->block_frames = 0;  // malformed block, checksum collision
+    }
+    while (r->pos < r->size) {
+        const uint8_t *p = r->data + r->pos;
+        size_t left = r->size - r->pos;
+        if (g->v2) {
+            const struct GPY_Block_Header *h = (const struct GPY_Block_Header *)p;
+            size_t n = sizeof(*h) + 2;
+            if (left >= n && h->Type_identifier == GPY_BLOCK_ID && left >= n + h->Length
+                && gps_log_gpy_checksum_ok(p, n + h->Length)) {
+                g->block = p + sizeof(*h);
+                g->block_len = h->Length;
+                g->block_pos = 0;
+                g->block_frames = h->Frames;
+                g->block_done = 0;
+                r->pos += n + h->Length;
+                if (g->block_frames && gps_log_gpy_v2_frame(g, pt))
+                    return true;
+                continue;
+            }
+        } else if (p[0] == 0xE0 && left >= sizeof(struct GPY_Frame)
+                   && gps_log_gpy_checksum_ok(p, sizeof(struct GPY_Frame))) {
+            memcpy(&g->ref, p, sizeof(g->ref));
+            g->have_ref = true;
+            r->pos += sizeof(struct GPY_Frame);
+            pt->unix_time = g->ref.Unix_time;
+            pt->speed = g->ref.Speed;
+            pt->speed_error = g->ref.Speed_error;
+            pt->latitude = g->ref.Latitude;
+            pt->longitude = g->ref.Longitude;
+            pt->cog = g->ref.COG;
+            pt->hdop = g->ref.HDOP;
+            pt->sat = g->ref.Sat;
+            pt->fix = g->ref.fix;
+            return true;
+        } else if (p[0] == 0xD0 && left >= sizeof(struct GPY_Frame_compressed)
+                   && gps_log_gpy_checksum_ok(p, sizeof(struct GPY_Frame_compressed))) {
+            const struct GPY_Frame_compressed *c = (const struct GPY_Frame_compressed *)p;
+            r->pos += sizeof(*c);
+            if (!g->have_ref)
+                continue;  // deltas without their full frame
+            pt->unix_time = g->ref.Unix_time + c->delta_time;
+            pt->speed = g->ref.Speed + c->delta_Speed;
+            pt->speed_error = g->ref.Speed_error + c->delta_Speed_error;
+            pt->latitude = g->ref.Latitude + c->delta_Latitude;
+            pt->longitude = g->ref.Longitude + c->delta_Longitude;
+            pt->cog = (g->ref.COG / 1000 + c->delta_COG) * 1000;
+            pt->hdop = c->HDOP;
+            pt->sat = c->Sat;
+            pt->fix = c->fix;
+            return true;
+        }
+        r->pos++;
+        r->skipped++;
+    }
+    return false;
+}
+
+// ============================================================================
+// SBP
+// ============================================================================
+
+/** @brief Start reading an SBP file behind its 64 byte header */
+static inline void gps_log_sbp_open(gps_log_reader_t *r, const void *data, size_t size) {
+    gps_log_reader_init(r, data, size);
+    r->pos = size >= sizeof(struct SBP_Header) ? sizeof(struct SBP_Header) : size;
+}
+
+/** @brief Next 32 byte SBP frame in place, NULL at the end */
+static inline const struct SBP_frame *gps_log_sbp_next(gps_log_reader_t *r) {
+    if (r->pos + sizeof(struct SBP_frame) > r->size) {
+        r->pos = r->size;
+        return NULL;
+    }
+    const struct SBP_frame *f = (const struct SBP_frame *)(r->data + r->pos);
+    r->pos += sizeof(struct SBP_frame);
+    return f;
+}
+
+// ============================================================================
+// OAO
+// ============================================================================
+
+/** @brief Length of an OAO frame by its mode, 0 if unknown */
+static inline size_t gps_log_oao_length(uint16_t mode) {
+    switch (mode) {
+        case 0x0AD0: return sizeof(union OAO_Header);
+        case 0x0AD1: return 12;
+        case 0x0AD2:
+        case 0x0AD3: return 34;
+        case 0x0AD4:
+        case 0x0AD5: return 52;
+        case 0x0AD6: return 32;
+        default: return 0;
+    }
+}
+
+/**
+ * @brief Next valid OAO frame in place, the session header included (mode 0x0AD0)
+ * @return NULL at the end of the data
+ */
+static inline const union OAO_Frame *gps_log_oao_next(gps_log_reader_t *r) {
+    while (r->pos + 4 <= r->size) {
+        const uint8_t *p = r->data + r->pos;
+        size_t len = gps_log_oao_length((uint16_t)(p[0] | (p[1] << 8)));
+        if (len && r->pos + len <= r->size && gps_log_oao_checksum_ok(p, len)) {
+            r->pos += len;
+            return (const union OAO_Frame *)p;
+        }
+        r->pos++;
+        r->skipped++;
+    }
+    r->skipped += r->size - r->pos;
+    r->pos = r->size;
+    return NULL;
+}
+
+// ============================================================================
+// FILE MAPPING (host)
+// ============================================================================
+
+#if !defined(ESP_PLATFORM)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Map a log file read only
+ * @return data, NULL on error or for an empty file
+ */
+static inline const uint8_t *gps_log_map(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        *size = (size_t)st.st_size;
+    }
+    close(fd);
+    if (data == MAP_FAILED)
+        return NULL;
+    madvise(data, *size, MADV_SEQUENTIAL);
+    return (const uint8_t *)data;
+}
+
+static inline void gps_log_unmap(const uint8_t *data, size_t size) {
+    munmap((void *)data, size);
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
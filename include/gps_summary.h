@@ -0,0 +1,103 @@
+#ifndef GPS_SUMMARY_H
+#define GPS_SUMMARY_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/// Binary session summary (.sum), see scripts/gps_summary.py.
+///
+/// file   = file header, record, record, ...
+/// record = record header + len bytes payload + crc32 (zlib) of header and payload
+/// Speeds are mm/s as used by the speed metrics, the reader converts to the
+/// unit in GPS_Sum_Session. All values little endian.
+///
+/// Journal mode (CONFIG_GPS_LOG_SUMMARY_JOURNAL): the file is opened with the
+/// session and every change of a metric's best runs appends a new
+/// GPS_SUM_REC_METRIC record, a later record replaces an earlier one of the
+/// same kind and index. Close appends the final session record and the seal.
+/// A journal found unsealed at the next start is cut after its last valid
+/// record and sealed with GPS_SUM_FLAG_RECOVERED.
+
+#define GPS_SUM_MAGIC        0x4D555347  // "GSUM"
+#define GPS_SUM_VERSION      1
+#define GPS_SUM_RUNS         10          // NUM_OF_SPD_ARRAY_SIZE, best run last
+
+enum gps_sum_record_type {
+    GPS_SUM_REC_SESSION = 1,  // struct GPS_Sum_Session
+    GPS_SUM_REC_METRIC  = 2,  // struct GPS_Sum_Metric
+    GPS_SUM_REC_SEAL    = 3,  // struct GPS_Sum_Seal, summary complete
+};
+
+enum gps_sum_metric_kind {
+    GPS_SUM_KIND_TIME = 1,    // Speed over time_window seconds
+    GPS_SUM_KIND_DIST = 2,    // Speed over distance_window meters
+    GPS_SUM_KIND_ALFA = 3,    // Alfa over distance_window meters
+    GPS_SUM_KIND_MAX  = 4,    // Max speed, runs[0] only
+};
+
+struct GPS_Sum_File_Header { // length = 8 bytes
+    uint32_t magic;          // GPS_SUM_MAGIC
+    uint16_t version;        // GPS_SUM_VERSION
+    uint16_t header_size;    // sizeof(struct GPS_Sum_File_Header)
+} __attribute__((__packed__));
+
+#define GPS_SUM_FLAG_RECOVERED 0x01  // Seal written by recovery, the session ended without close
+
+struct GPS_Sum_Record {      // length = 4 bytes
+    uint8_t  type;           // enum gps_sum_record_type
+    uint8_t  flags;          // GPS_SUM_FLAG_*
+    uint16_t len;            // Payload bytes, followed by the crc32
+} __attribute__((__packed__));
+
+struct GPS_Sum_Session {     // length = 88 bytes
+    uint8_t  mac[6];
+    uint8_t  speed_unit;     // g_rtc_config.gps.speed_unit
+    int8_t   timezone;       // h
+    uint8_t  sample_rate;    // Hz
+    uint8_t  nav_mode;       // ubx dynamic model setting
+    uint8_t  gnss;           // monGNSS enabled set
+    uint8_t  log_sat_details;
+    uint32_t first_fix_ms;
+    uint32_t total_time_ms;
+    uint32_t total_distance_mm;
+    uint8_t  ubx_id[6];
+    uint8_t  ubx_hw_type;
+    uint8_t  reserved;
+    char     sw_version[16];
+    char     ubx_sw_version[30];
+    char     ubx_hw_version[10];
+} __attribute__((__packed__));
+
+struct GPS_Sum_Run {         // length = 24 bytes
+    uint8_t  hour;
+    uint8_t  minute;
+    uint8_t  second;
+    uint8_t  reserved;
+    float    avg_speed;      // mm/s
+    uint16_t nr;             // Run number
+    uint16_t reserved2;
+    uint8_t  data[12];       // gps_run_t.data: dist/alfa {message_nr, dist, nr_samples/real_distance},
+                             // time {Mean_cno u16, Max_cno, Min_cno, Mean_numSat}
+} __attribute__((__packed__));
+
+struct GPS_Sum_Metric {      // length = 244 bytes
+    uint8_t  kind;           // enum gps_sum_metric_kind
+    uint8_t  index;          // Speed metric number
+    uint16_t window;         // s or m
+    struct GPS_Sum_Run runs[GPS_SUM_RUNS];
+} __attribute__((__packed__));
+
+struct GPS_Sum_Seal {        // length = 8 bytes
+    uint16_t records;        // Records before the seal
+    uint16_t reserved;
+    uint32_t total_time_ms;
+} __attribute__((__packed__));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
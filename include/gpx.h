@@ -27,7 +27,7 @@ SOFTWARE.
 //Doppler speed is not part of the gpx 1.1 frame, speed is then calculated as distance/time !!!
 //gpx 1.0 is used here ! 
 //https://logiqx.github.io/gps-wizard/gpx/
-//Always 1Hz points
+//1Hz points by default, CONFIG_GPS_LOG_GPX_RATE_HZ or gps_log_file_set_rate() sets N Hz or full rate with millisecond times
 
 #ifdef __cplusplus
 extern "C" {
@@ -35,7 +35,8 @@ extern "C" {
 
 struct gps_context_s;
 void log_header_GPX(struct gps_context_s *context);
-void log_GPX(struct gps_context_s *context);
+struct gps_log_epoch_s;
+void log_GPX(struct gps_context_s *context, const struct gps_log_epoch_s *epoch);
 void log_footer_GPX(struct gps_context_s *context);
 
 #ifdef __cplusplus
@@ -75,6 +75,30 @@ struct GPY_Frame_compressed {
 	uint16_t  Checksum;
   } __attribute__((__packed__)); //total = 20 bytes
 
+/*
+ * GPY v2 (CONFIG_GPS_LOG_GPY_V2), marked by GPY_HEADER_FLAG_V2 in the header Flags.
+ * After the header the file is a sequence of blocks, each decodes on its own:
+ * block   = GPY_Block_Header, Length bytes of frames, Fletcher16 of header and frames
+ * frame 0 = mask, Unix_time, Speed, Speed_error, Latitude, Longitude, COG, HDOP, Sat, fix
+ * frame n = mask, time, Speed, Speed_error, Latitude, Longitude, COG residuals [, HDOP] [, Sat] [, fix]
+ * All values are varints, signed ones zigzag coded. Time, Latitude and Longitude residuals are
+ * against a linear prediction from the two previous frames, the others against the previous
+ * frame. COG is heading / 1000 (0.01 deg) as in the compressed v1 frame. The mask tells which of
+ * HDOP, Sat and fix follow in frame n, see scripts/gpy_decode.py.
+ */
+#define GPY_HEADER_FLAG_V2 0x01
+#define GPY_BLOCK_ID       0xC0
+#define GPY_MASK_HDOP      0x01
+#define GPY_MASK_SAT       0x02
+#define GPY_MASK_FIX       0x04
+#define GPY_FRAME_V2_MAX   72  // mask + 6 x 10 byte + 3 x 3 byte varints, rounded up
+
+struct GPY_Block_Header {
+    uint8_t   Type_identifier;	//Frame identifier for a v2 block = 0xC0
+    uint8_t   Frames;   //frames in the block
+    uint16_t  Length;   //frame bytes following the header
+} __attribute__((__packed__)); //total = 4 bytes
+
 //Functions definitions 
 /*
  * https://en.wikipedia.org/wiki/Fletcher%27s_checksum
@@ -89,7 +113,9 @@ time_t tmConvert_t(int YYYY, byte MM, byte DD, byte hh, byte mm, byte ss);
 */
 struct gps_context_s;
 void log_header_GPY(const struct gps_context_s *context);
-void log_GPY(struct gps_context_s *context);
+struct gps_log_epoch_s;
+void log_GPY(struct gps_context_s *context, const struct gps_log_epoch_s *epoch);
+void log_footer_GPY(struct gps_context_s *context);
 
 #ifdef __cplusplus
 }
@@ -3,6 +3,7 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
+#include <stdbool.h>
 #include <stdint.h>
 
 struct gps_context_s;
@@ -141,8 +142,16 @@ union __attribute__((__packed__)) OAO_Header {
 
 };
 
+/// The writer reserves the header at open and fills it at close (log_close_OAO):
+/// dates in UTC ms, speeds and best_t values in mm/s, best_t times in UTC seconds,
+/// altitudes and elevation_gain in mm, distance and above_12kn in m. gybe_min
+/// and signature are left zero. With segments every segment gets the results
+/// of the session up to its end (log_segment_header_OAO).
 void log_header_OAO(struct gps_context_s *context);
-void log_OAO(struct gps_context_s *context);
+bool log_segment_header_OAO(const struct gps_context_s *context, union OAO_Header *header);
+void log_close_OAO(struct gps_context_s *context);
+struct gps_log_epoch_s;
+void log_OAO(struct gps_context_s *context, const struct gps_log_epoch_s *epoch);
 
 #ifdef __cplusplus
 }
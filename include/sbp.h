@@ -40,7 +40,8 @@ struct SBP_frame{//length = 32 bytes
 }__attribute__((__packed__));
 
 void log_header_SBP(struct gps_context_s * context);
-void log_SBP(struct gps_context_s * context);
+struct gps_log_epoch_s;
+void log_SBP(struct gps_context_s * context, const struct gps_log_epoch_s *epoch);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,57 @@
+#ifndef UBZ_H
+#define UBZ_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Compressed UBX stream (.ubz), see scripts/ubz_decompress.py.
+///
+/// file  = block, block, ... (one block per async writer slot)
+/// block = block header + data_len bytes, decodable on its own
+///
+/// Data: LZ4 style sequences, token (literal length << 4 | match length - 4),
+/// 255 continued length bytes for a nibble of 15, literals, 16 bit LE offset,
+/// the last sequence of a block has literals only. With UBZ_FLAG_PVT_DELTA the
+/// decoded bytes still carry the NAV-PVT prefilter: in every B5 62 01 07 5C 00
+/// message that follows another one in the block, each 32 bit payload word is
+/// stored as difference (UBZ_PVT_SUB_WORDS) or XOR to the previous payload.
+/// All values little endian.
+
+#define UBZ_MAGIC            0x5A55  // "UZ"
+#define UBZ_FLAG_LZ          0x01    // Data is LZ coded, else stored
+#define UBZ_FLAG_PVT_DELTA   0x02    // NAV-PVT prefilter applied
+
+#define UBZ_PVT_MSG_LEN      100     // Sync, class, id, length, 92 byte payload, checksum
+#define UBZ_PVT_PAYLOAD_LEN  92
+// Payload words coded as difference (iTOW, tAcc, nano, lon .. headAcc, headVeh), the others XOR
+#define UBZ_PVT_SUB_WORDS    0x0027FFD9u
+
+#define UBZ_HASH_BITS        11      // Match finder table: 2^11 x 16 bit = 4KB
+#define UBZ_BOUND(n)         ((n) + (n) / 255 + 16)
+
+struct UBZ_Block_Header { // length = 8 bytes
+    uint16_t magic;      // UBZ_MAGIC
+    uint8_t  flags;      // UBZ_FLAG_*
+    uint8_t  reserved;
+    uint16_t raw_len;    // Decoded block length
+    uint16_t data_len;   // Bytes following the header
+} __attribute__((__packed__));
+
+/**
+ * @brief Encode one block of raw UBX bytes
+ * Applies the NAV-PVT prefilter to src in place. Falls back to a stored
+ * block when the LZ data would not be smaller.
+ * @param dst room for sizeof(struct UBZ_Block_Header) + UBZ_BOUND(len) bytes
+ * @return bytes written to dst
+ */
+size_t ubz_encode_block(uint8_t *src, size_t len, uint8_t *dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -10,6 +10,7 @@
 #include <esp_mac.h>
 
 #include "gpy.h"
+#include "gps_log_encode.h"
 #include "strbf.h"
 #include "ubx.h"
 #include "gps_log_file.h"
@@ -36,46 +37,34 @@ struct GPY_Header gpy_header = {
     .firmwareVersion = "",
     .Checksum = 0};
 
-struct GPY_Frame gpy_frame = {
-    .Type_identifier = 0xE0,  // Frame identifier for full frame = 0xE0
-    .Flags = 0x0,
-    .HDOP = 0,         // HDOP
-    .Unix_time = 0,    // ms
-    .Speed = 0,        // mm/s
-    .Speed_error = 0,  // sAccCourse_Over_Ground,
-    .Latitude = 0,
-    .Longitude = 0,
-    .COG = 0,  // Course over ground
-    .Sat = 0,  // number of sats
-    .fix = 0,
-    .Checksum = 0};
+#ifndef CONFIG_GPS_LOG_GPY_V2_BLOCK_FRAMES
+#define CONFIG_GPS_LOG_GPY_V2_BLOCK_FRAMES 20
+#endif
+
+static gps_log_gpy_enc_t gpy_enc;
 
-struct GPY_Frame_compressed gpy_frame_compressed = {
-    .Type_identifier = 0xD0,  // Frame identifier for compressed frame = 0xD0
-    .Flags = 0x0,
-    .HDOP = 0x0,               // HDOP
-    .delta_time = 0x0,         // ms
-    .delta_Speed = 0x0,        // mm/
-    .delta_Speed_error = 0x0,  // sAccCourse_Over_Ground,
-    .delta_Latitude = 0x0,
-    .delta_Longitude = 0x0,
-    .delta_COG = 0x0,  // delta (course / 1000) !
-    .Sat = 0x0,        // number of sats
-    .fix = 0x0,
-    .Checksum = 0x0};
-
-uint16_t Fletcher16(uint8_t *data, int count) {
-    uint16_t sum1 = 0;
-    uint16_t sum2 = 0;
-    /* Sum all the bytes, but not the last 2 */
-    for (int i = 0; i < (count - 2); ++i) {
-        sum1 = (sum1 + data[i]) & 0xFF;  // divide by 256 in stead of 255 !!
-        sum2 = (sum2 + sum1) & 0xFF;
+#if defined(CONFIG_GPS_LOG_GPY_V2)
+static void gpy_block_flush(void) {
+    const uint8_t *block;
+    size_t len = gps_log_gpy_block_flush(&gpy_enc, &block);
+    if (len) {
+        WRITEGPY(block, len);
     }
-    data[count - 2] = sum1;
-    data[count - 1] = sum2;
-    return (sum2 << 8) | sum1;
 }
+#endif
+
+/**
+ * @brief Write the pending v2 block, at close, before a segment switch and an index entry
+ */
+void log_footer_GPY(struct gps_context_s *context) {
+    (void)context;
+#if defined(CONFIG_GPS_LOG_GPY_V2)
+    if (NOGPY)
+        return;
+    gpy_block_flush();
+#endif
+}
+
 // https://community.particle.io/t/make-epoch-timestamp-maketime-solved/10013
 /*
 time_t tmConvert_t(int YYYY, byte MM, byte DD, byte hh, byte mm, byte ss)
@@ -123,77 +112,37 @@ void log_header_GPY(const struct gps_context_s *context) {
         strbf_inits(&sb, gpy_header.serialNumber, sizeof(gpy_header.serialNumber));
         strbf_puts(&sb, "000000000000");
     }
+#if defined(CONFIG_GPS_LOG_GPY_V2)
+    gpy_header.Flags = GPY_HEADER_FLAG_V2;
+#endif
+    gps_log_gpy_enc_init(&gpy_enc, CONFIG_GPS_LOG_GPY_V2_BLOCK_FRAMES);  // every file starts with a full frame
     Fletcher16((uint8_t *)&gpy_header, 72);
     WRITEGPY(&gpy_header, 72 * sizeof(uint8_t));
 }
 
-void log_GPY(struct gps_context_s *context) {
+void log_GPY(struct gps_context_s *context, const gps_log_epoch_t *epoch) {
     if(NOGPY)
         return;
-    const ubx_msg_t * ubxMessage = &context->ubx_device->ubx_msg;
-    int64_t utc_ms = (int64_t)c_utc_ms_from_date_time(
-        ubxMessage->navPvt.year, ubxMessage->navPvt.month,
-        ubxMessage->navPvt.day, ubxMessage->navPvt.hour,
-        ubxMessage->navPvt.minute, ubxMessage->navPvt.second,
-        c_nano_to_millis_round(ubxMessage->navPvt.nano), NULL);
-
-    // calcultation of delta values
-    int delta_time = utc_ms - gpy_frame.Unix_time;                 // ms
-    int delta_Speed = ubxMessage->navPvt.gSpeed - gpy_frame.Speed;  // mm/
-    int delta_Speed_error = ubxMessage->navPvt.sAcc - gpy_frame.Speed_error;  // sAccCourse_Over_Ground;
-    int delta_Latitude = ubxMessage->navPvt.lat - gpy_frame.Latitude;
-    int delta_Longitude = ubxMessage->navPvt.lon - gpy_frame.Longitude;
-    int delta_COG = ubxMessage->navPvt.heading / 1000 - gpy_frame.COG / 1000;  // delta (course / 1000) !
-#define SIGNED_INT 30000  // if delta is more, a full frame is written
-    int full_frame = 0;
-    static int first_frame = 0;
-    if ((delta_time > SIGNED_INT) | (delta_time < -SIGNED_INT))
-        full_frame = 1;
-    if ((delta_Speed > SIGNED_INT) | (delta_Speed < -SIGNED_INT))
-        full_frame = 1;
-    if ((delta_Speed_error > SIGNED_INT) | (delta_Speed_error < -SIGNED_INT))
-        full_frame = 1;
-    if ((delta_Latitude > SIGNED_INT) | (delta_Latitude < -SIGNED_INT))
-        full_frame = 1;
-    if ((delta_Longitude > SIGNED_INT) | (delta_Longitude < -SIGNED_INT))
-        full_frame = 1;
-    if ((delta_COG > SIGNED_INT) | (delta_COG < -SIGNED_INT))
-        full_frame = 1;
-    if (first_frame == 0)
-        full_frame = 1;  // first frame is always a full frame
-    if (context->next_gpy_full_frame) {
-        full_frame = 1;
+#if defined(CONFIG_GPS_LOG_GPY_V2)
+    if (context->next_gpy_full_frame || gps_log_gpy_block_full(&gpy_enc)) {
+        gpy_block_flush();  // if a navPvt frame is lost, start a new block with a key frame
         context->next_gpy_full_frame = 0;
-    }  // if a navPvt frame is lost, next frame = full frame !!!
-    if (full_frame == 1) {
-        gpy_frame.HDOP = ubxMessage->navDOP.hDOP;  // ubxMessage->navPvt.pDOP;
-        gpy_frame.Unix_time = utc_ms;
-        gpy_frame.Speed = ubxMessage->navPvt.gSpeed;
-        gpy_frame.Speed_error = ubxMessage->navPvt.sAcc;
-        gpy_frame.Latitude = ubxMessage->navPvt.lat;
-        gpy_frame.Longitude = ubxMessage->navPvt.lon;
-        gpy_frame.COG = ubxMessage->navPvt.heading;
-        gpy_frame.Sat = ubxMessage->navPvt.numSV;
-        gpy_frame.fix = ubxMessage->navPvt.fixType;
-        Fletcher16((uint8_t *)&gpy_frame, 36);
-        WRITEGPY(&gpy_frame, 36 * sizeof(uint8_t));
-        first_frame = 1;
-        // Serial.println(" full ");
-    } else {
-        gpy_frame_compressed.HDOP =
-            ubxMessage->navDOP.hDOP;                    // ubxMessage->navPvt.pDOP
-        gpy_frame_compressed.delta_time = delta_time;  // ms
-        gpy_frame_compressed.delta_Speed = delta_Speed;  // mm/
-        gpy_frame_compressed.delta_Speed_error =
-            delta_Speed_error;  // sAccCourse_Over_Ground;
-        gpy_frame_compressed.delta_Latitude = delta_Latitude;
-        gpy_frame_compressed.delta_Longitude = delta_Longitude;
-        gpy_frame_compressed.delta_COG = delta_COG;  // delta (course / 1000) !
-        gpy_frame_compressed.Sat = ubxMessage->navPvt.numSV;  // number of sats
-        gpy_frame_compressed.fix = ubxMessage->navPvt.fixType;
-        Fletcher16((uint8_t *)&gpy_frame_compressed, 20);
-        WRITEGPY(&gpy_frame_compressed, 20 * sizeof(uint8_t));
     }
+    gps_log_enc_gpy_v2(&gpy_enc, epoch);
+#else
+    // Encode in place into the write ring slot, room for the larger full frame
+    uint8_t *slot = log_reserve(context, sd_log_gpy, sizeof(struct GPY_Frame));
+    if (!slot)
+        return;
+    // if a navPvt frame is lost, next frame = full frame !!!
+    bool full = context->next_gpy_full_frame;
+#if defined(GPS_LOG_HAS_CHUNKS)
+    full = full || log_chunk_start(sd_log_gpy);  // every chunk decodes on its own
+#endif
+    size_t len = gps_log_enc_gpy(&gpy_enc, epoch, full, slot);
+    context->next_gpy_full_frame = 0;
+    log_commit(context, sd_log_gpy, len);
+#endif
 }
 
 #endif
\ No newline at end of file
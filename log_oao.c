@@ -1,82 +1,144 @@
 #include "log_private.h"
 #if (defined(CONFIG_UBLOX_ENABLED) && defined(CONFIG_GPS_LOG_ENABLED) && defined(GPS_LOG_HAS_OAO))
 
+#include <errno.h>
+#include <string.h>
+#include <sys/unistd.h>
+
 #include "oao.h"
+#include "gps_log_encode.h"
 #include "gps_log_file.h"
-#include "ubx_msg.h"
-#include "ubx.h"
+#include "gps_data.h"
+#include "vfs.h"
 
-enum {
-    OAO_MODE_GNSS_ALIGNED = 0x0AD4,
-    OAO_MODE_GNSS_UNALIGNED = 0x0AD5,
-    OAO_GNSS_FRAME_LENGTH = 52,
-};
+static const char *TAG = "oao";
 
-static void oao_finalize_checksum(uint16_t length, uint8_t *buffer);
-static uint64_t oao_utc_ms_from_nav_pvt(const nav_pvt_t *nav_pvt,
-                                        int32_t *normalized_millis);
+// Session values for the header, kept across segments until log_close_OAO()
+static gps_log_oao_enc_t oao_session;
+static bool oao_header;            // Header region reserved at the start of the current file
 
+/**
+ * @brief Reserve the 512B header at the start of the file, filled by log_close_OAO()
+ */
 void log_header_OAO(struct gps_context_s *context) {
+    if (NOOAO) {
+        return;
+    }
+#if defined(GPS_LOG_HAS_CHUNKS)
+    // Chunk framed: no fixed file offset to write the header to later
     (void)context;
+    oao_header = false;
+#else
+    // Appended to an earlier session's file: its header at offset 0 is not ours
+    // to fill, and a header mid-file would stop the readers
+    oao_header = false;
+    if (!log_at_file_start(sd_log_oao)) {
+        return;
+    }
+    union OAO_Header header;
+    memset(&header, 0, sizeof(header));
+    header.mode = OAO_MODE_HEADER;
+    gps_log_oao_checksum(OAO_HEADER_LENGTH, header.bytes);
+    oao_header = WRITEOAO(header.bytes, OAO_HEADER_LENGTH) == OAO_HEADER_LENGTH;
+#endif
 }
 
-void log_OAO(struct gps_context_s * context) {
-    if (NOOAO || !context || !context->ubx_device) {
+void log_OAO(struct gps_context_s * context, const gps_log_epoch_t *epoch) {
+    if (NOOAO || !context) {
         return;
     }
-
-    const ubx_msg_t *ubx_message = &context->ubx_device->ubx_msg;
-    const nav_pvt_t *nav_pvt = &ubx_message->navPvt;
-    union OAO_Frame frame = {0};
-    int32_t normalized_millis = 0;
-    uint64_t utc_gnss = oao_utc_ms_from_nav_pvt(nav_pvt, &normalized_millis);
-
-    frame.mode = (uint16_t)(utc_gnss && normalized_millis == 0
-                                ? OAO_MODE_GNSS_ALIGNED
-                                : OAO_MODE_GNSS_UNALIGNED);
-    frame.latitude = nav_pvt->lat;
-    frame.longitude = nav_pvt->lon;
-    frame.altitude = nav_pvt->hMSL;
-    frame.speed = (uint32_t)(nav_pvt->gSpeed < 0 ? -nav_pvt->gSpeed
-                                                 : nav_pvt->gSpeed);
-    frame.heading = (uint32_t)(nav_pvt->heading < 0 ? 0 : nav_pvt->heading);
-    frame.utc_gnss = utc_gnss;
-    frame.fix = nav_pvt->fixType;
-    frame.satellites = nav_pvt->numSV;
-    frame.accuracy_speed = nav_pvt->sAcc;
-    frame.accuracy_horizontal = nav_pvt->hAcc;
-    frame.accuracy_vertical = nav_pvt->vAcc;
-    frame.accuracy_heading = nav_pvt->headingAcc;
-    frame.accuracy_hDOP = ubx_message->navDOP.hDOP;
-
-    oao_finalize_checksum(OAO_GNSS_FRAME_LENGTH, frame.bytes_gnss);
-    WRITEOAO(frame.bytes_gnss, sizeof(frame.bytes_gnss));
-
+    // Encode in place into the write ring slot
+    union OAO_Frame *frame = log_reserve(context, sd_log_oao, OAO_GNSS_FRAME_LENGTH);
+    if (!frame) {
+        return;
+    }
+    gps_log_enc_oao(&oao_session, epoch, frame);
+    log_commit(context, sd_log_oao, OAO_GNSS_FRAME_LENGTH);
 }
 
-static void oao_finalize_checksum(uint16_t length, uint8_t *buffer) {
-    uint8_t checksum_a = 0;
-    uint8_t checksum_b = 0;
-
-    for (uint16_t i = 0; i < 2; ++i) {
-        checksum_b += (checksum_a += buffer[i]);
+/**
+ * @brief Best five runs of a speed metric, run times are local, the header wants UTC seconds
+ */
+static void oao_bests(best_t *bests, const gps_run_t *runs) {
+    int64_t end_s = (int64_t)(oao_session.end_date / 1000U);
+    int64_t day_s = end_s - end_s % 86400 - (int64_t)g_rtc_config.gps.timezone * 3600;
+    for (uint8_t i = 0; i < 5; i++) {
+        const gps_run_t *run = &runs[9 - i];  // best run last
+        if (run->avg_speed <= 0) {
+            break;
+        }
+        int64_t t = day_s + run->time.hour * 3600 + run->time.minute * 60 + run->time.second;
+        if (t > end_s) {
+            t -= 86400;
+        } else if (t <= end_s - 86400) {
+            t += 86400;
+        }
+        bests[i].utc_seconds = (uint32_t)t;
+        bests[i].value = (uint32_t)run->avg_speed;  // mm/s
     }
+}
 
-    for (uint16_t i = 4; i < length; ++i) {
-        checksum_b += (checksum_a += buffer[i]);
+static void oao_fill_header(const struct gps_context_s *context, union OAO_Header *header) {
+    gps_log_enc_oao_header(&oao_session, (uint32_t)(context->Ublox.total_distance / 1000.0f), header);  // m
+    for (uint16_t i = 0; i < context->num_speed_metrics; i++) {
+        const gps_speed_metrics_desc_t *desc = &context->speed_metrics[i];
+        if (desc->type == GPS_SPEED_TYPE_TIME) {
+            const gps_speed_by_time_t *t = desc->handle.time;
+            if (t->time_window == 1)
+                oao_bests(header->bests_over_1s, t->speed.runs);
+            else if (t->time_window == 10)
+                oao_bests(header->bests_over_10s, t->speed.runs);
+            else if (t->time_window == 3600)
+                oao_bests(header->bests_over_1h, t->speed.runs);
+        } else if (desc->type & (GPS_SPEED_TYPE_DIST | GPS_SPEED_TYPE_ALFA)) {
+            const gps_speed_by_dist_t *d = desc->handle.dist;
+            if (d->distance_window == 500)
+                oao_bests(header->bests_over_500m, d->speed.runs);
+            else if (d->distance_window == 1000)
+                oao_bests(header->bests_over_1000m, d->speed.runs);
+            else if (d->distance_window == 1852)
+                oao_bests(header->bests_over_1852m, d->speed.runs);
+        }
     }
+    gps_log_oao_checksum(OAO_HEADER_LENGTH, header->bytes);
+}
 
-    buffer[2] = checksum_a;
-    buffer[3] = checksum_b;
+/**
+ * @brief Header of the segment ending now, the session results so far
+ * The writer fills it in when it switches to the next segment.
+ * @return false if the segment has no reserved header or no frames
+ */
+bool log_segment_header_OAO(const struct gps_context_s *context, union OAO_Header *header) {
+    if (!context || !oao_header || !oao_session.frames) {
+        return false;
+    }
+    oao_fill_header(context, header);
+    return true;
 }
 
-static uint64_t oao_utc_ms_from_nav_pvt(const nav_pvt_t *nav_pvt,
-                                        int32_t *normalized_millis) {
-    return c_utc_ms_from_date_time(nav_pvt->year, nav_pvt->month, nav_pvt->day,
-                                   nav_pvt->hour, nav_pvt->minute,
-                                   nav_pvt->second,
-                                   c_nano_to_millis_round(nav_pvt->nano),
-                                   normalized_millis);
+/**
+ * @brief Fill the reserved header with the session results, after the file is closed
+ * One positional write at offset 0, readers get the results without scanning the frames.
+ */
+void log_close_OAO(struct gps_context_s *context) {
+    if (!context || !context->log_config) {
+        return;
+    }
+    if (oao_header && oao_session.frames) {
+        gps_log_file_config_t *config = context->log_config;
+        union OAO_Header header;
+        oao_fill_header(context, &header);
+        int fd = s_open(config->filenames[sd_log_oao], config->base_path, "r+");
+        if (fd < 0 || pwrite(fd, header.bytes, OAO_HEADER_LENGTH, 0) != OAO_HEADER_LENGTH) {
+            ELOG(TAG, "Session header not written (%s) %s", strerror(errno), config->filenames[sd_log_oao]);
+        }
+        if (fd >= 0) {
+            fsync(fd);
+            close(fd);
+        }
+    }
+    memset(&oao_session, 0, sizeof(oao_session));
+    oao_header = false;
 }
 
 #endif
\ No newline at end of file
@@ -16,6 +16,14 @@ extern "C" {
 struct gps_context_s;
 
 size_t log_write(const struct gps_context_s * context, uint8_t file, const void * msg, size_t len);
+typedef struct {
+    const void *data;
+    size_t len;
+} log_part_t;
+size_t log_write_parts(const struct gps_context_s * context, uint8_t file, const log_part_t *parts, size_t count);
+void *log_reserve(const struct gps_context_s * context, uint8_t file, size_t len);
+void log_commit(const struct gps_context_s * context, uint8_t file, size_t len);
+bool log_at_file_start(uint8_t file);
 int log_close(const struct gps_context_s * context, uint8_t file);
 int log_fsync(const struct gps_context_s * context, uint8_t file);
 void printFile(const char *filename);
@@ -61,16 +69,20 @@ inline int log_get_fd(const struct gps_context_s * context, uint8_t file) {
 #define ALFA_DISTANCE_MAX 501.0f
 #define ALPHA_BUFFER_SIZE(sample_rate, speed) (uint32_t)(sample_rate * (ALFA_DISTANCE_MAX / speed) + 1.5f)
 #define ALFA_THRESHOLDS_MS {2.2f, 2.8f, 3.3f, 4.2f, 5.0f, 5.6f} // m/s for 8,10,12,15,18,20 km/h
-#define ALFA_THRESHOLD_IDX_TABLE {0,0,0,0,0,0,1,1,1,1,1,2,2,2,2,2,2} // index for speed thresholds for alfa logging based on the configured rate (1-20Hz)
+#define ALFA_THRESHOLD_RATE_LIMITS {5, 10, 16, 20, 30} // highest rate (Hz) per threshold, faster rates use the last threshold
 extern const float speed_thresholds_for_alfa[];
-/// known rates are 1, 2, 5, 10, 16 and 20Hz but we want to support any rate between 1 and 20, 
-/// so we use a lookup table for the thresholds for alfa logging based on the configured rate
-extern const uint8_t speed_threshold_index[17];
+/// known rates are 1, 2, 5, 10, 16, 20, 25 and 50Hz but we want to support any rate between 1 and 50,
+/// so the rate limits table selects the threshold for alfa logging based on the configured rate
+extern const uint8_t speed_threshold_rate_limits[5];
 inline float spd_threshold_for_alfa(int rate) {
-    if (rate > 16) return speed_thresholds_for_alfa[3];
-    if (rate < 0) return speed_thresholds_for_alfa[0];
-    return speed_thresholds_for_alfa[speed_threshold_index[rate]];
+    uint8_t i = 0;
+    while (i < 5 && rate > speed_threshold_rate_limits[i]) i++;
+    return speed_thresholds_for_alfa[i];
 }
+/// the ground speed buffer has to hold the longest distance window at this average speed (m/s),
+/// 5128 samples at 20Hz cover 1852m at 7.2m/s = 26km/h
+#define GPS_SPEED_BUFFER_MIN_SPEED 7.2f
+#define GPS_SPEED_BUFFER_SIZE(sample_rate, distance) (uint32_t)(sample_rate * ((distance) / GPS_SPEED_BUFFER_MIN_SPEED) + 1.5f)
 #define MIN_numSV_FIRST_FIX 5      // before start logging, changed from 4 to 5 7.1/2023
 #define MAX_Sacc_FIRST_FIX 2       // before start logging
 #define MIN_numSV_GPS_SPEED_OK  4  // minimum number of satellites for calculating speed, otherwise
@@ -88,7 +100,11 @@ inline float spd_threshold_for_alfa(int rate) {
 #define TIME_DELAY_NEW_RUN 10U       // uint time_delay_new_run
 
 typedef struct gps_p_context_s {
+#if defined(CONFIG_GPS_LOG_STATIC_G_BUFFER)
     int32_t buf_gspeed[BUFFER_SIZE];   // speed buffer counted by gps rate
+#else
+    int32_t *buf_gspeed;               // speed buffer counted by gps rate
+#endif
     uint16_t buf_gspeed_size; // size of the speed buffer counted by gps rate
 #if defined(CONFIG_GPS_LOG_STATIC_S_BUFFER)
     int16_t buf_sec_speed[BUFFER_SEC_SIZE]; // speed buffer counted by sec
@@ -125,9 +141,14 @@ typedef struct gps_p_context_s {
     uint32_t standstill_start_millis;
     SemaphoreHandle_t xMutex;
     uint32_t count_nav_pvt;
+    volatile uint8_t resize_rate; // Output rate to resize the rate counted buffers to, 0 = none
 } gps_p_context_t;
 
+#if defined(CONFIG_GPS_LOG_STATIC_G_BUFFER)
 #define AA .buf_gspeed = {0}, .buf_gspeed_size = BUFFER_SIZE
+#else
+#define AA .buf_gspeed = NULL, .buf_gspeed_size = 0
+#endif
 
 #if defined(CONFIG_GPS_LOG_STATIC_A_BUFFER)
 #define AI .alfa_buf = {0}, .alfa_buf_size = BUFFER_ALFA
@@ -162,7 +183,8 @@ typedef struct gps_p_context_s {
     .alfa_p2 = {0,0}, \
     .standstill_start_millis = 0, \
     .xMutex = NULL, \
-    .count_nav_pvt = 0 \
+    .count_nav_pvt = 0, \
+    .resize_rate = 0 \
 }
 
 extern gps_p_context_t log_p_lctx;
@@ -209,6 +231,11 @@ void gps_free_alfa_buf(void);
 void gps_check_sec_buf(size_t new_size);
 void gps_free_sec_buf(void);
 #endif
+#if !defined(CONFIG_GPS_LOG_STATIC_G_BUFFER)
+void gps_check_gspeed_buf(size_t new_size);
+void gps_free_gspeed_buf(void);
+#endif
+size_t gps_speed_buffer_required(uint8_t sample_rate);
 
 void refresh_gps_speeds_by_distance(void);
 struct gps_speed_by_dist_s *init_gps_speed_by_distance(struct gps_speed_by_dist_s *me, uint16_t);
@@ -222,6 +249,32 @@ float update_speed_by_time(struct gps_speed_by_time_s*);
 
 void gps_speed_metrics_update(void);
 void gps_speed_metrics_save_session(void);
+#if defined(CONFIG_GPS_LOG_SUMMARY_BINARY)
+void log_session_SUM(struct gps_context_s *context);
+#endif
+#if defined(CONFIG_GPS_LOG_SUMMARY_JOURNAL)
+void log_journal_open_SUM(struct gps_context_s *context);
+void log_journal_SUM(struct gps_context_s *context);
+#endif
+
+// Side files appended by the async writer, next to the log files
+#if defined(CONFIG_GPS_LOG_SUMMARY_JOURNAL) || defined(CONFIG_GPS_LOG_INDEX)
+#define GPS_LOG_HAS_SIDE 1
+enum log_side_channel {
+    LOG_SIDE_JOURNAL,  // .sum summary journal
+    LOG_SIDE_INDEX,    // .idx time index
+    LOG_SIDE_END
+};
+void log_side_attach(uint8_t side, int fd, bool sync);
+bool log_side_append(uint8_t side, const void *data, size_t len);
+int log_side_detach(uint8_t side);
+#endif
+
+// Framed writes: every ring slot goes out as one CRC checked chunk (include/gps_log_container.h)
+#if defined(CONFIG_GPS_LOG_CONTAINER) || defined(CONFIG_GPS_LOG_CHUNKED)
+#define GPS_LOG_HAS_CHUNKS 1
+bool log_chunk_start(uint8_t file);
+#endif
 
 void init_gps_context_fields(struct gps_context_s * ctx);
 void deinit_gps_context_fields(struct gps_context_s *ctx);
@@ -8,7 +8,7 @@
 #include <sys/unistd.h>
 
 #include "sbp.h"
-#include "ubx_msg.h"
+#include "gps_log_encode.h"
 #include "gps_log_file.h"
 #include "gps_data.h"
 #include "strbf.h"
@@ -30,21 +30,6 @@ struct SBP_Header sbp_header = {
     .Start = 0xfd,
     .Identity = ""};
 
-struct SBP_frame sbp_frame = {
-    .HDOP = 0,                 /* HDOP [0..51] with resolution 0.2 */
-    .SVIDCnt = 0,              /* Number of SVs in solution [0 to 12] */
-    .UtcSec = 0,               /* UTC Second [0 to 59] in seconds with resolution 0.001 */
-    .date_time_UTC_packed = 0, /* refer to protocol doc*/
-    .SVIDList = 0,             /* SVs in solution:  Bit 0=1: SV1, Bit 1=1: SV2, ... , Bit 31=1: SV32 */
-    .Lat = 0,                  /* Latitude [-90 to 90] in degrees with resolution 0.0000001 */
-    .Lon = 0,                  /* Longitude [-180 to 180] in degrees with resolution 0.0000001 */
-    .AltCM = 0,                /* Altitude from Mean Sea Level in centi meters */
-    .Sog = 0,                  /* Speed Over Ground in m/sec with resolution 0.01 */
-    .Cog = 0,                  /* Course Over Ground [0 to 360] in degrees with resolution 0.01 */
-    .ClmbRte = 0,              /* Climb rate in m/sec with resolution 0.01 */
-    .sdop = 0,                 /* GT31 */
-    .vsdop = 0};
-
 void log_header_SBP(struct gps_context_s * context) {
     const char *firmware_version = "unknown";
     uint8_t log_rate = 0;
@@ -56,6 +41,10 @@ void log_header_SBP(struct gps_context_s * context) {
         firmware_version = context->SW_version;
     }
     log_rate = ubx_get_effective_output_rate();
+    uint8_t stream_rate = gps_log_file_get_rate(sd_log_sbp);
+    if (stream_rate && stream_rate < log_rate) {
+        log_rate = stream_rate;  // decimated stream
+    }
 
     memset(sbp_header.Identity, 0, sizeof(sbp_header.Identity));
     strbf_inits(&sb, sbp_header.Identity, sizeof(sbp_header.Identity));
@@ -83,46 +72,15 @@ void log_header_SBP(struct gps_context_s * context) {
     // fprintf(file, (const uint8_t *)&sbp_header,64);
 }
 
-void log_SBP(struct gps_context_s * context) {
+void log_SBP(struct gps_context_s * context, const gps_log_epoch_t *epoch) {
     if (NOSBP)
         return;
-    const struct ubx_msg_s *ubxMessage = &context->ubx_device->ubx_msg;
-    uint32_t year = ubxMessage->navPvt.year;
-    uint8_t month = ubxMessage->navPvt.month;
-    uint8_t day = ubxMessage->navPvt.day;
-    uint8_t hour = ubxMessage->navPvt.hour;
-    uint8_t minute = ubxMessage->navPvt.minute;
-    uint8_t second = ubxMessage->navPvt.second;
-    int32_t utc_ms = c_nano_to_millis_round(ubxMessage->navPvt.nano);
-    uint32_t numSV = 0xFFFFFFFF;
-    uint32_t HDOP = (ubxMessage->navDOP.hDOP + 1) / 20;  // from 0.01 resolution to 0.2 ,reformat pDOP to HDOP 8-bit !!
-    if (HDOP > 255)
-        HDOP = 255;                               // has to fit in 8 bit
-    uint32_t sdop = ubxMessage->navPvt.sAcc / 10;  // was sAcc
-    if (sdop > 255)
-        sdop = 255;
-    uint32_t vsdop = ubxMessage->navPvt.vAcc / 10;  // was headingAcc ???
-    if (vsdop > 255)
-        vsdop = 255;
-    c_normalize_utc_fields(&year, &month, &day, &hour, &minute, &second,
-                           &utc_ms, 1000U);
-    sbp_frame.UtcSec = (uint16_t)((second * 1000U) + (uint32_t)utc_ms);
-    sbp_frame.date_time_UTC_packed = (((year - 2000) * 12 + month) << 22) +
-                                     (day << 17) + (hour << 12) +
-                                     (minute << 6) + second;
-    sbp_frame.Lat = ubxMessage->navPvt.lat;
-    sbp_frame.Lon = ubxMessage->navPvt.lon;
-    sbp_frame.AltCM = ubxMessage->navPvt.hMSL / 10;     // omrekenen naar cm/s
-    sbp_frame.Sog = ubxMessage->navPvt.gSpeed / 10;     // omrekenen naar cm/s
-    sbp_frame.Cog = ubxMessage->navPvt.heading / 1000;  // omrekenen naar 0.01 degrees
-    sbp_frame.SVIDCnt = ubxMessage->navPvt.numSV;
-    sbp_frame.SVIDList = numSV >> (32 - ubxMessage->navPvt.numSV);
-    sbp_frame.HDOP = HDOP;
-    sbp_frame.ClmbRte = -ubxMessage->navPvt.velD / 10;  // omrekenen naar cm/s
-    sbp_frame.sdop = sdop;
-    sbp_frame.vsdop = vsdop;
-    WRITESBP(&sbp_frame, 32 * sizeof(uint8_t));
-    // fprintf(file, (const uint8_t *)&sbp_frame,32);
+    // Encode in place into the write ring slot
+    struct SBP_frame *sbp_frame = log_reserve(context, sd_log_sbp, sizeof(struct SBP_frame));
+    if (!sbp_frame)
+        return;
+    gps_log_enc_sbp(sbp_frame, epoch);
+    log_commit(context, sd_log_sbp, sizeof(struct SBP_frame));
 }
 
 #endif
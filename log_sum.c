@@ -0,0 +1,506 @@
+#include "log_private.h"
+#if (defined(CONFIG_UBLOX_ENABLED) && defined(CONFIG_GPS_LOG_ENABLED) && defined(CONFIG_GPS_LOG_SUMMARY_BINARY))
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/unistd.h>
+
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+
+#include "gps_summary.h"
+#include "gps_log_file.h"
+#include "gps_data.h"
+#include "ubx.h"
+#include "vfs.h"
+
+static const char *TAG = "gps_sum";
+
+/**
+ * @brief Frame one record at buf
+ * @return bytes used
+ */
+static size_t sum_put_record_flags(uint8_t *buf, uint8_t type, uint8_t flags, const void *payload,
+                                   uint16_t len) {
+    struct GPS_Sum_Record *rec = (struct GPS_Sum_Record *)buf;
+    rec->type = type;
+    rec->flags = flags;
+    rec->len = len;
+    memcpy(buf + sizeof(*rec), payload, len);
+    uint32_t crc = esp_rom_crc32_le(0, buf, sizeof(*rec) + len);
+    memcpy(buf + sizeof(*rec) + len, &crc, sizeof(crc));
+    return sizeof(*rec) + len + sizeof(crc);
+}
+
+static inline size_t sum_put_record(uint8_t *buf, uint8_t type, const void *payload, uint16_t len) {
+    return sum_put_record_flags(buf, type, 0, payload, len);
+}
+
+static void sum_copy_str(char *dst, size_t size, const char *src) {
+    memset(dst, 0, size);
+    if (src) {
+        strncpy(dst, src, size);
+    }
+}
+
+static void sum_session(const gps_context_t *context, struct GPS_Sum_Session *s) {
+    const ubx_ctx_t *ubx = context->ubx_device;
+    const ubx_msg_t *ubxMessage = &ubx->ubx_msg;
+    memset(s, 0, sizeof(*s));
+    if (context->mac_address) {
+        memcpy(s->mac, context->mac_address, sizeof(s->mac));
+    }
+    s->speed_unit = g_rtc_config.gps.speed_unit;
+    s->timezone = (int8_t)g_rtc_config.gps.timezone;
+    s->sample_rate = ubx_get_effective_output_rate();
+    s->nav_mode = g_rtc_config.ubx.nav_mode;
+    s->gnss = ubxMessage->monGNSS.enabled_Gnss;
+    s->log_sat_details = g_rtc_config.ubx.log_sat_details;
+    s->first_fix_ms = context->first_fix;
+    s->total_time_ms = get_millis() - context->start_logging_millis;
+    s->total_distance_mm = (uint32_t)context->Ublox.total_distance;
+    s->ubx_id[0] = ubxMessage->ubxId.ubx_id_1;
+    s->ubx_id[1] = ubxMessage->ubxId.ubx_id_2;
+    s->ubx_id[2] = ubxMessage->ubxId.ubx_id_3;
+    s->ubx_id[3] = ubxMessage->ubxId.ubx_id_4;
+    s->ubx_id[4] = ubxMessage->ubxId.ubx_id_5;
+    if (ubx->hw_type > UBX_TYPE_M8)
+        s->ubx_id[5] = ubxMessage->ubxId.ubx_id_6;
+    s->ubx_hw_type = ubx->hw_type;
+    sum_copy_str(s->sw_version, sizeof(s->sw_version), context->SW_version);
+    sum_copy_str(s->ubx_sw_version, sizeof(s->ubx_sw_version), ubxMessage->mon_ver.swVersion);
+    sum_copy_str(s->ubx_hw_version, sizeof(s->ubx_hw_version), ubxMessage->mon_ver.hwVersion);
+}
+
+static void sum_run(struct GPS_Sum_Run *out, const gps_run_t *run) {
+    memset(out, 0, sizeof(*out));
+    out->hour = run->time.hour;
+    out->minute = run->time.minute;
+    out->second = run->time.second;
+    out->avg_speed = run->avg_speed;
+    out->nr = run->nr;
+    memcpy(out->data, &run->data, sizeof(out->data));
+}
+
+static void sum_metric(struct GPS_Sum_Metric *m, uint8_t kind, uint8_t index, uint16_t window,
+                       const gps_run_t *runs, uint8_t count) {
+    memset(m, 0, sizeof(*m));
+    m->kind = kind;
+    m->index = index;
+    m->window = window;
+    for (uint8_t i = 0; i < count && i < GPS_SUM_RUNS; i++) {
+        sum_run(&m->runs[i], &runs[i]);
+    }
+}
+
+/**
+ * @brief Runs of the k-th summary metric: max speed first, then the speed metrics
+ * in order, an alfa metric after its distance metric
+ * @return runs, NULL past the last metric
+ */
+static const gps_run_t *sum_metric_runs(const gps_context_t *context, uint16_t k, uint8_t *kind,
+                                        uint8_t *index, uint16_t *window) {
+    if (k == 0) {
+        *kind = GPS_SUM_KIND_MAX;
+        *index = 0;
+        *window = 0;
+        return &context->max_speed;
+    }
+    k--;
+    for (uint16_t i = 0; i < context->num_speed_metrics; i++) {
+        const gps_speed_metrics_desc_t *desc = &context->speed_metrics[i];
+        *index = i;
+        if (desc->type == GPS_SPEED_TYPE_TIME) {
+            if (k-- == 0) {
+                *kind = GPS_SUM_KIND_TIME;
+                *window = desc->handle.time->time_window;
+                return desc->handle.time->speed.runs;
+            }
+        } else if (desc->type & (GPS_SPEED_TYPE_DIST | GPS_SPEED_TYPE_ALFA)) {
+            const gps_speed_by_dist_t *d = desc->handle.dist;
+            if (k-- == 0) {
+                *kind = GPS_SUM_KIND_DIST;
+                *window = d->distance_window;
+                return d->speed.runs;
+            }
+            if ((desc->type & GPS_SPEED_TYPE_ALFA) && d->alfa && k-- == 0) {
+                *kind = GPS_SUM_KIND_ALFA;
+                *window = d->alfa->distance_window;
+                return d->alfa->speed.runs;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Fill the k-th summary metric
+ * @return false past the last metric
+ */
+static bool sum_metric_at(const gps_context_t *context, uint16_t k, struct GPS_Sum_Metric *m) {
+    uint8_t kind, index;
+    uint16_t window;
+    const gps_run_t *runs = sum_metric_runs(context, k, &kind, &index, &window);
+    if (!runs) {
+        return false;
+    }
+    sum_metric(m, kind, index, window, runs, kind == GPS_SUM_KIND_MAX ? 1 : GPS_SUM_RUNS);
+    return true;
+}
+
+static uint16_t sum_metric_count(const gps_context_t *context) {
+    uint16_t metrics = 1;  // max speed
+    for (uint16_t i = 0; i < context->num_speed_metrics; i++) {
+        metrics += (context->speed_metrics[i].type & GPS_SPEED_TYPE_ALFA) ? 2 : 1;
+    }
+    return metrics;
+}
+
+#define SUM_RECORD_SIZE(payload) (sizeof(struct GPS_Sum_Record) + sizeof(payload) + sizeof(uint32_t))
+
+#if defined(CONFIG_GPS_LOG_SUMMARY_JOURNAL)
+// ============================================================================
+// SUMMARY JOURNAL - the .sum file is written ahead: session record at open,
+// one metric record per change of its best runs, session and seal at close.
+// A marker names the open journal so the next start can seal it after a crash.
+// ============================================================================
+
+#define SUM_JOURNAL_MARKER "journal.cur"
+#define SUM_RECOVERY_MAX_SIZE (64 * 1024)
+
+static struct {
+    bool open;
+    uint16_t records;        // Records in the file
+    uint16_t metrics;
+    uint32_t *sig;           // Best runs signature per metric, as last journaled
+} sum_journal;
+
+/**
+ * @brief Cheap change signature of the best runs, number and speed of each
+ */
+static uint32_t sum_runs_sig(const gps_run_t *runs, uint8_t first, uint8_t end) {
+    uint32_t sig = 2166136261u;
+    for (uint8_t i = first; i < end; i++) {
+        uint32_t speed;
+        memcpy(&speed, &runs[i].avg_speed, sizeof(speed));
+        sig = (sig ^ speed ^ ((uint32_t)runs[i].nr << 16)) * 16777619u;
+    }
+    return sig;
+}
+
+static uint32_t sum_metric_sig(const gps_run_t *runs, uint8_t kind) {
+    // runs[0] of a speed metric is the run in progress, only the best five are results
+    return kind == GPS_SUM_KIND_MAX ? sum_runs_sig(runs, 0, 1) : sum_runs_sig(runs, 5, GPS_SUM_RUNS);
+}
+
+static void sum_marker_path(char *path, size_t size, const char *base_path) {
+    snprintf(path, size, "%s/%s", base_path, SUM_JOURNAL_MARKER);
+}
+
+/**
+ * @brief Seal a journal left open by a crash or power loss
+ * Cuts the file after its last valid record and appends a recovered seal.
+ */
+static void sum_journal_recover(const char *base_path) {
+    char marker[ESP_VFS_PATH_MAX + PATH_MAX_CHAR_SIZE + 2], path[ESP_VFS_PATH_MAX + PATH_MAX_CHAR_SIZE + 10];
+    char name[PATH_MAX_CHAR_SIZE + 8] = {0};
+    sum_marker_path(marker, sizeof(marker), base_path);
+    int fd = open(marker, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    ssize_t n = read(fd, name, sizeof(name) - 1);
+    close(fd);
+    if (n <= 0) {
+        unlink(marker);
+        return;
+    }
+    int64_t start_us = esp_timer_get_time();
+    snprintf(path, sizeof(path), "%s/%s", base_path, name);
+    fd = open(path, O_RDWR);
+    off_t size = fd < 0 ? -1 : lseek(fd, 0, SEEK_END);
+    uint8_t *buf = size > 0 && size <= SUM_RECOVERY_MAX_SIZE ? malloc(size) : NULL;
+    if (!buf || lseek(fd, 0, SEEK_SET) != 0 || read(fd, buf, size) != size) {
+        WLOG(TAG, "Journal %s not recovered", path);
+        goto done;
+    }
+
+    // Walk the records, the valid end is after the last one with a good crc
+    const struct GPS_Sum_File_Header *header = (const struct GPS_Sum_File_Header *)buf;
+    if (size < (off_t)sizeof(*header) || header->magic != GPS_SUM_MAGIC) {
+        WLOG(TAG, "Journal %s has no summary header", path);
+        goto done;
+    }
+    off_t end = header->header_size;
+    uint16_t records = 0;
+    uint8_t last = 0;
+    while (end + (off_t)sizeof(struct GPS_Sum_Record) <= size) {
+        const struct GPS_Sum_Record *rec = (const struct GPS_Sum_Record *)(buf + end);
+        off_t next = end + sizeof(*rec) + rec->len + sizeof(uint32_t);
+        uint32_t crc;
+        if (next > size) {
+            break;
+        }
+        memcpy(&crc, buf + next - sizeof(crc), sizeof(crc));
+        if (crc != esp_rom_crc32_le(0, buf + end, next - end - sizeof(crc))) {
+            break;
+        }
+        last = rec->type;
+        records++;
+        end = next;
+    }
+    if (last == GPS_SUM_REC_SEAL) {
+        goto done;  // Closed, only the marker was left behind
+    }
+    uint8_t seal_buf[SUM_RECORD_SIZE(struct GPS_Sum_Seal)];
+    struct GPS_Sum_Seal seal = {.records = records};
+    size_t len = sum_put_record_flags(seal_buf, GPS_SUM_REC_SEAL, GPS_SUM_FLAG_RECOVERED, &seal, sizeof(seal));
+    if (ftruncate(fd, end) != 0 || lseek(fd, end, SEEK_SET) != end
+        || write(fd, seal_buf, len) != (ssize_t)len) {
+        ELOG(TAG, "Journal %s recovery failed (%s)", path, strerror(errno));
+        goto done;
+    }
+    fsync(fd);
+    ILOG(TAG, "Journal %s recovered: %" PRIu16 " records, %ld bytes cut, %" PRId64 "ms", path, records,
+         (long)(size - end), (esp_timer_get_time() - start_us) / 1000);
+done:
+    free(buf);
+    if (fd >= 0) {
+        close(fd);
+    }
+    unlink(marker);
+}
+
+/**
+ * @brief Recover a previous journal, open this session's one and hand it to the writer
+ * Called by open_files() after the writer started.
+ */
+void log_journal_open_SUM(struct gps_context_s *context) {
+    if (!context || !context->log_config || !context->ubx_device) {
+        return;
+    }
+    gps_log_file_config_t *config = context->log_config;
+    sum_journal_recover(config->base_path);
+
+    free(sum_journal.sig);
+    sum_journal.metrics = sum_metric_count(context);
+    sum_journal.sig = calloc(sum_journal.metrics, sizeof(uint32_t));
+    if (!sum_journal.sig) {
+        ELOG(TAG, "No memory for the summary journal");
+        return;
+    }
+    // Metrics without runs match the empty signature, they are journaled at their first run
+    static const gps_run_t empty[GPS_SUM_RUNS];
+    for (uint16_t k = 0; k < sum_journal.metrics; k++) {
+        sum_journal.sig[k] = sum_metric_sig(empty, k == 0 ? GPS_SUM_KIND_MAX : 0);
+    }
+
+    char name[PATH_MAX_CHAR_SIZE + 8];
+    strcpy(name, config->filename_base);
+    strcat(name, ".sum");
+    int fd = s_open(name, config->base_path, "a");
+    if (fd < 0) {
+        ELOG(TAG, "Failed to open journal %s", name);
+        return;
+    }
+    uint8_t buf[sizeof(struct GPS_Sum_File_Header) + SUM_RECORD_SIZE(struct GPS_Sum_Session)];
+    size_t len = 0;
+    sum_journal.records = 0;
+    if (lseek(fd, 0, SEEK_END) == 0) {
+        struct GPS_Sum_File_Header *header = (struct GPS_Sum_File_Header *)buf;
+        header->magic = GPS_SUM_MAGIC;
+        header->version = GPS_SUM_VERSION;
+        header->header_size = sizeof(*header);
+        len = sizeof(*header);
+    }
+    struct GPS_Sum_Session session;
+    sum_session(context, &session);
+    len += sum_put_record(buf + len, GPS_SUM_REC_SESSION, &session, sizeof(session));
+    sum_journal.records++;
+    if (write(fd, buf, len) != (ssize_t)len) {
+        ELOG(TAG, "Journal %s write failed (%s)", name, strerror(errno));
+        close(fd);
+        return;
+    }
+    fsync(fd);
+
+    char marker[ESP_VFS_PATH_MAX + PATH_MAX_CHAR_SIZE + 2];
+    sum_marker_path(marker, sizeof(marker), config->base_path);
+    int mfd = open(marker, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (mfd < 0 || write(mfd, name, strlen(name)) != (ssize_t)strlen(name)) {
+        WLOG(TAG, "Journal marker not written, no recovery for %s", name);
+    }
+    if (mfd >= 0) {
+        fsync(mfd);
+        close(mfd);
+    }
+    log_side_attach(LOG_SIDE_JOURNAL, fd, true);
+    sum_journal.open = true;
+    ILOG(TAG, "Summary journal %s, %" PRIu16 " metrics", name, sum_journal.metrics);
+}
+
+/**
+ * @brief Frame the record of the k-th metric if its best runs changed since the last one
+ * @return bytes used, 0 if unchanged
+ */
+static size_t sum_journal_metric(const gps_context_t *context, uint16_t k, uint8_t *buf, uint32_t *sig) {
+    uint8_t kind, index;
+    uint16_t window;
+    const gps_run_t *runs = sum_metric_runs(context, k, &kind, &index, &window);
+    if (!runs) {
+        return 0;
+    }
+    *sig = sum_metric_sig(runs, kind);
+    if (*sig == sum_journal.sig[k]) {
+        return 0;
+    }
+    struct GPS_Sum_Metric m;
+    sum_metric(&m, kind, index, window, runs, kind == GPS_SUM_KIND_MAX ? 1 : GPS_SUM_RUNS);
+    return sum_put_record(buf, GPS_SUM_REC_METRIC, &m, sizeof(m));
+}
+
+/**
+ * @brief Journal the metrics whose best runs changed since their last record
+ * Called once per epoch, compares one signature per metric.
+ */
+void log_journal_SUM(struct gps_context_s *context) {
+    if (!sum_journal.open) {
+        return;
+    }
+    uint8_t buf[SUM_RECORD_SIZE(struct GPS_Sum_Metric)];
+    for (uint16_t k = 0; k < sum_journal.metrics; k++) {
+        uint32_t sig;
+        size_t len = sum_journal_metric(context, k, buf, &sig);
+        if (!len) {
+            continue;
+        }
+        if (!log_side_append(LOG_SIDE_JOURNAL, buf, len)) {
+            return;  // Queue full, the signature still differs next epoch
+        }
+        sum_journal.sig[k] = sig;
+        sum_journal.records++;
+    }
+}
+
+/**
+ * @brief Close path of the journal: changes not yet journaled, session record and seal in one write
+ */
+static void sum_journal_seal(gps_context_t *context) {
+    int64_t start_us = esp_timer_get_time();
+    sum_journal.open = false;
+    int fd = log_side_detach(LOG_SIDE_JOURNAL);
+    if (fd < 0) {
+        return;
+    }
+    size_t size = sum_journal.metrics * SUM_RECORD_SIZE(struct GPS_Sum_Metric)
+                + SUM_RECORD_SIZE(struct GPS_Sum_Session) + SUM_RECORD_SIZE(struct GPS_Sum_Seal);
+    uint8_t *buf = malloc(size);
+    if (!buf) {
+        ELOG(TAG, "No memory for the journal seal (%zuB), recovered at next start", size);
+        close(fd);
+        return;
+    }
+    size_t len = 0;
+    for (uint16_t k = 0; k < sum_journal.metrics; k++) {
+        uint32_t sig;
+        size_t n = sum_journal_metric(context, k, buf + len, &sig);
+        if (n) {
+            len += n;
+            sum_journal.records++;
+        }
+    }
+    struct GPS_Sum_Session session;
+    sum_session(context, &session);
+    len += sum_put_record(buf + len, GPS_SUM_REC_SESSION, &session, sizeof(session));
+    sum_journal.records++;
+    struct GPS_Sum_Seal seal = {.records = sum_journal.records, .total_time_ms = session.total_time_ms};
+    len += sum_put_record(buf + len, GPS_SUM_REC_SEAL, &seal, sizeof(seal));
+    bool sealed = write(fd, buf, len) == (ssize_t)len && fsync(fd) == 0;
+    close(fd);
+    free(buf);
+    if (!sealed) {
+        ELOG(TAG, "Journal seal failed (%s), recovered at next start", strerror(errno));
+    } else {
+        char marker[ESP_VFS_PATH_MAX + PATH_MAX_CHAR_SIZE + 2];
+        sum_marker_path(marker, sizeof(marker), context->log_config->base_path);
+        unlink(marker);
+        ILOG(TAG, "Summary journal sealed: %" PRIu16 " records, %zu bytes at close in %" PRId64 "ms",
+             seal.records, len, (esp_timer_get_time() - start_us) / 1000);
+    }
+    free(sum_journal.sig);
+    sum_journal.sig = NULL;
+}
+#endif
+
+/**
+ * @brief Write the session summary as one .sum file in a single write()
+ * Replaces the formatted TXT results at close, see scripts/gps_summary.py.
+ * With an open journal only the seal is left to write.
+ */
+void log_session_SUM(struct gps_context_s *context) {
+    if (!context || !context->log_config || !context->ubx_device) {
+        return;
+    }
+#if defined(CONFIG_GPS_LOG_SUMMARY_JOURNAL)
+    if (sum_journal.open) {
+        sum_journal_seal(context);
+        return;
+    }
+#endif
+    int64_t start_us = esp_timer_get_time();
+    gps_log_file_config_t *config = context->log_config;
+    uint16_t metrics = sum_metric_count(context);
+    size_t size = sizeof(struct GPS_Sum_File_Header) + SUM_RECORD_SIZE(struct GPS_Sum_Session)
+                + metrics * SUM_RECORD_SIZE(struct GPS_Sum_Metric) + SUM_RECORD_SIZE(struct GPS_Sum_Seal);
+    uint8_t *buf = malloc(size);
+    if (!buf) {
+        ELOG(TAG, "No memory for the session summary (%zuB)", size);
+        return;
+    }
+
+    struct GPS_Sum_File_Header *header = (struct GPS_Sum_File_Header *)buf;
+    header->magic = GPS_SUM_MAGIC;
+    header->version = GPS_SUM_VERSION;
+    header->header_size = sizeof(*header);
+    size_t len = sizeof(*header);
+    uint16_t records = 0;
+
+    struct GPS_Sum_Session session;
+    sum_session(context, &session);
+    len += sum_put_record(buf + len, GPS_SUM_REC_SESSION, &session, sizeof(session));
+    records++;
+
+    struct GPS_Sum_Metric m;
+    for (uint16_t k = 0; sum_metric_at(context, k, &m); k++) {
+        len += sum_put_record(buf + len, GPS_SUM_REC_METRIC, &m, sizeof(m));
+        records++;
+    }
+
+    struct GPS_Sum_Seal seal = {.records = records, .total_time_ms = session.total_time_ms};
+    len += sum_put_record(buf + len, GPS_SUM_REC_SEAL, &seal, sizeof(seal));
+
+    char name[PATH_MAX_CHAR_SIZE + 8];
+    strcpy(name, config->filename_base);
+    strcat(name, ".sum");
+    int fd = s_open(name, config->base_path, "a");
+    if (fd < 0) {
+        ELOG(TAG, "Failed to open %s", name);
+    } else {
+        // Appended to the summary of an earlier session: one file header only
+        size_t skip = lseek(fd, 0, SEEK_END) == 0 ? 0 : sizeof(*header);
+        len -= skip;
+        ssize_t written = write(fd, buf + skip, len);
+        if (written != (ssize_t)len) {
+            ELOG(TAG, "Summary write failed (%s), %zd of %zu bytes", strerror(errno), written, len);
+        }
+        close(fd);
+        ILOG(TAG, "Session summary %s: %" PRIu16 " records, %zu bytes in %" PRId64 "ms", name,
+             records, len, (esp_timer_get_time() - start_us) / 1000);
+    }
+    free(buf);
+}
+
+#endif
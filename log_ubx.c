@@ -1,26 +1,81 @@
 #include "log_private.h"
 #if (defined(CONFIG_UBLOX_ENABLED) && defined(CONFIG_GPS_LOG_ENABLED))
 
+#include <string.h>
+
 #include "gps_log_file.h"
+#include "gps_log_encode.h"
 #include "ubx.h"
 #include "gps_data.h"
 
-void log_ubx(gps_context_t *context, ubx_msg_t *ubxMessage, bool log_nav_dop) {
+// Sync bytes and a fixed size message in one ring reservation
+static void log_ubx_msg(gps_context_t *context, const void *msg, size_t len) {
+    uint8_t *slot = log_reserve(context, sd_log_ubx, len + 2);
+    if (!slot)
+        return;
+    slot[0] = 0xB5;
+    slot[1] = 0x62;
+    memcpy(slot + 2, msg, len);
+    log_commit(context, sd_log_ubx, len + 2);
+}
+
+/**
+ * @brief The epoch the frame encoders work on, UTC fields normalized to the rounded milliseconds
+ */
+void log_ubx_epoch(const ubx_msg_t *ubxMessage, gps_log_epoch_t *epoch) {
+    const struct nav_pvt_s *pvt = &ubxMessage->navPvt;
+    uint32_t year = pvt->year;
+    uint8_t month = pvt->month;
+    uint8_t day = pvt->day;
+    uint8_t hour = pvt->hour;
+    uint8_t minute = pvt->minute;
+    uint8_t second = pvt->second;
+    int32_t millis = c_nano_to_millis_round(pvt->nano);
+    epoch->utc_ms = (int64_t)c_utc_ms_from_date_time(year, month, day, hour, minute, second, millis, NULL);
+    c_normalize_utc_fields(&year, &month, &day, &hour, &minute, &second, &millis, 1000U);
+    epoch->year = (uint16_t)year;
+    epoch->month = month;
+    epoch->day = day;
+    epoch->hour = hour;
+    epoch->minute = minute;
+    epoch->second = second;
+    epoch->millis = (uint16_t)millis;
+    epoch->lat = pvt->lat;
+    epoch->lon = pvt->lon;
+    epoch->hmsl = pvt->hMSL;
+    epoch->gspeed = pvt->gSpeed;
+    epoch->vel_d = pvt->velD;
+    epoch->heading = pvt->heading;
+    epoch->sacc = pvt->sAcc;
+    epoch->hacc = pvt->hAcc;
+    epoch->vacc = pvt->vAcc;
+    epoch->heading_acc = pvt->headingAcc;
+    epoch->hdop = ubxMessage->navDOP.hDOP;
+    epoch->num_sv = pvt->numSV;
+    epoch->fix_type = pvt->fixType;
+}
+
+void log_ubx(gps_context_t *context, ubx_msg_t *ubxMessage, bool log_nav_dop, bool log_nav_sat) {
     const uint8_t i[2] = {0xB5, 0x62};
     // write nav_pvt
-    WRITEUBX(&(i[0]), 2);
-    WRITEUBX(&ubxMessage->navPvt, sizeof(ubxMessage->navPvt));
+    log_ubx_msg(context, &ubxMessage->navPvt, sizeof(ubxMessage->navPvt));
     // write nav_sat
-    if (ubxMessage->count_nav_sat != ubxMessage->count_nav_sat_prev) { // only add nav_sat msg to ubx file if new nav_sat message
+    bool new_nav_sat = ubxMessage->count_nav_sat != ubxMessage->count_nav_sat_prev;
+    if (new_nav_sat) { // only add nav_sat msg to ubx file if new nav_sat message, shed ones are skipped
         ubxMessage->count_nav_sat_prev = ubxMessage->count_nav_sat;
-        WRITEUBX(&(i[0]), 2);
-        WRITEUBX(&ubxMessage->nav_sat, (ubxMessage->nav_sat.len + 4)); // payload + 2 bit for header + 2 bit for size
-        WRITEUBX(&ubxMessage->nav_sat.chkA, 2); // checkA and checkB are 2 bytes
+    }
+    if (log_nav_sat && new_nav_sat) {
+        // Whole message or nothing, a ring without room drops it instead of writing half of it
+        const log_part_t parts[] = {
+            {i, 2},
+            {&ubxMessage->nav_sat, ubxMessage->nav_sat.len + 4}, // payload + 2 bit for header + 2 bit for size
+            {&ubxMessage->nav_sat.chkA, 2}, // checkA and checkB are 2 bytes
+        };
+        log_write_parts(context, sd_log_ubx, parts, sizeof(parts) / sizeof(parts[0]));
     }
     // write nav_dop
     if (log_nav_dop) {  // navDOP logging is controlled by the logging preference, not receiver message enablement
-        WRITEUBX(&(i[0]), 2);
-        WRITEUBX(&ubxMessage->navDOP, sizeof(ubxMessage->navDOP));
+        log_ubx_msg(context, &ubxMessage->navDOP, sizeof(ubxMessage->navDOP));
     }
 }
 
@@ -0,0 +1,121 @@
+#include "log_private.h"
+#if defined(CONFIG_GPS_LOG_UBZ)
+
+#include <string.h>
+
+#include "ubz.h"
+
+// Match finder state, positions + 1 within the current block (0 = empty)
+static uint16_t ubz_hash[1 << UBZ_HASH_BITS];
+
+static const uint8_t ubz_pvt_sync[6] = {0xB5, 0x62, 0x01, 0x07, UBZ_PVT_PAYLOAD_LEN, 0x00};
+
+static inline uint32_t ubz_read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t ubz_hash4(const uint8_t *p) {
+    return (ubz_read32(p) * 2654435761u) >> (32 - UBZ_HASH_BITS);
+}
+
+/**
+ * @brief NAV-PVT prefilter: code each payload against the previous one in the block
+ * Consecutive epochs differ in few low order bytes, which LZ then matches.
+ * @return true if at least one message was coded
+ */
+static bool ubz_pvt_filter(uint8_t *buf, size_t len) {
+    uint32_t prev[UBZ_PVT_PAYLOAD_LEN / 4];
+    bool have_prev = false, coded = false;
+    for (size_t p = 0; p + UBZ_PVT_MSG_LEN <= len;) {
+        if (memcmp(buf + p, ubz_pvt_sync, sizeof(ubz_pvt_sync))) {
+            p++;
+            continue;
+        }
+        uint8_t *payload = buf + p + sizeof(ubz_pvt_sync);
+        for (uint8_t w = 0; w < UBZ_PVT_PAYLOAD_LEN / 4; w++) {
+            uint32_t cur = ubz_read32(payload + w * 4);
+            if (have_prev) {
+                uint32_t coded_word = (UBZ_PVT_SUB_WORDS >> w) & 1 ? cur - prev[w] : cur ^ prev[w];
+                memcpy(payload + w * 4, &coded_word, sizeof(coded_word));
+            }
+            prev[w] = cur;
+        }
+        coded |= have_prev;
+        have_prev = true;
+        p += UBZ_PVT_MSG_LEN;
+    }
+    return coded;
+}
+
+static uint8_t *ubz_put_len(uint8_t *op, size_t n) {
+    for (; n >= 255; n -= 255)
+        *op++ = 255;
+    *op++ = (uint8_t)n;
+    return op;
+}
+
+/**
+ * @brief LZ code src into dst, dst has room for UBZ_BOUND(len)
+ * @return coded length
+ */
+static size_t ubz_lz_encode(const uint8_t *src, size_t len, uint8_t *dst) {
+    const uint8_t *anchor = src, *ip = src, *end = src + len;
+    uint8_t *op = dst;
+    memset(ubz_hash, 0, sizeof(ubz_hash));
+    while (len >= 4 && ip + 4 <= end) {
+        uint32_t h = ubz_hash4(ip);
+        uint16_t ref = ubz_hash[h];
+        ubz_hash[h] = (uint16_t)(ip - src + 1);
+        if (!ref || ubz_read32(src + ref - 1) != ubz_read32(ip)) {
+            ip++;
+            continue;
+        }
+        const uint8_t *match = src + ref - 1;
+        size_t mlen = 4;
+        while (ip + mlen < end && match[mlen] == ip[mlen])
+            mlen++;
+        size_t lit = ip - anchor;
+        uint8_t *token = op++;
+        *token = (uint8_t)((lit < 15 ? lit : 15) << 4 | (mlen - 4 < 15 ? mlen - 4 : 15));
+        if (lit >= 15)
+            op = ubz_put_len(op, lit - 15);
+        memcpy(op, anchor, lit);
+        op += lit;
+        uint16_t offset = (uint16_t)(ip - match);
+        *op++ = (uint8_t)offset;
+        *op++ = (uint8_t)(offset >> 8);
+        if (mlen - 4 >= 15)
+            op = ubz_put_len(op, mlen - 4 - 15);
+        ip += mlen;
+        anchor = ip;
+    }
+    size_t lit = end - anchor;
+    *op++ = (uint8_t)((lit < 15 ? lit : 15) << 4);
+    if (lit >= 15)
+        op = ubz_put_len(op, lit - 15);
+    memcpy(op, anchor, lit);
+    op += lit;
+    return op - dst;
+}
+
+size_t ubz_encode_block(uint8_t *src, size_t len, uint8_t *dst) {
+    struct UBZ_Block_Header *header = (struct UBZ_Block_Header *)dst;
+    uint8_t *data = dst + sizeof(*header);
+    header->magic = UBZ_MAGIC;
+    header->flags = ubz_pvt_filter(src, len) ? UBZ_FLAG_PVT_DELTA : 0;
+    header->reserved = 0;
+    header->raw_len = (uint16_t)len;
+    size_t coded = ubz_lz_encode(src, len, data);
+    if (coded < len) {
+        header->flags |= UBZ_FLAG_LZ;
+    } else {
+        memcpy(data, src, len);
+        coded = len;
+    }
+    header->data_len = (uint16_t)coded;
+    return sizeof(*header) + coded;
+}
+
+#endif
@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""Columnar session archive (.gcol): convert GPY, SBP or OAO logs, query columns.
+
+Row formats make a speed-only pass decode every frame. The archive stores each
+field as its own array, cut in blocks of --block-rows rows. A column block is
+zlib over the little endian deltas of its values (the first one absolute) in
+the narrowest of 1, 2, 4 or 8 bytes. Each block records the min and max of
+every column, so a query reads only the columns it needs and skips blocks
+whose stats rule them out.
+
+file      = header, column names, column blocks, directory, footer
+header    = "GPSCOL1\\0", version u16, block_rows u16, columns u8, 3 reserved
+names     = columns x 8 byte name
+directory = per block: rows u32, per column: offset u64, length u32, width u8, min i64, max i64
+footer    = directory offset u64, blocks u32, "GCOL"
+Columns: time_ms, lat, lon (1e-7 deg), speed, sacc (mm/s), cog (1e-5 deg), hdop (0.01), sat, fix.
+
+usage: gps_columnar.py convert LOG.gpy|LOG.sbp|LOG.oao -o OUT.gcol [--block-rows N]
+       gps_columnar.py query OUT.gcol [--column speed] [--min VALUE]
+       gps_columnar.py bench LOG.gpy
+"""
+
+import argparse
+import array
+import datetime
+import itertools
+import mmap
+import os
+import struct
+import sys
+import time
+import zlib
+
+import gpy_decode
+
+MAGIC = b"GPSCOL1\0"
+FOOTER_MAGIC = b"GCOL"
+VERSION = 1
+HEADER = struct.Struct("<8sHHB3x")
+FOOTER = struct.Struct("<QI4s")
+BLOCK = struct.Struct("<I")
+ENTRY = struct.Struct("<QIBqq")
+COLUMNS = ["time_ms", "lat", "lon", "speed", "sacc", "cog", "hdop", "sat", "fix"]
+WIDTHS = ((1, "b"), (2, "h"), (4, "i"), (8, "q"))
+
+SBP_HEADER_SIZE = 64
+SBP_FRAME = struct.Struct("<BBHIIiiiHHhBB")
+OAO_GNSS = struct.Struct("<HBBiiiIIQBBIIIIH")
+OAO_HEADER_SIZE = 512
+
+
+# ============================================================================
+# SOURCES
+# ============================================================================
+
+def rows_gpy(data):
+    for f in gpy_decode.decode(data):
+        yield (f["unix_time_ms"], f["latitude"], f["longitude"], f["speed_mm_s"], f["speed_error"],
+               f["cog"], f["hdop"], f["sat"], f["fix"])
+
+
+def rows_sbp(data):
+    for pos in range(SBP_HEADER_SIZE, len(data) - SBP_FRAME.size + 1, SBP_FRAME.size):
+        hdop, nsv, utc_sec, packed, _, lat, lon, _, sog, cog, _, sdop, _ = SBP_FRAME.unpack_from(data, pos)
+        months = packed >> 22
+        day = datetime.datetime(2000 + (months - 1) // 12, (months - 1) % 12 + 1, (packed >> 17) & 0x1F,
+                                (packed >> 12) & 0x1F, (packed >> 6) & 0x3F, tzinfo=datetime.timezone.utc)
+        yield (int(day.timestamp()) * 1000 + utc_sec, lat, lon, sog * 10, sdop * 10, cog * 1000,
+               hdop * 20, nsv, 3 if nsv else 0)
+
+
+def rows_oao(data):
+    pos = OAO_HEADER_SIZE if data[:2] == b"\xd0\x0a" else 0
+    while pos + OAO_GNSS.size <= len(data):
+        (mode, _, _, lat, lon, _, speed, heading, utc, fix, sat, sacc, _, _, _,
+         hdop) = OAO_GNSS.unpack_from(data, pos)
+        if mode not in (0x0AD4, 0x0AD5):
+            break
+        yield (utc, lat, lon, speed, sacc, heading, hdop, sat, fix)
+        pos += OAO_GNSS.size
+
+
+SOURCES = {".gpy": rows_gpy, ".sbp": rows_sbp, ".oao": rows_oao}
+
+
+# ============================================================================
+# WRITER
+# ============================================================================
+
+def encode_block(values):
+    deltas = [values[0]] + [b - a for a, b in zip(values, values[1:])]
+    lo, hi = min(deltas), max(deltas)
+    for width, code in WIDTHS:
+        bound = 1 << (width * 8 - 1)
+        if -bound <= lo and hi < bound:
+            break
+    packed = array.array(code, deltas)
+    if sys.byteorder != "little":
+        packed.byteswap()
+    return zlib.compress(packed.tobytes(), 6), width
+
+
+def convert(rows, out, block_rows):
+    """Stream rows into the archive, one block of rows in memory at a time."""
+    directory = []
+    with open(out, "wb") as f:
+        f.write(HEADER.pack(MAGIC, VERSION, block_rows, len(COLUMNS)))
+        for name in COLUMNS:
+            f.write(name.encode("ascii").ljust(8, b"\0"))
+        while True:
+            block = list(itertools.islice(rows, block_rows))
+            if not block:
+                break
+            entries = []
+            for values in zip(*block):
+                data, width = encode_block(values)
+                entries.append((f.tell(), len(data), width, min(values), max(values)))
+                f.write(data)
+            directory.append((len(block), entries))
+        offset = f.tell()
+        for count, entries in directory:
+            f.write(BLOCK.pack(count))
+            for entry in entries:
+                f.write(ENTRY.pack(*entry))
+        f.write(FOOTER.pack(offset, len(directory), FOOTER_MAGIC))
+    return sum(count for count, _ in directory), len(directory)
+
+
+# ============================================================================
+# READER
+# ============================================================================
+
+class Archive:
+    """Block directory of an archive; column blocks are decoded on request."""
+
+    def __init__(self, path):
+        self._file = open(path, "rb")
+        self.data = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, _version, self.block_rows, count, = HEADER.unpack_from(self.data, 0)
+        offset, blocks, footer = FOOTER.unpack_from(self.data, len(self.data) - FOOTER.size)
+        if magic != MAGIC or footer != FOOTER_MAGIC:
+            raise ValueError(f"{path}: not a columnar archive")
+        self.columns = [self.data[HEADER.size + i * 8:HEADER.size + i * 8 + 8].rstrip(b"\0").decode("ascii")
+                        for i in range(count)]
+        self.blocks = []
+        pos = offset
+        for _ in range(blocks):
+            (rows,) = BLOCK.unpack_from(self.data, pos)
+            pos += BLOCK.size
+            entries = {}
+            for name in self.columns:
+                entries[name] = ENTRY.unpack_from(self.data, pos)
+                pos += ENTRY.size
+            self.blocks.append((rows, entries))
+        self.bytes_read = 0
+
+    def rows(self):
+        return sum(rows for rows, _ in self.blocks)
+
+    def read(self, block, name):
+        """Values of one column in one block."""
+        offset, length, width, _, _ = self.blocks[block][1][name]
+        self.bytes_read += length
+        packed = array.array(dict(WIDTHS)[width])
+        packed.frombytes(zlib.decompress(self.data[offset:offset + length]))
+        if sys.byteorder != "little":
+            packed.byteswap()
+        return list(itertools.accumulate(packed))
+
+    def column(self, name, where=None, minimum=None):
+        """Yield the values of a column, skipping blocks whose max of `where` is below minimum."""
+        where = where or name
+        for i, (_, entries) in enumerate(self.blocks):
+            if minimum is not None and entries[where][4] < minimum:
+                continue
+            yield from self.read(i, name)
+
+    def close(self):
+        self.data.close()
+        self._file.close()
+
+
+# ============================================================================
+# COMMANDS
+# ============================================================================
+
+def source_rows(path):
+    ext = os.path.splitext(path)[1].lower()
+    if ext not in SOURCES:
+        sys.exit(f"{path}: unsupported format, use one of {', '.join(sorted(SOURCES))}")
+    with open(path, "rb") as f:
+        data = f.read()
+    return SOURCES[ext](data)
+
+
+def query(archive, name, minimum):
+    values = [v for v in archive.column(name, minimum=minimum) if minimum is None or v >= minimum]
+    return len(values), max(values, default=0), sum(values) / len(values) if values else 0.0
+
+
+def cmd_convert(args):
+    rows, blocks = convert(source_rows(args.log), args.output, args.block_rows)
+    print(f"{args.output}: {rows} rows in {blocks} blocks, "
+          f"{os.path.getsize(args.output)} bytes (source {os.path.getsize(args.log)})")
+
+
+def cmd_query(args):
+    archive = Archive(args.archive)
+    count, top, mean = query(archive, args.column, args.min)
+    print(f"{args.column}: {count} of {archive.rows()} rows, max {top}, mean {mean:.1f}, "
+          f"{archive.bytes_read} of {len(archive.data)} bytes read")
+    archive.close()
+
+
+def cmd_bench(args):
+    with open(args.log, "rb") as f:
+        data = f.read()
+    out = os.path.splitext(args.log)[0] + ".gcol"
+    convert(rows_gpy(data), out, args.block_rows)
+    t0 = time.perf_counter()
+    speeds = [f["speed_mm_s"] for f in gpy_decode.decode(data)]
+    t_gpy = time.perf_counter() - t0
+    threshold = args.min if args.min is not None else sorted(speeds)[len(speeds) * 9 // 10] if speeds else 0
+    print(f"{args.log}: {len(speeds)} rows, {len(data)} bytes, archive {os.path.getsize(out)} bytes")
+    print(f"  GPY scan, speed       {t_gpy * 1000:8.1f} ms  {len(data):9d} bytes")
+    for label, minimum in (("archive, speed", None), (f"archive, speed >= {threshold}", threshold)):
+        archive = Archive(out)
+        t0 = time.perf_counter()
+        count, _, _ = query(archive, "speed", minimum)
+        t = time.perf_counter() - t0
+        print(f"  {label:<21} {t * 1000:8.1f} ms  {archive.bytes_read:9d} bytes  ({count} rows)")
+        archive.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+    p = sub.add_parser("convert", help="GPY, SBP or OAO log to archive")
+    p.add_argument("log")
+    p.add_argument("-o", "--output", required=True)
+    p.add_argument("--block-rows", type=int, default=4096)
+    p.set_defaults(func=cmd_convert)
+    p = sub.add_parser("query", help="count, max and mean of a column")
+    p.add_argument("archive")
+    p.add_argument("--column", default="speed", choices=COLUMNS)
+    p.add_argument("--min", type=int, help="only values >= MIN, blocks below are skipped")
+    p.set_defaults(func=cmd_query)
+    p = sub.add_parser("bench", help="speed pass over a GPY log against its archive")
+    p.add_argument("log")
+    p.add_argument("--block-rows", type=int, default=4096)
+    p.add_argument("--min", type=int, help="threshold, default the 90th percentile speed")
+    p.set_defaults(func=cmd_bench)
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,122 @@
+/*
+ * Check the checksum kernels of include/gps_log_checksum.h bit for bit against
+ * the byte loops they replace, then time both for the frame sizes of the logs.
+ *
+ * build: cc -O2 -Wall -I../include -o gps_log_checksum_bench gps_log_checksum_bench.c
+ *        (add -mssse3 or -march=native for the SIMD kernel)
+ * usage: gps_log_checksum_bench [MB]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+#include "gps_log_checksum.h"
+
+// The former Fletcher16() of log_gpy.c
+static uint16_t fletcher16_ref(const uint8_t *data, size_t count) {
+    uint16_t sum1 = 0, sum2 = 0;
+    for (size_t i = 0; i < count; ++i) {
+        sum1 = (sum1 + data[i]) & 0xFF;
+        sum2 = (sum2 + sum1) & 0xFF;
+    }
+    return (sum2 << 8) | sum1;
+}
+
+// The former oao_finalize_checksum() of log_oao.c
+static uint16_t oao_ref(const uint8_t *buffer, size_t length) {
+    uint8_t a = 0, b = 0;
+    for (size_t i = 0; i < 2; ++i)
+        b += (a += buffer[i]);
+    for (size_t i = 4; i < length; ++i)
+        b += (a += buffer[i]);
+    return (b << 8) | a;
+}
+
+static double now_s(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static volatile uint16_t sink;
+
+static void bench(const char *name, uint16_t (*f)(const uint8_t *, size_t), const uint8_t *buf, size_t len,
+                  size_t total) {
+    size_t rounds = total / len;
+    double t0 = now_s();
+#if HAVE_RDTSC
+    uint64_t c0 = __rdtsc();
+#endif
+    for (size_t i = 0; i < rounds; i++)
+        sink = f(buf + (i & 63), len);
+#if HAVE_RDTSC
+    uint64_t cycles = __rdtsc() - c0;
+#endif
+    double s = now_s() - t0;
+    printf("  %-10s %7.2f GB/s", name, (double)rounds * len / s / 1e9);
+#if HAVE_RDTSC
+    printf("  %5.2f bytes/cycle (TSC)", (double)rounds * len / cycles);
+#endif
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    size_t total = (size_t)(argc > 1 ? atoi(argv[1]) : 256) << 20;
+    size_t size = 1 << 20;
+    uint8_t *buf = malloc(size + 64);
+    srand(1);
+    for (size_t i = 0; i < size + 64; i++)
+        buf[i] = (uint8_t)rand();
+
+    // Bit exact: every length up to 1 KiB at several offsets, chunked updates, large buffers
+    unsigned errors = 0;
+    for (size_t len = 0; len <= 1024; len++) {
+        for (size_t off = 0; off < 16; off += 3) {
+            const uint8_t *p = buf + off * 97;
+            errors += gps_log_fletcher16(p, len) != fletcher16_ref(p, len);
+            if (len >= 4)
+                errors += gps_log_oao_sum(p, len) != oao_ref(p, len);
+            gps_log_fletcher_t s = {0, 0};
+            for (size_t done = 0, step = 1; done < len; done += step, step = step * 3 % 37 + 1) {
+                size_t n = len - done < step ? len - done : step;
+                gps_log_fletcher_update(&s, p + done, n);
+            }
+            errors += (uint16_t)(((s.b & 0xFF) << 8) | (s.a & 0xFF)) != fletcher16_ref(p, len);
+        }
+    }
+    errors += gps_log_fletcher16(buf, size) != fletcher16_ref(buf, size);
+    printf("bit exact: %s (%u mismatches)%s\n", errors ? "FAIL" : "ok", errors,
+#if defined(__SSSE3__)
+           ", SSSE3 kernel"
+#else
+           ", scalar kernel"
+#endif
+    );
+
+    static const struct {
+        const char *what;
+        size_t len;
+        int oao;
+    } sizes[] = {
+        {"GPY compressed frame", 18, 0}, {"GPY full frame", 34, 0}, {"OAO GNSS frame", 52, 1},
+        {"GPY header", 70, 0},           {"GPY v2 block", 484, 0},  {"OAO header", 512, 1},
+        {"1 MiB", 1 << 20, 0},
+    };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        printf("%s (%zu B):\n", sizes[i].what, sizes[i].len);
+        if (sizes[i].oao) {
+            bench("reference", oao_ref, buf, sizes[i].len, total);
+            bench("kernel", gps_log_oao_sum, buf, sizes[i].len, total);
+        } else {
+            bench("reference", fletcher16_ref, buf, sizes[i].len, total);
+            bench("kernel", gps_log_fletcher16, buf, sizes[i].len, total);
+        }
+    }
+    free(buf);
+    return errors ? 1 : 0;
+}
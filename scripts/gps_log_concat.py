@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Join the segments of a session (GPS_LOG_SEGMENT_ENABLED) into one file per format.
+
+A session NAME.ext continues in NAME_s01.ext, NAME_s02.ext, ... Each segment
+starts with the header of its format, which is kept only from the first one;
+GPX segments are closed documents, their footers and headers are cut at the joins.
+OAO headers carry the session results up to the end of their segment, the
+joined file gets the one of the last segment.
+
+usage: gps_log_concat.py NAME.ext [NAME.ext ...] [-o OUTDIR]
+"""
+
+import argparse
+import glob
+import os
+import re
+
+HEADER_BYTES = {".sbp": 64, ".gpy": 72, ".oao": 512}
+GPX_BODY = b"<trkseg>\n"
+GPX_FOOTER = b"</trkseg>\n</trk>\n</gpx>\n"
+
+
+def segments(path):
+    base, ext = os.path.splitext(path)
+    pattern = re.compile(re.escape(os.path.basename(base)) + r"_s(\d\d)" + re.escape(ext) + "$")
+    found = []
+    for name in glob.glob(glob.escape(base) + "_s[0-9][0-9]" + ext):
+        m = pattern.search(os.path.basename(name))
+        if m:
+            found.append((int(m.group(1)), name))
+    return [path] + [name for _, name in sorted(found)]
+
+
+def join(parts, ext):
+    out = bytearray()
+    for n, part in enumerate(parts):
+        with open(part, "rb") as f:
+            data = f.read()
+        if ext == ".gpx":
+            if n > 0:
+                cut = data.find(GPX_BODY)
+                data = data[cut + len(GPX_BODY):] if cut >= 0 else data
+            if n < len(parts) - 1 and data.endswith(GPX_FOOTER):
+                data = data[:-len(GPX_FOOTER)]
+        elif n > 0:
+            header = HEADER_BYTES.get(ext, 0)
+            if ext == ".oao" and len(data) >= header and len(out) >= header:
+                out[:header] = data[:header]
+            data = data[header:]
+        out += data
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("files", nargs="+", help="first file of each session (without _sNN)")
+    parser.add_argument("-o", "--outdir", default=None, help="default: NAME_joined.ext next to NAME.ext")
+    args = parser.parse_args()
+    for path in args.files:
+        parts = segments(path)
+        base, ext = os.path.splitext(path)
+        if args.outdir:
+            name = os.path.join(args.outdir, os.path.basename(path))
+        else:
+            name = base + "_joined" + ext
+        out = join(parts, ext.lower())
+        with open(name, "wb") as f:
+            f.write(out)
+        print(f"{name}: {len(parts)} segments, {len(out)} bytes")
+
+
+if __name__ == "__main__":
+    main()
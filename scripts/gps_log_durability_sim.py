@@ -0,0 +1,352 @@
+#!/usr/bin/env python3
+"""Power cut simulation of the fsync scheduler of the async writer.
+
+Replays the writer of gps_log_file.c on the host: per format ring slots sealed
+when full or after ASYNC_WRITER_FLUSH_TIMEOUT_MS, the loss window deadline
+armed at the oldest unsynced commit, syncs ahead of it by the slowest sync
+seen (at least a card stall) and a tick, one fsync per wakeup and the window stretch under the sync budget. Write
+and fsync durations are drawn from a card model with optional stalls. Every
+file is written to DIR with real write() and fsync() calls.
+
+A power cut leaves a FAT file at the length of its last fsync. For every cut
+time the files are cut to that length and decoded: the image must hold whole
+frames with consecutive sequence numbers, and no frame committed more than
+the loss window before the cut may be missing unless the sync that covered it
+was counted late (the late counter of the device stats). Exit status 1 on a
+violation.
+
+The writer wakeups per second of the run are reported as well, the figure
+gps_log_file_print_stats() prints on the device.
+
+usage: gps_log_durability_sim.py [--minutes N] [--rate HZ] [--stall-pct P]
+                                 [--seed N] [--dir DIR] [--formats ubx,sbp,...]
+"""
+
+import argparse
+import bisect
+import os
+import random
+import struct
+import sys
+import tempfile
+
+TICK_MS = 10                         # CONFIG_FREERTOS_HZ 100
+SLOT_PAYLOAD = 4096                  # ASYNC_WRITER_BUFFER_SIZE, no chunk header
+FLUSH_TIMEOUT_MS = 1000              # ASYNC_WRITER_FLUSH_TIMEOUT_MS
+BUDGET_PERCENT = 5                   # CONFIG_GPS_LOG_SYNC_BUDGET_PERCENT
+STALL_MS = 100                       # ASYNC_WRITER_STALL_MS
+
+# format: frame bytes per epoch, or per second (gpx), ring slots, loss window (s), Kconfig defaults
+FORMATS = {
+    "ubx": dict(epoch=128, second=512, slots=4, window=5),
+    "sbp": dict(epoch=32, second=0, slots=2, window=5),
+    "gpx": dict(epoch=0, second=256, slots=2, window=30),
+    "oao": dict(epoch=52, second=0, slots=2, window=5),
+    "gpy": dict(epoch=24, second=0, slots=2, window=5),
+}
+
+FRAME = struct.Struct("<2sBBHII")    # sync, class, id, length, seq, commit ms
+FRAME_OVERHEAD = FRAME.size + 2      # + Fletcher checksum
+
+
+def fletcher(data):
+    a = b = 0
+    for byte in data:
+        a = (a + byte) & 0xFF
+        b = (b + a) & 0xFF
+    return bytes((a, b))
+
+
+def frame(code, seq, commit_ms, size):
+    payload_len = max(size, FRAME_OVERHEAD) - FRAME_OVERHEAD + 8
+    body = FRAME.pack(b"\xb5\x62", code, 1, payload_len, seq, commit_ms)[2:]
+    body += bytes((seq + i) & 0xFF for i in range(payload_len - 8))
+    return b"\xb5\x62" + body + fletcher(body)
+
+
+class Card:
+    """Write and fsync durations in ms, with a stall now and then."""
+
+    def __init__(self, rng, stall_pct):
+        self.rng = rng
+        self.stall_pct = stall_pct
+
+    def stall(self):
+        return self.rng.uniform(150, 400) if self.rng.random() * 100 < self.stall_pct else 0
+
+    def write_ms(self, length):
+        return 1 + length / 2048 + self.stall()
+
+    def sync_ms(self):
+        return self.rng.uniform(5, 25) + 2 * self.stall()
+
+
+class File:
+    def __init__(self, name, spec, path):
+        self.name = name
+        self.spec = spec
+        self.fd = os.open(path, os.O_CREAT | os.O_TRUNC | os.O_WRONLY, 0o644)
+        self.path = path
+        # ring
+        self.sealed = []               # (bytes, first commit ms)
+        self.open = bytearray()
+        self.dirty_ms = 0
+        self.dropped = 0
+        self.seq = 0
+        self.committed = 0             # bytes committed
+        self.commits = []              # (end offset, commit ms) of every frame
+        # sync state (file_sync_t)
+        self.window_ms = spec["window"] * 1000
+        self.cost_ms = 0.0
+        self.cost_max_ms = 0.0
+        self.syncs = 0
+        self.late = 0
+        self.dirty_since = 0
+        self.due = 0
+        self.armed = False
+        self.written = False
+        self.length = 0                # bytes written
+        self.durable = [(0, 0, False)]  # (time, synced length, late)
+
+    def commit(self, now, size, writer):
+        data = frame(len(self.name), self.seq, now, size)
+        if len(self.open) + len(data) > SLOT_PAYLOAD:
+            if len(self.sealed) >= self.spec["slots"]:
+                self.dropped += 1      # log_reserve(): ring full, frame dropped
+                return
+            self.seal()
+            writer.kick(True)
+        if not self.open:
+            self.dirty_ms = now
+            writer.kick(False)
+        self.open += data
+        self.seq += 1
+        self.committed += len(data)
+        self.commits.append((self.committed, now))
+
+    def seal(self):
+        if self.open:
+            self.sealed.append((bytes(self.open), self.dirty_ms))
+            self.open = bytearray()
+
+
+class Writer:
+    """async_writer_task() and its helpers, one call to step() per tick."""
+
+    def __init__(self, files, card):
+        self.files = files
+        self.card = card
+        self.idle = False
+        self.notified = False
+        self.wait_until = None         # None = portMAX_DELAY
+        self.busy_until = 0
+        self.stretch = 100
+        self.wakeups = 0
+
+    def kick(self, force):
+        if force or self.idle:
+            self.notified = True
+
+    def pending(self):
+        return any(f.sealed or f.open for f in self.files)
+
+    def write_ring(self, f, t):
+        while f.sealed:
+            data, first = f.sealed.pop(0)
+            os.write(f.fd, data)
+            t += self.card.write_ms(len(data))
+            f.length += len(data)
+            if not f.written:
+                f.written = True
+                f.dirty_since = first
+        return t
+
+    def budget(self):
+        load_ppm = sum(f.cost_ms * 1000 * 1000 / f.window_ms for f in self.files)
+        budget_ppm = BUDGET_PERCENT * 10000
+        self.stretch = load_ppm * 100 / budget_ppm if load_ppm > budget_ppm else 100
+
+    def interval(self, f):
+        window = f.window_ms * self.stretch / 100
+        cost = max(f.cost_max_ms + 1, STALL_MS) + TICK_MS
+        return window - cost if window > 2 * cost else window / 2
+
+    def sync(self, f, t):
+        f.seal()
+        t = self.write_ring(f, t)
+        f.armed = False
+        f.written = False
+        os.fsync(f.fd)
+        cost = self.card.sync_ms()
+        t += cost
+        f.cost_ms = (f.cost_ms * 7 + cost) / 8 if f.syncs else cost
+        f.cost_max_ms = max(f.cost_max_ms, cost)
+        f.syncs += 1
+        late = t - f.dirty_since > f.window_ms
+        f.late += late
+        f.durable.append((t, f.length, late))
+        self.budget()
+        return t
+
+    def schedule_syncs(self, now, t, wait):
+        synced = False
+        for f in self.files:
+            if not f.armed:
+                if not f.written:
+                    if not f.open:
+                        continue
+                    f.dirty_since = f.dirty_ms
+                f.due = f.dirty_since + self.interval(f)
+                f.armed = True
+            left = f.due - now
+            if left <= 0:
+                if synced:
+                    wait = TICK_MS
+                else:
+                    t = self.sync(f, t)
+                    synced = True
+            elif wait is None or left < wait:
+                wait = left
+        return t, wait
+
+    def flush_expired(self, now):
+        t = now
+        wait = None
+        for f in self.files:
+            t = self.write_ring(f, t)
+            if not f.open:
+                continue
+            age = now - f.dirty_ms
+            if age >= FLUSH_TIMEOUT_MS:
+                f.seal()
+                t = self.write_ring(f, t)
+            elif wait is None or FLUSH_TIMEOUT_MS - age < wait:
+                wait = FLUSH_TIMEOUT_MS - age
+        t, wait = self.schedule_syncs(now, t, wait)
+        return t, wait
+
+    def step(self, now):
+        if now < self.busy_until:
+            return
+        if self.wait_until is None and not self.idle:
+            self.idle = True
+            if self.pending():
+                self.wait_until = now
+        due = self.wait_until is not None and now >= self.wait_until
+        if not (self.notified or due):
+            return
+        self.notified = False
+        self.idle = False
+        self.wakeups += 1
+        t, wait = self.flush_expired(now)
+        self.busy_until = t
+        self.wait_until = None if wait is None else now + max(wait, TICK_MS)
+
+
+def decode(f, data):
+    """Frame end offsets of a whole file, checking checksum and sequence of every frame."""
+    ends = []
+    pos = 0
+    while pos < len(data):
+        _, _, _, payload_len, seq, _ = FRAME.unpack_from(data, pos)
+        end = pos + FRAME.size - 8 + payload_len + 2
+        if end > len(data) or data[end - 2:end] != fletcher(data[pos + 2:end - 2]) or seq != len(ends):
+            raise ValueError(f"{f.name}: bad frame {seq} at {pos}")
+        ends.append(end)
+        pos = end
+    return ends
+
+
+def check(f, ends, cut, sync):
+    """Image of f at a power cut: (lost ms, accounted), raise if it is not whole frames.
+
+    sync is the index in f.durable of the last fsync done by the cut.
+    """
+    length = f.durable[sync][1]
+    frames = bisect.bisect_right(ends, length)
+    if length != (ends[frames - 1] if frames else 0):
+        raise ValueError(f"{f.name} @{cut}ms: synced length {length} ends inside a frame")
+    if frames >= len(f.commits):
+        return 0, True
+    lost_ms = cut - f.commits[frames][1]
+    if lost_ms <= f.window_ms:
+        return lost_ms, True
+    # Beyond the window only if the sync that covered the frame was counted late
+    for _, synced, late in f.durable[sync + 1:]:
+        if synced >= ends[frames]:
+            return lost_ms, late
+    return lost_ms, False
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--minutes", type=float, default=10)
+    parser.add_argument("--rate", type=int, default=10, help="output rate in Hz")
+    parser.add_argument("--stall-pct", type=float, default=1.0,
+                        help="share of writes and syncs that stall the card (%%)")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--dir", help="where to write the files (default: a temporary directory)")
+    parser.add_argument("--formats", default=",".join(FORMATS),
+                        help="comma separated formats to log (default: all)")
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    directory = args.dir or tempfile.mkdtemp(prefix="gps_durability_")
+    os.makedirs(directory, exist_ok=True)
+    names = args.formats.split(",")
+    if not names or any(name not in FORMATS for name in names):
+        sys.exit(f"--formats: choose from {','.join(FORMATS)}")
+    files = [File(name, FORMATS[name], os.path.join(directory, f"SIM.{name}")) for name in names]
+    writer = Writer(files, Card(rng, args.stall_pct))
+
+    end_ms = int(args.minutes * 60 * 1000)
+    epoch_ms = 1000 / args.rate
+    next_epoch = 0.0
+    for now in range(0, end_ms, TICK_MS):
+        while next_epoch < now + TICK_MS:
+            at = int(next_epoch)
+            for f in files:
+                if f.spec["epoch"]:
+                    f.commit(at, f.spec["epoch"], writer)
+                if f.spec["second"] and at % 1000 < epoch_ms:
+                    f.commit(at, f.spec["second"], writer)
+            next_epoch += epoch_ms
+        writer.step(now)
+    # close_files(): the writer writes everything out and every file is synced
+    t = max(end_ms, writer.busy_until)
+    for f in files:
+        t = writer.sync(f, t)
+        os.close(f.fd)
+
+    failed = False
+    print(f"{args.minutes:g} min at {args.rate} Hz, {args.stall_pct:g}% stalls, "
+          f"{writer.wakeups} wakeups ({writer.wakeups * 1000 / end_ms:.1f}/s), window stretch {writer.stretch:.0f}%, files in {directory}")
+    for f in files:
+        with open(f.path, "rb") as fh:
+            data = fh.read()
+        worst = late_cuts = cuts = sync = 0
+        try:
+            ends = decode(f, data)
+            for cut in range(0, end_ms, TICK_MS):
+                while sync + 1 < len(f.durable) and f.durable[sync + 1][0] <= cut:
+                    sync += 1
+                lost_ms, ok = check(f, ends, cut, sync)
+                cuts += 1
+                if not ok:
+                    raise ValueError(f"{f.name} @{cut}ms: lost {lost_ms:.0f}ms, window "
+                                     f"{f.window_ms}ms, no late sync")
+                if lost_ms > f.window_ms:
+                    late_cuts += 1
+                worst = max(worst, lost_ms)
+        except ValueError as err:
+            print(f"FAIL {err}")
+            failed = True
+            continue
+        print(f"{f.name}: {cuts} cuts, synced prefix whole, worst loss {worst / 1000:.2f}s of "
+              f"{f.window_ms / 1000:.0f}s window, {f.syncs} syncs ({f.late} late, "
+              f"{late_cuts} cuts past the window), {f.dropped} frames dropped")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
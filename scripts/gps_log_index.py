@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""Seek a UBX or GPY log through its time index sidecar (.idx, GPS_LOG_INDEX).
+
+Layout: include/gps_log_index.h. Lookups are binary searches over the
+entries of one stream; --extract copies the located byte range of the log,
+GPY with its file header in front so the piece decodes on its own. Entries
+of segmented logs (GPS_LOG_SEGMENT_ENABLED) name their segment, the range is
+cut from LOG_sNN.ext for segment NN > 0. Version 1 indexes (16 byte entries,
+no segment) are read as well.
+
+usage: gps_log_index.py LOG.idx --stream gpy (--time ISO8601 | --run N | --list)
+                        [--extract LOG.gpy -o OUT]
+"""
+
+import argparse
+import bisect
+import datetime
+import os
+import struct
+import sys
+
+GPS_IDX_MAGIC = 0x58444947
+HEADER = struct.Struct("<IHHII")
+ENTRY = {1: struct.Struct("<qIBBH"), 2: struct.Struct("<qQBBHB3x")}
+STREAMS = {"ubx": 1, "gpy": 2}
+STREAM_HEADER_BYTES = {"ubx": 0, "gpy": 72}
+FLAG_TIME, FLAG_RUN = 0x01, 0x02
+
+
+class Index:
+    """Entries of one stream, in time order."""
+
+    def __init__(self, data, stream):
+        magic, version, entry_size, self.interval_ms, _ = HEADER.unpack_from(data, 0)
+        if magic != GPS_IDX_MAGIC:
+            raise ValueError("not a time index")
+        entry = ENTRY.get(version)
+        if entry is None or entry_size < entry.size:
+            raise ValueError(f"index version {version} with {entry_size} byte entries not supported")
+        code = STREAMS[stream]
+        self.entries = []
+        for pos in range(HEADER.size, len(data) - entry_size + 1, entry_size):
+            utc_ms, offset, s, flags, run, *segment = entry.unpack_from(data, pos)
+            if s == code:
+                self.entries.append((utc_ms, offset, flags, run, segment[0] if segment else 0))
+        self.times = [e[0] for e in self.entries]
+        self.run_starts = [e for e in self.entries if e[2] & FLAG_RUN]
+        self.run_numbers = [e[3] for e in self.run_starts]
+
+    def seek_time(self, utc_ms):
+        """Last entry at or before utc_ms and the entry after it (None at the end)."""
+        i = bisect.bisect_right(self.times, utc_ms) - 1
+        if i < 0:
+            i = 0
+        after = self.entries[i + 1] if i + 1 < len(self.entries) else None
+        return self.entries[i], after
+
+    def seek_run(self, run):
+        """Start entry of a run and the start of the next run (None for the last)."""
+        i = bisect.bisect_left(self.run_numbers, run)
+        if i >= len(self.run_numbers) or self.run_numbers[i] != run:
+            raise KeyError(f"run {run} not indexed")
+        after = self.run_starts[i + 1] if i + 1 < len(self.run_starts) else None
+        return self.run_starts[i], after
+
+
+def utc_text(utc_ms):
+    return datetime.datetime.fromtimestamp(utc_ms / 1000, datetime.timezone.utc).isoformat()
+
+
+def parse_time(text):
+    t = datetime.datetime.fromisoformat(text.replace("Z", "+00:00"))
+    if t.tzinfo is None:
+        t = t.replace(tzinfo=datetime.timezone.utc)
+    return int(t.timestamp() * 1000)
+
+
+def segment_file(log, segment):
+    if not segment:
+        return log
+    base, ext = os.path.splitext(log)
+    return f"{base}_s{segment:02d}{ext}"
+
+
+def extract(log, stream, start, end, out):
+    # every segment starts with its own file header
+    with open(segment_file(log, start[4]), "rb") as f:
+        head = f.read(STREAM_HEADER_BYTES[stream])
+        f.seek(start[1])
+        same = end is not None and end[4] == start[4]
+        body = f.read(end[1] - start[1] if same else -1)
+    with open(out, "wb") as f:
+        f.write(head + body)
+    return len(head) + len(body)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("index")
+    parser.add_argument("--stream", choices=sorted(STREAMS), default="gpy")
+    what = parser.add_mutually_exclusive_group(required=True)
+    what.add_argument("--time", help="UTC, e.g. 2026-10-19T12:34:56Z")
+    what.add_argument("--run", type=int)
+    what.add_argument("--list", action="store_true", help="list the run starts")
+    parser.add_argument("--extract", metavar="LOG", help="log file of the stream to cut from")
+    parser.add_argument("-o", "--output", help="output of --extract")
+    args = parser.parse_args()
+
+    with open(args.index, "rb") as f:
+        index = Index(f.read(), args.stream)
+    if args.list:
+        for utc_ms, offset, _, run, segment in index.run_starts:
+            print(f"run {run}: {utc_text(utc_ms)} segment {segment} offset {offset}")
+        return
+    if args.run is not None:
+        start, end = index.seek_run(args.run)
+    else:
+        start, end = index.seek_time(parse_time(args.time))
+    same = end is not None and end[4] == start[4]
+    print(f"{utc_text(start[0])} run {start[3]} segment {start[4]} offset {start[1]}"
+          + (f" .. {end[1]}" if same else " .. end of file"))
+    if args.extract:
+        if not args.output:
+            sys.exit("--extract needs -o OUT")
+        size = extract(args.extract, args.stream, start, end, args.output)
+        print(f"{args.output}: {size} bytes")
+
+
+if __name__ == "__main__":
+    main()
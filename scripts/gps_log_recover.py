@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Recover the intact chunks of a chunked GPS log or a .glc container.
+
+Layout: include/gps_log_container.h. With GPS_LOG_CHUNKED every format file is
+a sequence of chunks (header + payload, CRC32 of the payload in the header), a
+.glc container has its stream directory in front. One linear pass keeps every
+chunk whose header and CRC are sound and appends its payload to the plain
+format file. A bad chunk (torn sector, corrupted byte, zero filled tail) is
+skipped by searching for the next chunk magic. GPY v1 restarts with a full
+frame in every chunk and GPY v2 blocks never span chunks, so each kept chunk
+decodes on its own. Chunks with CRC 0 (containers of older firmware) are kept
+unchecked.
+
+usage: gps_log_recover.py LOG.gpy|LOG.ubx|...|LOG.glc [-o OUTDIR]
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+GLC_MAGIC = b"GPSLOGC1"
+GLC_CHUNK_MAGIC = b"GC"                     # 0x4347 little endian
+GLC_CHUNK_FLAG_FIRST = 0x01
+HEADER = struct.Struct("<8sHHHBB")          # magic, version, header_size, chunk_header_size, count, reserved
+STREAM = struct.Struct("<B3s")
+CHUNK = struct.Struct("<2sBBIII")           # magic, stream, flags, seq, len, crc
+CHUNK_MAX = 1 << 16                         # Larger than any ring slot, bounds a corrupted length
+
+
+class Stream:
+    def __init__(self, ext):
+        self.ext = ext
+        self.parts = []
+        self.good = 0
+        self.unchecked = 0
+        self.lost = 0
+        self.next_seq = None
+
+    def add(self, seq, flags, payload):
+        if flags & GLC_CHUNK_FLAG_FIRST and seq == 0:
+            self.next_seq = 0               # file appended after a restart, numbering starts over
+        if self.next_seq is not None and seq > self.next_seq:
+            self.lost += seq - self.next_seq
+        self.next_seq = seq + 1
+        self.parts.append(payload)
+        self.good += 1
+
+
+def recover(data, streams, pos, single):
+    """Walk the chunks from pos, return (bad regions, bad bytes).
+
+    single is the Stream of a chunked format file, its chunks always carry a CRC.
+    """
+    bad_regions = bad_bytes = 0
+    bad_start = None
+    end = len(data)
+    view = memoryview(data)
+    while pos + CHUNK.size <= end:
+        magic, sid, flags, seq, length, crc = CHUNK.unpack_from(data, pos)
+        start = pos + CHUNK.size
+        stream = single or streams.get(sid)
+        if (magic == GLC_CHUNK_MAGIC and stream is not None and 0 < length <= CHUNK_MAX
+                and start + length <= end):
+            payload = view[start:start + length]
+            checked = crc != 0
+            if zlib.crc32(payload) == crc or not (checked or single):
+                if bad_start is not None:
+                    bad_regions += 1
+                    bad_bytes += pos - bad_start
+                    bad_start = None
+                stream.add(seq, flags, payload)
+                stream.unchecked += not checked
+                pos = start + length
+                continue
+        if bad_start is None:
+            bad_start = pos
+        found = data.find(GLC_CHUNK_MAGIC, pos + 1)
+        pos = found if found >= 0 else end
+    if bad_start is not None:
+        # a zero filled preallocated tail is no damage
+        tail = view[bad_start:]
+        if any(tail):
+            bad_regions += 1
+            bad_bytes += len(tail)
+    return bad_regions, bad_bytes
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log")
+    parser.add_argument("-o", "--outdir", default="recovered")
+    args = parser.parse_args()
+
+    with open(args.log, "rb") as f:
+        data = f.read()
+    base, ext = os.path.splitext(os.path.basename(args.log))
+    streams = {}
+    single = None
+    if data.startswith(GLC_MAGIC):
+        _, _, header_size, chunk_size, count, _ = HEADER.unpack_from(data, 0)
+        if chunk_size != CHUNK.size:
+            sys.exit(f"{args.log}: chunk header of {chunk_size} bytes, expected {CHUNK.size}")
+        for i in range(count):
+            sid, name = STREAM.unpack_from(data, HEADER.size + i * STREAM.size)
+            streams[sid] = Stream(name.decode("ascii"))
+        pos = header_size
+    else:
+        single = streams[0] = Stream(ext.lstrip("."))
+        pos = 0
+    bad_regions, bad_bytes = recover(data, streams, pos, single)
+
+    os.makedirs(args.outdir, exist_ok=True)
+    streams = {sid: s for sid, s in streams.items() if s.good or not single}
+    for stream in streams.values():
+        name = os.path.join(args.outdir, f"{base}.{stream.ext}")
+        if os.path.abspath(name) == os.path.abspath(args.log):
+            sys.exit(f"{name}: output would replace the input, use -o")
+        with open(name, "wb") as f:
+            for part in stream.parts:
+                f.write(part)
+        size = sum(len(part) for part in stream.parts)
+        unchecked = f", {stream.unchecked} without CRC" if stream.unchecked else ""
+        print(f"{name}: {size} bytes, {stream.good} chunks kept, {stream.lost} lost{unchecked}")
+    if not streams:
+        print(f"{args.log}: no chunks found, not a chunked log", file=sys.stderr)
+    print(f"{bad_regions} damaged regions, {bad_bytes} bytes skipped")
+    return 1 if bad_regions or not streams else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,373 @@
+#!/usr/bin/env python3
+"""Round trip checks of the log encoders against the host decoders.
+
+Every check builds a log from a generated 20 Hz track, decodes it with the
+tool a user would run and compares the result with the source bit for bit:
+
+  glc   .glc container and GPS_LOG_CHUNKED framing written per
+        include/gps_log_container.h, read back by gps_log_split.py and
+        gps_log_recover.py, also with a corrupted chunk, a torn tail and a
+        zero filled preallocated tail
+  ubz   UBX compressed by the device encoder (ubz_compress, log_ubz.c) at
+        several block sizes, restored by ubz_decompress.py
+  gpy   two GPY v1 sessions appended to one file by gps_log_transcode: every
+        header is followed by a full frame and both gpy_decode.py and the C
+        reader (include/gps_log_reader.h) decode across it
+  gpx   GPX decimation of gps_log_transcode -r: the first epoch of every
+        1/HZ s slot of the UTC second, also for a track off the grid and
+        with dropped epochs
+
+ubz, gpy and gpx need the host tools, built next to this script:
+  cc -O2 -Wall -I../include -o ubz_compress ubz_compress.c
+  cc -O2 -Wall -pthread -I../include -o gps_log_transcode gps_log_transcode.c ../gps_log_encode.c
+
+usage: gps_log_roundtrip.py [-b BINDIR] [-s SEED] [glc|ubz|gpy|gpx ...]
+"""
+
+import argparse
+import os
+import random
+import re
+import struct
+import subprocess
+import sys
+import tempfile
+import zlib
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import gps_log_recover  # noqa: E402
+import gps_log_split  # noqa: E402
+import gpy_decode  # noqa: E402
+import ubz_decompress  # noqa: E402
+
+UBX_PVT = struct.Struct("<IHBBBBBBIiBBBBiiiiIIiiiiiIIH6siHH")
+UBX_DOP = struct.Struct("<IHHHHHHH")
+OAO_FRAME = struct.Struct("<HBBiiiIIQBBIIIIH")
+OAO_HEADER_LENGTH = 512
+GPY_HEADER_SIZE = 72
+GPY_FULL_ID = 0xE0
+
+
+# ============================================================================
+# TRACK
+# ============================================================================
+
+def track(rng, start_ms, count, step_ms=50, drop=0.0):
+    """Epochs of a plausible track, dicts in the units of gps_log_epoch_t."""
+    epochs = []
+    lat, lon = 520000000 + rng.randrange(10**6), 43000000 + rng.randrange(10**6)
+    speed, heading, hmsl = 8000, 9000000, 12000
+    t = start_ms
+    for _ in range(count):
+        t += step_ms
+        speed = max(0, speed + rng.randrange(-150, 151))
+        heading = (heading + rng.randrange(-40000, 40001)) % 36000000
+        lat += rng.randrange(-400, 401)
+        lon += rng.randrange(-600, 601)
+        hmsl += rng.randrange(-20, 21)
+        if rng.random() < drop:
+            continue
+        epochs.append({"utc_ms": t, "lat": lat, "lon": lon, "hmsl": hmsl, "gspeed": speed,
+                       "heading": heading, "sacc": 300 + rng.randrange(200),
+                       "hacc": 900 + rng.randrange(500), "vacc": 1500 + rng.randrange(500),
+                       "heading_acc": 200000 + rng.randrange(10**5), "hdop": 70 + rng.randrange(60),
+                       "num_sv": 14 + rng.randrange(8), "fix_type": 3})
+    return epochs
+
+
+def days_to_civil(days):
+    days += 719468
+    era = days // 146097
+    doe = days - era * 146097
+    yoe = (doe - doe // 1460 + doe // 36524 - doe // 146096) // 365
+    doy = doe - (365 * yoe + yoe // 4 - yoe // 100)
+    mp = (5 * doy + 2) // 153
+    month = mp + 3 if mp < 10 else mp - 9
+    return yoe + era * 400 + (month <= 2), month, doy - (153 * mp + 2) // 5 + 1
+
+
+def ubx_message(cls, ident, payload):
+    body = bytes((cls, ident)) + struct.pack("<H", len(payload)) + payload
+    a = b = 0
+    for x in body:
+        a = (a + x) & 0xFF
+        b = (b + a) & 0xFF
+    return b"\xb5\x62" + body + bytes((a, b))
+
+
+def ubx_log(epochs):
+    """NAV-PVT followed by NAV-DOP per epoch, the order the receiver sends."""
+    out = bytearray()
+    for e in epochs:
+        days, ms = divmod(e["utc_ms"], 86400000)
+        year, month, day = days_to_civil(days)
+        itow = (e["utc_ms"] // 1000 - 315964800 + 18) % 604800 * 1000 + ms % 1000
+        pvt = UBX_PVT.pack(itow, year, month, day, ms // 3600000, ms // 60000 % 60, ms // 1000 % 60, 0x37,
+                           20, ms % 1000 * 1000000, e["fix_type"], 0x01, 0, e["num_sv"], e["lon"], e["lat"],
+                           e["hmsl"] + 47000, e["hmsl"], e["hacc"], e["vacc"], 0, 0, 0, e["gspeed"],
+                           e["heading"], e["sacc"], e["heading_acc"], 120, bytes(6), 0, 0, 0)
+        out += ubx_message(0x01, 0x07, pvt)
+        out += ubx_message(0x01, 0x04, UBX_DOP.pack(itow, 150, 120, 80, 100, e["hdop"], 60, 70))
+    return bytes(out)
+
+
+# ============================================================================
+# CHECKS
+# ============================================================================
+
+def result(name, what, errors):
+    print(f"{name}: {what}, bit exact: {'FAIL' if errors else 'ok'} ({errors} mismatches)")
+    return errors
+
+
+def tool(bindir, name):
+    path = os.path.join(bindir, name)
+    return path if os.access(path, os.X_OK) else None
+
+
+def run(*args):
+    subprocess.run(args, check=True, stdout=subprocess.DEVNULL)
+
+
+def glc_chunk(sid, seq, payload, crc=True):
+    header = gps_log_recover.CHUNK.pack(gps_log_recover.GLC_CHUNK_MAGIC, sid, 1 if seq == 0 else 0, seq,
+                                        len(payload), zlib.crc32(payload) if crc else 0)
+    return header + payload
+
+
+def check_glc(rng, tmp, _bindir):
+    """Container and chunked files of random stream data cut into random chunk sizes."""
+    exts = ["ubx", "sbp", "gpx", "gpy", "oao", "txt"]
+    streams = {sid: bytes(rng.randrange(256) for _ in range(rng.randrange(20000, 60000)))
+               for sid in range(len(exts))}
+    pos = {sid: 0 for sid in streams}
+    seq = {sid: 0 for sid in streams}
+    header = gps_log_recover.HEADER.pack(gps_log_recover.GLC_MAGIC, 1, 64, gps_log_recover.CHUNK.size,
+                                         len(exts), 0)
+    header += b"".join(gps_log_recover.STREAM.pack(sid, ext.encode()) for sid, ext in enumerate(exts))
+    glc = bytearray(header.ljust(64, b"\0"))
+    chunks = []                                 # (sid, seq, offset in glc, offset in stream, length)
+    while any(pos[sid] < len(data) for sid, data in streams.items()):
+        sid = rng.choice([s for s in streams if pos[s] < len(streams[s])])
+        n = rng.randrange(1, 4096 - gps_log_recover.CHUNK.size)
+        payload = streams[sid][pos[sid]:pos[sid] + n]
+        chunks.append((sid, seq[sid], len(glc), pos[sid], len(payload)))
+        glc += glc_chunk(sid, seq[sid], payload)
+        pos[sid] += len(payload)
+        seq[sid] += 1
+    errors = 0
+    path = os.path.join(tmp, "rt.glc")
+    with open(path, "wb") as f:
+        f.write(glc)
+
+    # gps_log_split.py, intact container with a zero filled preallocated tail
+    with open(path, "ab") as f:
+        f.write(bytes(8192))
+    out = os.path.join(tmp, "split")
+    os.makedirs(out)
+    with open(os.devnull, "w") as null:
+        stdout, sys.stdout = sys.stdout, null
+        try:
+            gps_log_split.split(path, out)
+        finally:
+            sys.stdout = stdout
+    for sid, ext in enumerate(exts):
+        with open(os.path.join(out, f"rt.{ext}"), "rb") as f:
+            errors += f.read() != streams[sid]
+
+    # gps_log_recover.py: one flipped payload byte and a torn last chunk
+    bad_sid, bad_seq, at, src, n = chunks[len(chunks) // 2]
+    damaged = bytearray(glc)
+    damaged[at + gps_log_recover.CHUNK.size + n // 2] ^= 0x5A
+    last = chunks[-1]
+    damaged = damaged[:last[2] + gps_log_recover.CHUNK.size + last[4] // 2] + bytes(4096)
+    parsed = {sid: gps_log_recover.Stream(ext) for sid, ext in enumerate(exts)}
+    regions, _ = gps_log_recover.recover(bytes(damaged), parsed, 64, None)
+    for sid in streams:
+        expect = b"".join(streams[c[0]][c[3]:c[3] + c[4]] for c in chunks
+                          if c[0] == sid and c[2] != at and c is not last)
+        errors += b"".join(parsed[sid].parts) != expect
+    errors += parsed[bad_sid].lost != 1 or regions != 2
+
+    # GPS_LOG_CHUNKED: one stream per file, its chunks without the container header
+    data = streams[3]
+    single_file = bytearray()
+    offsets = []
+    p = s = 0
+    while p < len(data):
+        n = rng.randrange(1, 512)
+        offsets.append((len(single_file), p, min(n, len(data) - p)))
+        single_file += glc_chunk(0, s, data[p:p + n])
+        p += n
+        s += 1
+    cut = offsets[len(offsets) // 3]
+    single_file[cut[0] + gps_log_recover.CHUNK.size] ^= 0x01
+    stream = gps_log_recover.Stream("gpy")
+    gps_log_recover.recover(bytes(single_file), {0: stream}, 0, stream)
+    expect = b"".join(data[o[1]:o[1] + o[2]] for o in offsets if o is not cut)
+    errors += b"".join(stream.parts) != expect or stream.lost != 1
+    return result("glc", f"{len(exts)} streams in {len(chunks)} chunks, 1 corrupted chunk, torn tail", errors)
+
+
+def check_ubz(rng, tmp, bindir):
+    encoder = tool(bindir, "ubz_compress")
+    if not encoder:
+        print("ubz: skipped, ubz_compress not built")
+        return 0
+    raw = ubx_log(track(rng, 1718000000000, 6000))
+    # Non PVT noise between the epochs, a partial message at the end
+    raw = raw[:40000] + bytes(rng.randrange(256) for _ in range(3000)) + raw[40000:] + raw[:57]
+    src = os.path.join(tmp, "rt.ubx")
+    with open(src, "wb") as f:
+        f.write(raw)
+    errors = 0
+    sizes = []
+    for block in (512, 4080, 4096, 65535):
+        dst = os.path.join(tmp, f"rt{block}.ubz")
+        run(encoder, "-b", str(block), src, dst)
+        with open(dst, "rb") as f:
+            coded = f.read()
+        out, _, bad = ubz_decompress.decompress(coded)
+        errors += bytes(out) != raw or bad != 0
+        sizes.append(f"{block} B {len(raw) / len(coded):.2f}x")
+    return result("ubz", f"{len(raw)} bytes, blocks {', '.join(sizes)}", errors)
+
+
+def expect_gpy(epochs):
+    """Points as the v1 encoder stores them: a full frame after every header and delta overflow."""
+    points = []
+    ref = None
+    for e in epochs:
+        full = ref is None or any(abs(d) > 30000 for d in (
+            e["utc_ms"] - ref["utc_ms"], e["gspeed"] - ref["gspeed"], e["sacc"] - ref["sacc"],
+            e["lat"] - ref["lat"], e["lon"] - ref["lon"], e["heading"] // 1000 - ref["heading"] // 1000))
+        if full:
+            ref = e
+        points.append({"unix_time_ms": e["utc_ms"], "latitude": e["lat"], "longitude": e["lon"],
+                       "speed_mm_s": e["gspeed"], "speed_error": e["sacc"],
+                       "cog": e["heading"] if full else e["heading"] // 1000 * 1000,
+                       "hdop": e["hdop"], "sat": e["num_sv"], "fix": e["fix_type"]})
+    return points
+
+
+def check_gpy(rng, tmp, bindir):
+    transcode = tool(bindir, "gps_log_transcode")
+    if not transcode:
+        print("gpy: skipped, gps_log_transcode not built")
+        return 0
+    # The second session continues where the first stopped, its first frame
+    # would fit as a delta: only the restart at the header makes it a full frame
+    first = track(rng, 1718000000000, 1500)
+    second = [dict(e, utc_ms=e["utc_ms"] + 1500 * 50) for e in track(random.Random(rng.random()),
+                                                                     1718000000000, 1500)]
+    second[0].update(lat=first[-1]["lat"] + 10, lon=first[-1]["lon"] - 10)
+    joined = bytearray()
+    errors = 0
+    for n, session in enumerate((first, second)):
+        src = os.path.join(tmp, f"s{n}.ubx")
+        with open(src, "wb") as f:
+            f.write(ubx_log(session))
+        run(transcode, "-t", "gpy", "-j", "1", "-o", tmp, src)
+        with open(os.path.join(tmp, f"s{n}.gpy"), "rb") as f:
+            gpy = f.read()
+        errors += gpy[GPY_HEADER_SIZE] != GPY_FULL_ID
+        joined += gpy
+    path = os.path.join(tmp, "joined.gpy")
+    with open(path, "wb") as f:
+        f.write(joined)
+    expect = expect_gpy(first) + expect_gpy(second)
+    decoded = list(gpy_decode.decode(bytes(joined)))
+    errors += len(decoded) != len(expect) or sum(a != b for a, b in zip(decoded, expect))
+
+    # The C reader, through a GPY -> OAO transcode that keeps every field
+    os.makedirs(os.path.join(tmp, "oao"))
+    run(transcode, "-t", "oao", "-j", "1", "-o", os.path.join(tmp, "oao"), path)
+    with open(os.path.join(tmp, "oao", "joined.oao"), "rb") as f:
+        oao = f.read()[OAO_HEADER_LENGTH:]
+    c_points = []
+    for p in range(0, len(oao) - OAO_FRAME.size + 1, OAO_FRAME.size):
+        (_, _, _, lat, lon, _, speed, heading, utc, fix, sat, sacc, _, _, _, hdop) = OAO_FRAME.unpack_from(oao, p)
+        c_points.append({"unix_time_ms": utc, "latitude": lat, "longitude": lon, "speed_mm_s": speed,
+                         "speed_error": sacc, "cog": heading, "hdop": hdop, "sat": sat, "fix": fix})
+    errors += len(c_points) != len(expect) or sum(a != b for a, b in zip(c_points, expect))
+    return result("gpy", f"2 v1 sessions in one file, {len(expect)} frames, gpy_decode.py and C reader", errors)
+
+
+GPX_TRKPT = re.compile(r'<trkpt lat="(-?\d+)\.(\d{7})" lon="(-?\d+)\.(\d{7})"><ele>-?\d+</ele>'
+                       r"<time>(\d{4})-(\d\d)-(\d\d)T(\d\d):(\d\d):(\d\d)(?:\.(\d{3}))?Z</time>")
+
+
+def gpx_coordinate(whole, fraction):
+    value = int(whole.lstrip("-")) * 10000000 + int(fraction)
+    return -value if whole.startswith("-") else value
+
+
+def check_gpx(rng, tmp, bindir):
+    transcode = tool(bindir, "gps_log_transcode")
+    if not transcode:
+        print("gpx: skipped, gps_log_transcode not built")
+        return 0
+    # 20 Hz off the 50 ms grid, a 25 Hz stretch and dropped epochs
+    epochs = track(rng, 1718000000013, 1200, drop=0.1) \
+        + track(rng, 1718000000013 + 1200 * 50, 600, step_ms=40, drop=0.1)
+    for i in range(1, len(epochs)):
+        epochs[i]["utc_ms"] = max(epochs[i]["utc_ms"], epochs[i - 1]["utc_ms"] + 1)
+    src = os.path.join(tmp, "track.ubx")
+    with open(src, "wb") as f:
+        f.write(ubx_log(epochs))
+    errors = 0
+    counts = []
+    for hz in (0, 1, 2, 5, 10, 20):
+        out = os.path.join(tmp, f"gpx{hz}")
+        os.makedirs(out)
+        run(transcode, "-t", "gpx", "-r", str(hz), "-j", "1", "-o", out, src)
+        with open(os.path.join(out, "track.gpx")) as f:
+            points = GPX_TRKPT.findall(f.read())
+        expect = []
+        last_slot = None
+        for e in epochs:
+            slot = e["utc_ms"] // 1000 * hz + e["utc_ms"] % 1000 * hz // 1000 if hz else None
+            if hz and slot == last_slot:
+                continue
+            last_slot = slot
+            expect.append(e)
+        got = []
+        for lat_w, lat_f, lon_w, lon_f, *clock in points:
+            year, month, day, hour, minute, second = (int(x) for x in clock[:6])
+            millis = int(clock[6]) if clock[6] else 0
+            y = year - (month <= 2)
+            era = y // 400
+            yoe = y - era * 400
+            doy = (153 * (month + (-3 if month > 2 else 9)) + 2) // 5 + day - 1
+            days = era * 146097 + yoe * 365 + yoe // 4 - yoe // 100 + doy - 719468
+            utc_ms = ((days * 24 + hour) * 60 + minute) * 60000 + second * 1000 + millis
+            got.append((utc_ms, gpx_coordinate(lat_w, lat_f), gpx_coordinate(lon_w, lon_f)))
+        want = [(e["utc_ms"], e["lat"], e["lon"]) for e in expect]
+        errors += len(got) != len(want) or sum(a != b for a, b in zip(got, want))
+        counts.append(f"{hz or 'all'} Hz {len(got)}")
+    return result("gpx", f"{len(epochs)} epochs, points at {', '.join(counts)}", errors)
+
+
+CHECKS = {"glc": check_glc, "ubz": check_ubz, "gpy": check_gpy, "gpx": check_gpx}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("checks", nargs="*", help=f"default all of {', '.join(CHECKS)}")
+    parser.add_argument("-b", "--bindir", default=os.path.dirname(os.path.abspath(__file__)),
+                        help="directory of ubz_compress and gps_log_transcode, default next to this script")
+    parser.add_argument("-s", "--seed", type=int, default=1)
+    args = parser.parse_args()
+    unknown = set(args.checks) - set(CHECKS)
+    if unknown:
+        parser.error(f"unknown check {', '.join(sorted(unknown))}")
+    errors = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        for name in args.checks or CHECKS:
+            os.makedirs(os.path.join(tmp, name))
+            errors += CHECKS[name](random.Random(f"{args.seed}{name}"), os.path.join(tmp, name), args.bindir)
+    return 1 if errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,117 @@
+/*
+ * Scan UBX, GPY, SBP and OAO logs with include/gps_log_reader.h: counts frames,
+ * checksum failures (skipped bytes) and the scan throughput of the mapped file.
+ *
+ * build: cc -O2 -Wall -I../include -o gps_log_scan gps_log_scan.c
+ * usage: gps_log_scan [-n repeat] LOG.ubx|LOG.gpy|LOG.sbp|LOG.oao ...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gps_log_reader.h"
+
+typedef struct {
+    size_t frames;
+    size_t skipped;
+    int64_t check;           // sum of a decoded field, keeps the decode from being optimized out
+} scan_result_t;
+
+static scan_result_t scan_ubx(const uint8_t *data, size_t size) {
+    scan_result_t res = {0};
+    gps_log_reader_t r;
+    gps_log_ubx_msg_t msg;
+    gps_log_reader_init(&r, data, size);
+    while (gps_log_ubx_next(&r, &msg)) {
+        res.frames++;
+        if (msg.cls == GPS_LOG_UBX_CLASS_NAV && msg.id == GPS_LOG_UBX_ID_NAV_PVT
+            && msg.len >= sizeof(gps_log_ubx_nav_pvt_t)) {
+            res.check += ((const gps_log_ubx_nav_pvt_t *)msg.payload)->gSpeed;
+        }
+    }
+    res.skipped = r.skipped;
+    return res;
+}
+
+static scan_result_t scan_gpy(const uint8_t *data, size_t size) {
+    scan_result_t res = {0};
+    gps_log_gpy_reader_t g;
+    gps_log_gpy_point_t pt;
+    gps_log_gpy_open(&g, data, size);
+    while (gps_log_gpy_next(&g, &pt)) {
+        res.frames++;
+        res.check += pt.speed;
+    }
+    res.skipped = g.r.skipped;
+    return res;
+}
+
+static scan_result_t scan_sbp(const uint8_t *data, size_t size) {
+    scan_result_t res = {0};
+    gps_log_reader_t r;
+    const struct SBP_frame *f;
+    gps_log_sbp_open(&r, data, size);
+    while ((f = gps_log_sbp_next(&r)) != NULL) {
+        res.frames++;
+        res.check += f->Sog;
+    }
+    return res;
+}
+
+static scan_result_t scan_oao(const uint8_t *data, size_t size) {
+    scan_result_t res = {0};
+    gps_log_reader_t r;
+    const union OAO_Frame *f;
+    gps_log_reader_init(&r, data, size);
+    while ((f = gps_log_oao_next(&r)) != NULL) {
+        res.frames++;
+        res.check += f->speed;
+    }
+    res.skipped = r.skipped;
+    return res;
+}
+
+int main(int argc, char **argv) {
+    int repeat = 1, first = 1;
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        repeat = atoi(argv[2]);
+        first = 3;
+    }
+    if (first >= argc || repeat < 1) {
+        fprintf(stderr, "usage: %s [-n repeat] LOG.ubx|LOG.gpy|LOG.sbp|LOG.oao ...\n", argv[0]);
+        return 2;
+    }
+    for (int i = first; i < argc; i++) {
+        const char *ext = strrchr(argv[i], '.');
+        scan_result_t (*scan)(const uint8_t *, size_t) =
+            !ext                      ? NULL
+            : strcmp(ext, ".ubx") == 0 ? scan_ubx
+            : strcmp(ext, ".gpy") == 0 ? scan_gpy
+            : strcmp(ext, ".sbp") == 0 ? scan_sbp
+            : strcmp(ext, ".oao") == 0 ? scan_oao
+                                       : NULL;
+        if (!scan) {
+            fprintf(stderr, "%s: unknown format\n", argv[i]);
+            continue;
+        }
+        size_t size = 0;
+        const uint8_t *data = gps_log_map(argv[i], &size);
+        if (!data) {
+            fprintf(stderr, "%s: cannot map\n", argv[i]);
+            continue;
+        }
+        scan_result_t res = {0};
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (int n = 0; n < repeat; n++) {
+            res = scan(data, size);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        double s = (double)(t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+        printf("%s: %zu frames, %zu bytes skipped, %.1f MB/s (check %lld)\n", argv[i], res.frames,
+               res.skipped, s > 0 ? (double)size * repeat / s / 1e6 : 0.0, (long long)res.check);
+        gps_log_unmap(data, size);
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""Split a GPS log container (.glc) into its per-format log files.
+
+Layout: include/gps_log_container.h. The header lists the streams, each chunk
+carries the stream id, a per-stream sequence number and the payload length.
+Payloads of a stream are appended in file order to <name>.<ext>.
+
+usage: gps_log_split.py LOG.glc [-o OUTDIR]
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+GLC_MAGIC = b"GPSLOGC1"
+GLC_CHUNK_MAGIC = 0x4347
+HEADER = struct.Struct("<8sHHHBB")          # magic, version, header_size, chunk_header_size, count, reserved
+STREAM = struct.Struct("<B3s")
+CHUNK = struct.Struct("<HBBIII")            # magic, stream, flags, seq, len, crc
+
+
+def split(path, outdir):
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, version, header_size, chunk_size, count, _ = HEADER.unpack_from(data, 0)
+    if magic != GLC_MAGIC:
+        raise ValueError(f"{path}: not a GPS log container")
+    streams = {}
+    for i in range(count):
+        sid, ext = STREAM.unpack_from(data, HEADER.size + i * STREAM.size)
+        streams[sid] = ext.decode("ascii")
+    base = os.path.splitext(os.path.basename(path))[0]
+    outputs = {sid: bytearray() for sid in streams}
+    next_seq = {sid: 0 for sid in streams}
+    pos = header_size
+    while pos + chunk_size <= len(data):
+        cmagic, sid, _flags, seq, length, _crc = CHUNK.unpack_from(data, pos)
+        if cmagic != GLC_CHUNK_MAGIC:
+            if not any(data[pos:pos + chunk_size]):
+                break  # zero filled preallocated tail after a power cut
+            print(f"bad chunk at {pos}, stopping", file=sys.stderr)
+            break
+        payload = data[pos + chunk_size:pos + chunk_size + length]
+        if len(payload) < length:
+            print(f"truncated chunk at {pos}", file=sys.stderr)
+        if sid in outputs:
+            if seq != next_seq[sid]:
+                print(f"{streams[sid]}: chunk {seq} where {next_seq[sid]} expected", file=sys.stderr)
+            next_seq[sid] = seq + 1
+            outputs[sid] += payload
+        pos += chunk_size + length
+    for sid, out in outputs.items():
+        name = os.path.join(outdir, f"{base}.{streams[sid]}")
+        with open(name, "wb") as f:
+            f.write(out)
+        print(f"{name}: {len(out)} bytes, {next_seq[sid]} chunks")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("container")
+    parser.add_argument("-o", "--outdir", default=".")
+    args = parser.parse_args()
+    split(args.container, args.outdir)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,425 @@
+/*
+ * Convert UBX, GPY, SBP and OAO logs to GPY (v1 or v2), SBP, OAO or GPX with the
+ * device frame encoders (gps_log_encode.c). Inputs are decoded from a mapped file
+ * with include/gps_log_reader.h, outputs written through a stdio buffer, so memory
+ * use does not grow with the file size. Files are converted in parallel, one per
+ * worker thread.
+ *
+ * Fields a source format does not carry are left 0 (e.g. height from GPY).
+ * Headers name the transcoder instead of a device, the OAO bests stay empty.
+ *
+ * build: cc -O2 -Wall -pthread -I../include -o gps_log_transcode gps_log_transcode.c ../gps_log_encode.c
+ * usage: gps_log_transcode -t gpy|gpy2|sbp|oao|gpx [-r GPX_HZ] [-j JOBS] [-o DIR] LOG ...
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gps_log_encode.h"
+#include "gps_log_reader.h"
+
+#define TRANSCODE_NAME "transcode"
+
+typedef enum { OUT_GPY, OUT_GPY2, OUT_SBP, OUT_OAO, OUT_GPX } out_format_t;
+
+static const char *const out_ext[] = {"gpy", "gpy", "sbp", "oao", "gpx"};
+
+static struct {
+    out_format_t format;
+    unsigned gpx_hz;          // 0 = every epoch
+    const char *dir;
+    char **files;
+    int count;
+    int next;                 // next file to convert, atomic
+    int failed;
+    pthread_mutex_t print;
+} job;
+
+// ============================================================================
+// TIME
+// ============================================================================
+
+static int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+/** @brief Fill the UTC fields of an epoch from utc_ms */
+static void epoch_set_utc_ms(gps_log_epoch_t *e, int64_t utc_ms) {
+    int64_t days = utc_ms >= 0 ? utc_ms / 86400000 : (utc_ms - 86399999) / 86400000;
+    int64_t ms = utc_ms - days * 86400000;
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned doe = (unsigned)(days - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    e->utc_ms = utc_ms;
+    e->year = (uint16_t)(yoe + era * 400 + (m <= 2));
+    e->month = (uint8_t)m;
+    e->day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+    e->hour = (uint8_t)(ms / 3600000);
+    e->minute = (uint8_t)(ms / 60000 % 60);
+    e->second = (uint8_t)(ms / 1000 % 60);
+    e->millis = (uint16_t)(ms % 1000);
+}
+
+// ============================================================================
+// OUTPUT
+// ============================================================================
+
+typedef struct {
+    FILE *f;
+    gps_log_gpy_enc_t gpy;
+    gps_log_oao_enc_t oao;
+    int64_t last_ms;          // OAO distance integration
+    uint64_t distance_mm;
+    int64_t rate_slot;        // GPX rate slot of the last point, -1 none
+    uint8_t frame[GPX_TRKPT_MAX_LEN];
+} out_t;
+
+/** @brief First epoch in each 1/hz s slot of the UTC second, log_rate_due() of the device */
+static bool out_rate_due(out_t *o, const gps_log_epoch_t *e, unsigned hz) {
+    if (hz == 0 || e->utc_ms <= 0)
+        return true;
+    int64_t slot = e->utc_ms / 1000 * hz + e->utc_ms % 1000 * hz / 1000;
+    if (slot == o->rate_slot)
+        return false;
+    o->rate_slot = slot;
+    return true;
+}
+
+static void out_header(out_t *o) {
+    o->rate_slot = -1;
+    if (job.format == OUT_GPY || job.format == OUT_GPY2) {
+        struct GPY_Header h;
+        memset(&h, 0, sizeof(h));
+        h.Type_identifier = 0xF0;
+        h.Flags = job.format == OUT_GPY2 ? GPY_HEADER_FLAG_V2 : 0;
+        h.Length = sizeof(h);
+        h.DeviceType = 2;
+        strcpy(h.deviceDescription, "ESP-GPS");
+        strcpy(h.deviceName, "ESP-GPS");
+        strcpy(h.serialNumber, "000000000000");
+        strcpy(h.firmwareVersion, TRANSCODE_NAME);
+        Fletcher16((uint8_t *)&h, sizeof(h));
+        fwrite(&h, sizeof(h), 1, o->f);
+        gps_log_gpy_enc_init(&o->gpy, 20);
+    } else if (job.format == OUT_SBP) {
+        struct SBP_Header h;
+        memset(&h, 0xFF, sizeof(h));
+        int n = snprintf(h.Identity, sizeof(h.Identity), "ESP-GPS,00000000,0," TRANSCODE_NAME);
+        h.Text_length = h.Again_length = (uint16_t)n;
+        h.Id1 = 0xa0;
+        h.Id2 = 0xa2;
+        h.Start = 0xfd;
+        memset(h.Identity + n, 0xFF, sizeof(h.Identity) - n);  // over the terminator
+        fwrite(&h, sizeof(h), 1, o->f);
+    } else if (job.format == OUT_OAO) {
+        union OAO_Header h;
+        memset(&h, 0, sizeof(h));
+        h.mode = OAO_MODE_HEADER;
+        gps_log_oao_checksum(OAO_HEADER_LENGTH, h.bytes);
+        fwrite(h.bytes, OAO_HEADER_LENGTH, 1, o->f);  // filled at the end
+    } else {
+        fputs("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n"
+              "<gpx version=\"1.0\" creator=\"ESP-GPS SW " TRANSCODE_NAME "\"\n"
+              "xmlns=\"http://www.topografix.com/GPX/1/0\"\n"
+              "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\"\n"
+              "xsi:schemaLocation=\"http://www.topografix.com/GPX/1/0 "
+              "http://www.topografix.com/GPX/1/0/gpx.xsd\">\n"
+              "<trk>\n<trkseg>\n", o->f);
+    }
+}
+
+static void out_epoch(out_t *o, const gps_log_epoch_t *e) {
+    size_t len;
+    const uint8_t *block;
+    switch (job.format) {
+        case OUT_GPY:
+            len = gps_log_enc_gpy(&o->gpy, e, false, o->frame);
+            fwrite(o->frame, len, 1, o->f);
+            break;
+        case OUT_GPY2:
+            if (gps_log_gpy_block_full(&o->gpy) && (len = gps_log_gpy_block_flush(&o->gpy, &block)) > 0)
+                fwrite(block, len, 1, o->f);
+            gps_log_enc_gpy_v2(&o->gpy, e);
+            break;
+        case OUT_SBP:
+            gps_log_enc_sbp((struct SBP_frame *)o->frame, e);
+            fwrite(o->frame, sizeof(struct SBP_frame), 1, o->f);
+            break;
+        case OUT_OAO:
+            if (e->fix_type >= 2 && o->last_ms && e->utc_ms > o->last_ms)
+                o->distance_mm += (uint64_t)(e->gspeed < 0 ? -e->gspeed : e->gspeed) * (uint64_t)(e->utc_ms - o->last_ms) / 1000U;
+            o->last_ms = e->fix_type >= 2 ? e->utc_ms : 0;
+            gps_log_enc_oao(&o->oao, e, (union OAO_Frame *)o->frame);
+            fwrite(o->frame, OAO_GNSS_FRAME_LENGTH, 1, o->f);
+            break;
+        case OUT_GPX:
+            // Points on the rate grid of the device
+            if (!out_rate_due(o, e, job.gpx_hz))
+                break;
+            len = gps_log_enc_gpx((char *)o->frame, e, job.gpx_hz != 1 || e->millis != 0);
+            fwrite(o->frame, len, 1, o->f);
+            break;
+    }
+}
+
+static void out_footer(out_t *o) {
+    const uint8_t *block;
+    size_t len;
+    if (job.format == OUT_GPY2 && (len = gps_log_gpy_block_flush(&o->gpy, &block)) > 0) {
+        fwrite(block, len, 1, o->f);
+    } else if (job.format == OUT_OAO && o->oao.frames) {
+        union OAO_Header h;
+        gps_log_enc_oao_header(&o->oao, (uint32_t)(o->distance_mm / 1000U), &h);
+        gps_log_oao_checksum(OAO_HEADER_LENGTH, h.bytes);
+        fseek(o->f, 0, SEEK_SET);
+        fwrite(h.bytes, OAO_HEADER_LENGTH, 1, o->f);
+    } else if (job.format == OUT_GPX) {
+        fputs("</trkseg>\n</trk>\n</gpx>\n", o->f);
+    }
+}
+
+// ============================================================================
+// INPUT
+// ============================================================================
+
+static size_t in_ubx(const uint8_t *data, size_t size, out_t *o) {
+    gps_log_reader_t r;
+    gps_log_ubx_msg_t msg;
+    gps_log_epoch_t e;
+    bool pending = false;
+    uint16_t hdop = 0;
+    size_t n = 0;
+    gps_log_reader_init(&r, data, size);
+    while (gps_log_ubx_next(&r, &msg)) {
+        if (msg.cls != GPS_LOG_UBX_CLASS_NAV)
+            continue;
+        if (msg.id == GPS_LOG_UBX_ID_NAV_DOP && msg.len >= sizeof(gps_log_ubx_nav_dop_t)) {
+            hdop = ((const gps_log_ubx_nav_dop_t *)msg.payload)->hDOP;  // follows its NAV-PVT
+            e.hdop = hdop;
+        } else if (msg.id == GPS_LOG_UBX_ID_NAV_PVT && msg.len >= sizeof(gps_log_ubx_nav_pvt_t)) {
+            if (pending) {
+                out_epoch(o, &e);
+                n++;
+            }
+            gps_log_ubx_nav_pvt_t pvt;
+            memcpy(&pvt, msg.payload, sizeof(pvt));
+            int64_t day = days_from_civil(pvt.year, pvt.month, pvt.day);
+            int64_t ms = (pvt.nano + (pvt.nano >= 0 ? 500000 : -500000)) / 1000000;  // rounded
+            memset(&e, 0, sizeof(e));
+            epoch_set_utc_ms(&e, ((day * 24 + pvt.hour) * 60 + pvt.minute) * 60000 + pvt.second * 1000 + ms);
+            e.lat = pvt.lat;
+            e.lon = pvt.lon;
+            e.hmsl = pvt.hMSL;
+            e.gspeed = pvt.gSpeed;
+            e.vel_d = pvt.velD;
+            e.heading = pvt.headMot;
+            e.sacc = pvt.sAcc;
+            e.hacc = pvt.hAcc;
+            e.vacc = pvt.vAcc;
+            e.heading_acc = pvt.headAcc;
+            e.hdop = hdop;
+            e.num_sv = pvt.numSV;
+            e.fix_type = pvt.fixType;
+            pending = true;
+        }
+    }
+    if (pending) {
+        out_epoch(o, &e);
+        n++;
+    }
+    return n;
+}
+
+static size_t in_gpy(const uint8_t *data, size_t size, out_t *o) {
+    gps_log_gpy_reader_t g;
+    gps_log_gpy_point_t pt;
+    gps_log_epoch_t e;
+    size_t n = 0;
+    gps_log_gpy_open(&g, data, size);
+    while (gps_log_gpy_next(&g, &pt)) {
+        memset(&e, 0, sizeof(e));
+        epoch_set_utc_ms(&e, pt.unix_time);
+        e.lat = pt.latitude;
+        e.lon = pt.longitude;
+        e.gspeed = (int32_t)pt.speed;
+        e.heading = pt.cog;
+        e.sacc = pt.speed_error;
+        e.hdop = pt.hdop;
+        e.num_sv = pt.sat;
+        e.fix_type = pt.fix;
+        out_epoch(o, &e);
+        n++;
+    }
+    return n;
+}
+
+static size_t in_sbp(const uint8_t *data, size_t size, out_t *o) {
+    gps_log_reader_t r;
+    const struct SBP_frame *f;
+    gps_log_epoch_t e;
+    size_t n = 0;
+    gps_log_sbp_open(&r, data, size);
+    while ((f = gps_log_sbp_next(&r)) != NULL) {
+        uint32_t packed = f->date_time_UTC_packed;
+        uint32_t months = packed >> 22;  // (year - 2000) * 12 + month
+        int64_t day = days_from_civil(2000 + (months - 1) / 12, (months - 1) % 12 + 1, (packed >> 17) & 0x1F);
+        memset(&e, 0, sizeof(e));
+        epoch_set_utc_ms(&e, ((day * 24 + ((packed >> 12) & 0x1F)) * 60 + ((packed >> 6) & 0x3F)) * 60000
+                                 + f->UtcSec);
+        e.lat = f->Lat;
+        e.lon = f->Lon;
+        e.hmsl = f->AltCM * 10;
+        e.gspeed = f->Sog * 10;
+        e.vel_d = -f->ClmbRte * 10;
+        e.heading = f->Cog * 1000;
+        e.sacc = f->sdop * 10U;
+        e.vacc = f->vsdop * 10U;
+        e.hdop = (uint16_t)(f->HDOP * 20U);
+        e.num_sv = f->SVIDCnt;
+        e.fix_type = f->SVIDCnt ? 3 : 0;  // SBP has no fix type
+        out_epoch(o, &e);
+        n++;
+    }
+    return n;
+}
+
+static size_t in_oao(const uint8_t *data, size_t size, out_t *o) {
+    gps_log_reader_t r;
+    const union OAO_Frame *f;
+    gps_log_epoch_t e;
+    size_t n = 0;
+    gps_log_reader_init(&r, data, size);
+    while ((f = gps_log_oao_next(&r)) != NULL) {
+        if (f->mode != OAO_MODE_GNSS_ALIGNED && f->mode != OAO_MODE_GNSS_UNALIGNED)
+            continue;
+        memset(&e, 0, sizeof(e));
+        epoch_set_utc_ms(&e, (int64_t)f->utc_gnss);
+        e.lat = f->latitude;
+        e.lon = f->longitude;
+        e.hmsl = f->altitude;
+        e.gspeed = (int32_t)f->speed;
+        e.heading = (int32_t)f->heading;
+        e.sacc = f->accuracy_speed;
+        e.hacc = f->accuracy_horizontal;
+        e.vacc = f->accuracy_vertical;
+        e.heading_acc = f->accuracy_heading;
+        e.hdop = f->accuracy_hDOP;
+        e.num_sv = f->satellites;
+        e.fix_type = f->fix;
+        out_epoch(o, &e);
+        n++;
+    }
+    return n;
+}
+
+// ============================================================================
+// JOBS
+// ============================================================================
+
+static int transcode(const char *path) {
+    const char *ext = strrchr(path, '.');
+    size_t (*in)(const uint8_t *, size_t, out_t *) =
+        !ext                       ? NULL
+        : strcmp(ext, ".ubx") == 0 ? in_ubx
+        : strcmp(ext, ".gpy") == 0 ? in_gpy
+        : strcmp(ext, ".sbp") == 0 ? in_sbp
+        : strcmp(ext, ".oao") == 0 ? in_oao
+                                   : NULL;
+    if (!in) {
+        fprintf(stderr, "%s: unknown format\n", path);
+        return -1;
+    }
+    char name[4096];
+    const char *base = strrchr(path, '/');
+    base = base && job.dir ? base + 1 : path;
+    snprintf(name, sizeof(name), "%s%s%.*s.%s", job.dir ? job.dir : "", job.dir ? "/" : "",
+             (int)(strrchr(base, '.') - base), base, out_ext[job.format]);
+    if (strcmp(name, path) == 0) {
+        fprintf(stderr, "%s: output would overwrite the input, use -o\n", path);
+        return -1;
+    }
+    size_t size = 0;
+    const uint8_t *data = gps_log_map(path, &size);
+    if (!data) {
+        fprintf(stderr, "%s: cannot map\n", path);
+        return -1;
+    }
+    out_t *o = calloc(1, sizeof(*o));
+    o->f = o ? fopen(name, "wb") : NULL;
+    if (!o || !o->f) {
+        fprintf(stderr, "%s: cannot create\n", name);
+        free(o);
+        gps_log_unmap(data, size);
+        return -1;
+    }
+    setvbuf(o->f, NULL, _IOFBF, 1 << 16);
+    out_header(o);
+    size_t epochs = in(data, size, o);
+    out_footer(o);
+    int err = ferror(o->f) | fclose(o->f);
+    gps_log_unmap(data, size);
+    free(o);
+    pthread_mutex_lock(&job.print);
+    printf("%s -> %s: %zu epochs%s\n", path, name, epochs, err ? ", write error" : "");
+    pthread_mutex_unlock(&job.print);
+    return err ? -1 : 0;
+}
+
+static void *worker(void *arg) {
+    (void)arg;
+    int i;
+    while ((i = __atomic_fetch_add(&job.next, 1, __ATOMIC_RELAXED)) < job.count) {
+        if (transcode(job.files[i]) != 0)
+            __atomic_fetch_add(&job.failed, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    static const char *const names[] = {"gpy", "gpy2", "sbp", "oao", "gpx"};
+    int jobs = 4, format = -1, i;
+    job.gpx_hz = 1;
+    pthread_mutex_init(&job.print, NULL);
+    for (i = 1; i < argc && argv[i][0] == '-'; i += 2) {
+        if (i + 1 >= argc)
+            break;
+        if (strcmp(argv[i], "-t") == 0) {
+            for (int f = 0; f < 5; f++)
+                if (strcmp(argv[i + 1], names[f]) == 0)
+                    format = f;
+        } else if (strcmp(argv[i], "-r") == 0) {
+            job.gpx_hz = (unsigned)atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-j") == 0) {
+            jobs = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-o") == 0) {
+            job.dir = argv[i + 1];
+        } else {
+            break;
+        }
+    }
+    if (format < 0 || i >= argc || jobs < 1 || job.gpx_hz > 50) {
+        fprintf(stderr, "usage: %s -t gpy|gpy2|sbp|oao|gpx [-r GPX_HZ] [-j JOBS] [-o DIR] LOG ...\n", argv[0]);
+        return 2;
+    }
+    job.format = (out_format_t)format;
+    job.files = argv + i;
+    job.count = argc - i;
+    if (jobs > job.count)
+        jobs = job.count;
+    pthread_t threads[jobs];
+    for (i = 0; i < jobs; i++)
+        pthread_create(&threads[i], NULL, worker, NULL);
+    for (i = 0; i < jobs; i++)
+        pthread_join(threads[i], NULL);
+    return job.failed ? 1 : 0;
+}
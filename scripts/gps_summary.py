@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""Render a binary session summary (.sum, GPS_LOG_SUMMARY_BINARY) as text.
+
+Layout: include/gps_summary.h. The output follows the TXT results section,
+best runs first. Records with a bad crc are reported and skipped; a summary
+without a seal record is marked incomplete. A journal (GPS_LOG_SUMMARY_JOURNAL)
+holds one metric record per change, the last one wins; a seal written by
+recovery after a power loss is marked as such.
+
+usage: gps_summary.py LOG.sum [--unit kmh|kn|ms]
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+GPS_SUM_MAGIC = 0x4D555347
+FILE_HEADER = struct.Struct("<IHH")
+RECORD = struct.Struct("<BBH")
+SESSION = struct.Struct("<6sBbBBBBIII6sBB16s30s10s")
+RUN = struct.Struct("<BBBBfHH12s")
+METRIC_HEAD = struct.Struct("<BBH")
+SEAL = struct.Struct("<HHI")
+REC_SESSION, REC_METRIC, REC_SEAL = 1, 2, 3
+FLAG_RECOVERED = 0x01
+KIND_TIME, KIND_DIST, KIND_ALFA, KIND_MAX = 1, 2, 3, 4
+RUNS = 10
+
+# speed_unit setting of the logger -> (factor from mm/s, label)
+UNITS = {"ms": (0.001, "m/s"), "kmh": (0.0036, "km/h"), "kn": (0.001943844, "kn")}
+UNIT_BY_SETTING = {0: "ms", 1: "kmh", 2: "kn"}
+
+
+def read_records(data):
+    magic, _version, header_size = FILE_HEADER.unpack_from(data, 0)
+    if magic != GPS_SUM_MAGIC:
+        raise ValueError("not a session summary")
+    pos = header_size
+    while pos + RECORD.size <= len(data):
+        if struct.unpack_from("<I", data, pos)[0] == GPS_SUM_MAGIC:
+            pos += FILE_HEADER.unpack_from(data, pos)[2]  # repeated header of older firmware
+            continue
+        rtype, flags, length = RECORD.unpack_from(data, pos)
+        end = pos + RECORD.size + length
+        if end + 4 > len(data):
+            print(f"truncated record at {pos}", file=sys.stderr)
+            return
+        (crc,) = struct.unpack_from("<I", data, end)
+        if zlib.crc32(data[pos:end]) != crc:
+            print(f"bad crc at {pos}, skipping record", file=sys.stderr)
+        else:
+            yield rtype, flags, data[pos + RECORD.size:end]
+        pos = end + 4
+
+
+def parse_metric(payload):
+    kind, index, window = METRIC_HEAD.unpack_from(payload, 0)
+    runs = [RUN.unpack_from(payload, METRIC_HEAD.size + i * RUN.size) for i in range(RUNS)]
+    return kind, index, window, runs
+
+
+def render(data, unit):
+    session, metrics, sealed, recovered = None, {}, False, False
+    for rtype, flags, payload in read_records(data):
+        if rtype == REC_SESSION:
+            session = SESSION.unpack_from(payload, 0)
+        elif rtype == REC_METRIC:
+            kind, index, window, runs = parse_metric(payload)
+            metrics[(kind, index)] = (window, runs)  # later records replace earlier ones
+        elif rtype == REC_SEAL:
+            sealed = True
+            recovered = bool(flags & FLAG_RECOVERED)
+    lines = []
+    rate = 1
+    if session:
+        (mac, speed_unit, tz, rate, _nav, gnss, _sat, first_fix, total_time, total_dist,
+         ubx_id, _hw, _r, sw, ubx_sw, ubx_hw) = session
+        unit = unit or UNIT_BY_SETTING.get(speed_unit, "kmh")
+        text = lambda b: b.split(b"\0", 1)[0].decode(errors="replace")
+        lines += [f"MAC adress: {mac.hex(':')}", f"GPS Logger: {text(sw)}",
+                  f"First fix : {first_fix / 1000:.0f} s", f"Total time : {total_time / 1000:.0f} s",
+                  f"Total distance : {total_dist / 1000:.0f} m", f"Sample rate : {rate} Hz",
+                  f"Timezone : {tz} h", f"GNSS : {gnss}", f"Ublox SW-version : {text(ubx_sw)}",
+                  f"Ublox HW-version : {text(ubx_hw)}", f"Ublox ID = {ubx_id.hex()}"]
+    factor, label = UNITS[unit or "kmh"]
+    rate = rate or 1
+    status = " (recovered, session ended without close)" if recovered else ""
+    lines.append("\n*** Results ***" + (status if sealed else " (incomplete, no seal)"))
+    order = sorted(metrics, key=lambda k: (k[0] != KIND_MAX, k[1], k[0]))
+    for kind, index in order:
+        window, runs = metrics[(kind, index)]
+        if kind == KIND_MAX:
+            h, m, s, _, spd, nr, _, _ = runs[0]
+            lines.append(f"=== Max speed {spd * factor:.3f}{label} {h:02}:{m:02}:{s:02} Run: {nr} ===")
+            continue
+        tag = {KIND_TIME: "S", KIND_DIST: "M", KIND_ALFA: "A"}[kind]
+        avg = sum(r[4] for r in runs[5:]) / 5
+        lines.append(f"=== {tag}{window} avg_5: {avg * factor:.3f}{label}, best_runs ===")
+        for h, m, s, _, spd, nr, _, raw in reversed(runs[5:]):
+            line = f"{spd * factor:.3f}{label} {h:02}:{m:02}:{s:02} Run: {nr}"
+            if kind == KIND_TIME:
+                mean_cno, max_cno, min_cno, num_sat = struct.unpack_from("<HBBB", raw)
+                if mean_cno:
+                    line += f" CNO Max: {max_cno} Avg: {mean_cno} Min: {min_cno} nr Sat: {num_sat}"
+            else:
+                msg_nr, dist, extra = struct.unpack("<Iii", raw)
+                line += f" Distance: {dist / rate / 1000:.2f} Msg_nr: {msg_nr}"
+                line += f" Samples: {extra}" if kind == KIND_DIST else f" Straight: {extra ** 0.5:.2f}"
+            lines.append(line + f" {tag}{window}")
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("summary")
+    parser.add_argument("--unit", choices=sorted(UNITS), help="default: the logger setting")
+    args = parser.parse_args()
+    with open(args.summary, "rb") as f:
+        print(render(f.read(), args.unit))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+"""Decode a GPY log (v1 frames or GPS_LOG_GPY_V2 blocks) to CSV.
+
+Layout: include/gpy.h. The 72 byte header Flags tell v1 from v2. Frames or
+blocks with a bad Fletcher16 are reported and skipped, decoding resumes at
+the next valid one. COG is written in the 1e-5 deg unit of the v1 full frame;
+v2 and compressed v1 frames carry it in 0.01 deg.
+
+usage: gpy_decode.py LOG.gpy [-o OUT.csv]
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+HEADER_SIZE = 72
+HEADER_FLAG_V2 = 0x01
+FULL_ID, COMPRESSED_ID, BLOCK_ID = 0xE0, 0xD0, 0xC0
+FULL = struct.Struct("<BBHqIIiiiBBH")
+COMPRESSED = struct.Struct("<BBHhhhhhhBBH")
+BLOCK = struct.Struct("<BBH")
+MASK_HDOP, MASK_SAT, MASK_FIX = 0x01, 0x02, 0x04
+FIELDS = ["unix_time_ms", "latitude", "longitude", "speed_mm_s", "speed_error", "cog", "hdop", "sat", "fix"]
+
+
+def fletcher16(data):
+    """The GPY variant: sums modulo 256 over all bytes but the last two."""
+    sum1 = sum2 = 0
+    for b in data[:-2]:
+        sum1 = (sum1 + b) & 0xFF
+        sum2 = (sum2 + sum1) & 0xFF
+    return data[-2] == sum1 and data[-1] == sum2
+
+
+def varint(data, pos):
+    value = shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if b < 0x80:
+            return value, pos
+        shift += 7
+
+
+def svarint(data, pos):
+    v, pos = varint(data, pos)
+    return (v >> 1) ^ -(v & 1), pos
+
+
+def decode_block(payload, frames):
+    """Yield the frames of one v2 block as dicts."""
+    pos = 0
+    f = {}
+    for n in range(frames):
+        mask = payload[pos]
+        pos += 1
+        if n == 0:
+            f["unix_time_ms"], pos = svarint(payload, pos)
+            f["speed_mm_s"], pos = varint(payload, pos)
+            f["speed_error"], pos = varint(payload, pos)
+            f["latitude"], pos = svarint(payload, pos)
+            f["longitude"], pos = svarint(payload, pos)
+            cog, pos = svarint(payload, pos)
+            dt = dlat = dlon = 0
+        else:
+            r, pos = svarint(payload, pos)
+            t = f["unix_time_ms"] + dt + r
+            dt, f["unix_time_ms"] = t - f["unix_time_ms"], t
+            r, pos = svarint(payload, pos)
+            f["speed_mm_s"] += r
+            r, pos = svarint(payload, pos)
+            f["speed_error"] += r
+            r, pos = svarint(payload, pos)
+            v = f["latitude"] + dlat + r
+            dlat, f["latitude"] = v - f["latitude"], v
+            r, pos = svarint(payload, pos)
+            v = f["longitude"] + dlon + r
+            dlon, f["longitude"] = v - f["longitude"], v
+            r, pos = svarint(payload, pos)
+            cog += r
+        if mask & MASK_HDOP:
+            f["hdop"], pos = varint(payload, pos)
+        if mask & MASK_SAT:
+            f["sat"], pos = varint(payload, pos)
+        if mask & MASK_FIX:
+            f["fix"], pos = varint(payload, pos)
+        f["cog"] = cog * 1000
+        yield dict(f)
+    if pos != len(payload):
+        raise ValueError(f"block length mismatch ({pos} of {len(payload)} bytes used)")
+
+
+def decode_v2(data, pos):
+    while pos + BLOCK.size + 2 <= len(data):
+        ident, frames, length = BLOCK.unpack_from(data, pos)
+        end = pos + BLOCK.size + length + 2
+        if ident != BLOCK_ID or end > len(data) or not fletcher16(data[pos:end]):
+            print(f"bad block at {pos}, resyncing", file=sys.stderr)
+            pos = data.find(bytes([BLOCK_ID]), pos + 1)
+            if pos < 0:
+                return
+            continue
+        yield from decode_block(data[pos + BLOCK.size:end - 2], frames)
+        pos = end
+
+
+def decode_v1(data, pos):
+    ref = None
+    while pos < len(data):
+        ident = data[pos]
+        size = FULL.size if ident == FULL_ID else COMPRESSED.size if ident == COMPRESSED_ID else 0
+        if not size or pos + size > len(data) or not fletcher16(data[pos:pos + size]):
+            pos += 1
+            continue
+        if ident == FULL_ID:
+            _, _, hdop, t, spd, sacc, lat, lon, cog, sat, fix, _ = FULL.unpack_from(data, pos)
+            ref = dict(zip(FIELDS, (t, lat, lon, spd, sacc, cog, hdop, sat, fix)))
+            yield dict(ref)
+        elif ref:
+            _, _, hdop, dt, dspd, dsacc, dlat, dlon, dcog, sat, fix, _ = COMPRESSED.unpack_from(data, pos)
+            yield {"unix_time_ms": ref["unix_time_ms"] + dt, "latitude": ref["latitude"] + dlat,
+                   "longitude": ref["longitude"] + dlon, "speed_mm_s": ref["speed_mm_s"] + dspd,
+                   "speed_error": ref["speed_error"] + dsacc,
+                   "cog": (ref["cog"] // 1000 + dcog) * 1000, "hdop": hdop, "sat": sat, "fix": fix}
+        pos += size
+
+
+def decode(data):
+    """Yield frames of a GPY file, each file or segment starts with its header."""
+    flags = data[1] if len(data) >= HEADER_SIZE and data[0] == 0xF0 else 0
+    body = decode_v2 if flags & HEADER_FLAG_V2 else decode_v1
+    yield from body(data, HEADER_SIZE if data[:1] == b"\xf0" else 0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("gpy")
+    parser.add_argument("-o", "--output", help="CSV file, default stdout")
+    args = parser.parse_args()
+    with open(args.gpy, "rb") as f:
+        data = f.read()
+    out = open(args.output, "w", newline="") if args.output else sys.stdout
+    writer = csv.DictWriter(out, fieldnames=FIELDS)
+    writer.writeheader()
+    for frame in decode(data):
+        writer.writerow(frame)
+    if out is not sys.stdout:
+        out.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,68 @@
+/*
+ * Compress a raw UBX log into the .ubz stream of GPS_LOG_UBZ with the device
+ * encoder (log_ubz.c), one block per BLOCK input bytes like the async writer
+ * slots. scripts/ubz_decompress.py restores the raw stream.
+ *
+ * build: cc -O2 -Wall -I../include -o ubz_compress ubz_compress.c
+ * usage: ubz_compress [-b BLOCK] LOG.ubx [LOG.ubz]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// log_ubz.c without the device headers of log_private.h
+#define DB99F2E7_B596_4059_B6AF_FAD2A14CD6A0
+#define CONFIG_GPS_LOG_UBZ 1
+#include "../log_ubz.c"
+
+#define UBZ_BLOCK_DEFAULT 4096  // ASYNC_WRITER_BUFFER_SIZE
+#define UBZ_BLOCK_MAX 65535     // raw_len is 16 bit
+
+int main(int argc, char **argv) {
+    size_t block = UBZ_BLOCK_DEFAULT;
+    int i = 1;
+    if (i + 1 < argc && strcmp(argv[i], "-b") == 0) {
+        block = strtoul(argv[i + 1], NULL, 0);
+        i += 2;
+    }
+    if (i >= argc || block == 0 || block > UBZ_BLOCK_MAX) {
+        fprintf(stderr, "usage: ubz_compress [-b BLOCK] LOG.ubx [LOG.ubz]\n");
+        return 2;
+    }
+    const char *in_name = argv[i];
+    char out_name[4096];
+    if (i + 1 < argc) {
+        snprintf(out_name, sizeof(out_name), "%s", argv[i + 1]);
+    } else {
+        const char *dot = strrchr(in_name, '.');
+        int base = dot ? (int)(dot - in_name) : (int)strlen(in_name);
+        snprintf(out_name, sizeof(out_name), "%.*s.ubz", base, in_name);
+    }
+    if (strcmp(in_name, out_name) == 0) {
+        fprintf(stderr, "%s: output would overwrite the input\n", in_name);
+        return 1;
+    }
+    FILE *in = fopen(in_name, "rb");
+    FILE *out = in ? fopen(out_name, "wb") : NULL;
+    uint8_t *src = malloc(block);
+    uint8_t *dst = malloc(sizeof(struct UBZ_Block_Header) + UBZ_BOUND(block));
+    if (!in || !out || !src || !dst) {
+        fprintf(stderr, "%s: cannot open\n", !in ? in_name : out_name);
+        return 1;
+    }
+    size_t len, raw = 0, coded = 0, blocks = 0;
+    while ((len = fread(src, 1, block, in)) > 0) {
+        size_t n = ubz_encode_block(src, len, dst);
+        fwrite(dst, n, 1, out);
+        raw += len;
+        coded += n;
+        blocks++;
+    }
+    int err = ferror(in) | ferror(out) | fclose(out);
+    fclose(in);
+    free(src);
+    free(dst);
+    printf("%s: %zu bytes from %zu, %zu blocks%s\n", out_name, coded, raw, blocks, err ? ", write error" : "");
+    return err ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""Decompress a .ubz log (GPS_LOG_UBZ) back into the raw .ubx stream.
+
+Layout: include/ubz.h. Blocks decode independently, a damaged block is
+skipped by searching for the next block header.
+
+usage: ubz_decompress.py LOG.ubz [-o LOG.ubx]
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+UBZ_MAGIC = 0x5A55
+UBZ_FLAG_LZ = 0x01
+UBZ_FLAG_PVT_DELTA = 0x02
+BLOCK = struct.Struct("<HBBHH")     # magic, flags, reserved, raw_len, data_len
+PVT_SYNC = bytes((0xB5, 0x62, 0x01, 0x07, 92, 0x00))
+PVT_MSG_LEN = 100
+PVT_SUB_WORDS = 0x0027FFD9
+
+
+def lz_decode(data, raw_len):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        token = data[i]
+        i += 1
+        lit = token >> 4
+        if lit == 15:
+            while True:
+                b = data[i]
+                i += 1
+                lit += b
+                if b != 255:
+                    break
+        out += data[i:i + lit]
+        i += lit
+        if i >= len(data):
+            break
+        offset = data[i] | data[i + 1] << 8
+        i += 2
+        mlen = (token & 15) + 4
+        if token & 15 == 15:
+            while True:
+                b = data[i]
+                i += 1
+                mlen += b
+                if b != 255:
+                    break
+        start = len(out) - offset
+        if offset == 0 or start < 0:
+            raise ValueError("bad match offset")
+        for k in range(mlen):  # overlapping copies repeat the pattern
+            out.append(out[start + k])
+    if len(out) != raw_len:
+        raise ValueError(f"decoded {len(out)} of {raw_len} bytes")
+    return out
+
+
+def pvt_unfilter(buf):
+    prev = None
+    p = 0
+    while p + PVT_MSG_LEN <= len(buf):
+        if buf[p:p + 6] != PVT_SYNC:
+            p += 1
+            continue
+        words = list(struct.unpack_from("<23I", buf, p + 6))
+        if prev is not None:
+            for w in range(23):
+                if PVT_SUB_WORDS >> w & 1:
+                    words[w] = (words[w] + prev[w]) & 0xFFFFFFFF
+                else:
+                    words[w] ^= prev[w]
+            struct.pack_into("<23I", buf, p + 6, *words)
+        prev = words
+        p += PVT_MSG_LEN
+    return buf
+
+
+def decompress(data):
+    out = bytearray()
+    pos = blocks = bad = 0
+    while pos + BLOCK.size <= len(data):
+        magic, flags, _, raw_len, data_len = BLOCK.unpack_from(data, pos)
+        payload = data[pos + BLOCK.size:pos + BLOCK.size + data_len]
+        try:
+            if magic != UBZ_MAGIC or len(payload) < data_len:
+                raise ValueError("no block header")
+            raw = lz_decode(payload, raw_len) if flags & UBZ_FLAG_LZ else bytearray(payload)
+            out += pvt_unfilter(raw) if flags & UBZ_FLAG_PVT_DELTA else raw
+            pos += BLOCK.size + data_len
+            blocks += 1
+        except (ValueError, IndexError) as e:
+            if not any(data[pos:pos + BLOCK.size]):
+                break  # zero filled preallocated tail
+            bad += 1
+            print(f"block at {pos}: {e}, resyncing", file=sys.stderr)
+            nxt = data.find(struct.pack("<H", UBZ_MAGIC), pos + 1)
+            if nxt < 0:
+                break
+            pos = nxt
+    return out, blocks, bad
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("ubz")
+    parser.add_argument("-o", "--output")
+    args = parser.parse_args()
+    with open(args.ubz, "rb") as f:
+        data = f.read()
+    out, blocks, bad = decompress(data)
+    name = args.output or os.path.splitext(args.ubz)[0] + ".ubx"
+    with open(name, "wb") as f:
+        f.write(out)
+    ratio = len(out) / len(data) if data else 0
+    print(f"{name}: {len(out)} bytes from {len(data)} ({ratio:.2f}x), {blocks} blocks, {bad} bad")
+
+
+if __name__ == "__main__":
+    main()